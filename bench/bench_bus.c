@@ -0,0 +1,290 @@
+/***************************************************************************//**
+* @file    bench_bus.c
+* @version 1.0.0
+*
+* @brief Simulated SMBus of MLX90614 sensors for host benchmarks.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <applibs/i2c.h>
+#include <applibs/log.h>
+
+#include "bench_bus.h"
+
+#define BUS_ADDRESSES       128
+#define SENSOR_REGISTERS    64     // RAM 0x00..0x1F, EEPROM 0x20..0x3F
+
+static bool sensor_present[BUS_ADDRESSES];
+static uint16_t sensor_regs[BUS_ADDRESSES][SENSOR_REGISTERS];
+static uint32_t bus_delay_us;
+static uint64_t busy_until_ns[BUS_ADDRESSES];
+static pthread_mutex_t bus_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bench_bus_stats_t bus_stats;
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Calculate SMBus PEC byte.
+ *
+ * @param crc Previous CRC value.
+ * @param data Data byte.
+ *
+ * @return Updated CRC value.
+ */
+static uint8_t
+crc8(uint8_t crc, uint8_t data);
+
+/**
+ * @brief Spend configured transaction time and count contention.
+ *
+ * @param address Accessed sensor address.
+ */
+static void
+bus_transaction(I2C_DeviceAddress address);
+
+/**
+ * @brief Check whether sensor is in EEPROM erase or write cycle.
+ *
+ * @param address Sensor address.
+ *
+ * @return True if sensor is busy.
+ */
+static bool
+is_busy(I2C_DeviceAddress address);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+void
+bench_bus_add_sensor(uint8_t i2c_addr)
+{
+    uint16_t *p_regs = sensor_regs[i2c_addr];
+
+    sensor_present[i2c_addr] = true;
+    p_regs[0x06] = 14800;           // TA 22.85 degC
+    p_regs[0x07] = 15000;           // TOBJ1 26.85 degC
+    p_regs[0x08] = 15000;           // TOBJ2 26.85 degC
+    p_regs[0x20] = 0x9993;          // TOMAX
+    p_regs[0x21] = 0x62E3;          // TOMIN
+    p_regs[0x23] = 0xF71C;          // TA range
+    p_regs[0x24] = 0xFFFF;          // Emissivity 1.0
+    p_regs[0x25] = 0x9FB4;          // CONF1 factory default
+    p_regs[0x2E] = i2c_addr;
+    p_regs[0x3C] = 0x1234;
+    p_regs[0x3D] = 0x5678;
+    p_regs[0x3E] = 0x9ABC;
+    p_regs[0x3F] = i2c_addr;
+}
+
+void
+bench_bus_set_delay_us(uint32_t delay_us)
+{
+    bus_delay_us = delay_us;
+}
+
+void
+bench_bus_take_stats(bench_bus_stats_t *p_stats)
+{
+    p_stats->transactions = __atomic_exchange_n(&bus_stats.transactions, 0,
+        __ATOMIC_SEQ_CST);
+    p_stats->waits = __atomic_exchange_n(&bus_stats.waits, 0,
+        __ATOMIC_SEQ_CST);
+    p_stats->busy_hits = __atomic_exchange_n(&bus_stats.busy_hits, 0,
+        __ATOMIC_SEQ_CST);
+}
+
+uint16_t
+bench_bus_get_reg(uint8_t i2c_addr, uint8_t reg_addr)
+{
+    return sensor_regs[i2c_addr][reg_addr];
+}
+
+uint64_t
+bench_time_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+ssize_t
+I2CMaster_WriteThenRead(int fd, I2C_DeviceAddress address,
+    const uint8_t *p_write_data, size_t write_length, uint8_t *p_read_data,
+    size_t read_length)
+{
+    ssize_t result = -1;
+    uint8_t command = p_write_data[0];
+    uint16_t value = 0;
+    uint8_t crc;
+
+    (void)fd;
+
+    bus_transaction(address);
+
+    if ((address >= BUS_ADDRESSES) || !sensor_present[address] ||
+        (read_length < 3))
+    {
+        errno = ENXIO;
+    }
+    else
+    {
+        if (command < SENSOR_REGISTERS)
+        {
+            value = sensor_regs[address][command];
+        }
+        else if (command == 0xF0)
+        {
+            // POR done, EEBUSY while in EEPROM cycle
+            value = is_busy(address) ? 0x0090 : 0x0010;
+        }
+
+        p_read_data[0] = (uint8_t)(value & 0xFF);
+        p_read_data[1] = (uint8_t)(value >> 8);
+
+        crc = crc8(0, (uint8_t)(address << 1));
+        crc = crc8(crc, command);
+        crc = crc8(crc, (uint8_t)((address << 1) | 1));
+        crc = crc8(crc, p_read_data[0]);
+        p_read_data[2] = crc8(crc, p_read_data[1]);
+
+        result = (ssize_t)(write_length + read_length);
+    }
+
+    return result;
+}
+
+ssize_t
+I2CMaster_Write(int fd, I2C_DeviceAddress address, const uint8_t *p_data,
+    size_t length)
+{
+    ssize_t result = -1;
+
+    (void)fd;
+
+    bus_transaction(address);
+
+    if ((address >= BUS_ADDRESSES) || !sensor_present[address])
+    {
+        errno = ENXIO;
+    }
+    else
+    {
+        // Busy sensor ignores writes
+        if ((length >= 3) && (p_data[0] < SENSOR_REGISTERS) &&
+            !is_busy(address))
+        {
+            sensor_regs[address][p_data[0]] =
+                (uint16_t)(p_data[1] | (p_data[2] << 8));
+
+            if (p_data[0] >= 0x20)
+            {
+                __atomic_store_n(&busy_until_ns[address], bench_time_ns() +
+                    BENCH_BUS_EEPROM_BUSY_NS, __ATOMIC_SEQ_CST);
+            }
+        }
+        result = (ssize_t)length;
+    }
+
+    return result;
+}
+
+int
+I2CMaster_SetTimeout(int fd, uint32_t timeout_ms)
+{
+    (void)fd;
+    (void)timeout_ms;
+
+    return 0;
+}
+
+int
+I2CMaster_SetBusSpeed(int fd, I2C_BusSpeed speed)
+{
+    (void)fd;
+    (void)speed;
+
+    return 0;
+}
+
+int
+Log_Debug(const char *p_format, ...)
+{
+    va_list args;
+
+    va_start(args, p_format);
+    int result = vfprintf(stderr, p_format, args);
+    va_end(args);
+
+    return result;
+}
+
+int
+Log_DebugVarArgs(const char *p_format, va_list args)
+{
+    return vfprintf(stderr, p_format, args);
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static uint8_t
+crc8(uint8_t crc, uint8_t data)
+{
+    crc ^= data;
+
+    for (uint8_t bit = 0; bit < 8; bit++)
+    {
+        crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+
+    return crc;
+}
+
+static void
+bus_transaction(I2C_DeviceAddress address)
+{
+    __atomic_add_fetch(&bus_stats.transactions, 1, __ATOMIC_SEQ_CST);
+
+    if (pthread_mutex_trylock(&bus_mutex) != 0)
+    {
+        __atomic_add_fetch(&bus_stats.waits, 1, __ATOMIC_SEQ_CST);
+        pthread_mutex_lock(&bus_mutex);
+    }
+
+    if (bus_delay_us > 0)
+    {
+        usleep(bus_delay_us);
+    }
+
+    pthread_mutex_unlock(&bus_mutex);
+
+    if ((address < BUS_ADDRESSES) && is_busy(address))
+    {
+        __atomic_add_fetch(&bus_stats.busy_hits, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+static bool
+is_busy(I2C_DeviceAddress address)
+{
+    return bench_time_ns() < __atomic_load_n(&busy_until_ns[address],
+        __ATOMIC_SEQ_CST);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,78 @@
+/***************************************************************************//**
+* @file    bench_bus.h
+* @version 1.0.0
+*
+* @brief Simulated SMBus of MLX90614 sensors for host benchmarks.
+*
+* Sensors answer register reads with PEC computed like the real device. Each
+* bus call can be delayed to model transaction time on the wire. Calls are
+* serialized like by the I2C driver, one transaction on the wire at a time.
+* EEPROM writes keep the sensor busy for the erase/write cycle time. Calls
+* which find the bus occupied and accesses to a busy sensor are counted, so
+* contention benchmarks can check serialization.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _BENCH_BUS_H_
+#define _BENCH_BUS_H_
+
+#include <stdint.h>
+
+#define BENCH_BUS_EEPROM_BUSY_NS    5000000     // Erase or write cycle
+
+// Bus access counters
+typedef struct bench_bus_stats_struct
+{
+    uint32_t transactions;      // Bus calls
+    uint32_t waits;             // Calls which found bus occupied
+    uint32_t busy_hits;         // Accesses to sensor in EEPROM cycle
+} bench_bus_stats_t;
+
+/**
+ * @brief Add simulated sensor with plausible register contents.
+ *
+ * @param i2c_addr Sensor address.
+ */
+void
+bench_bus_add_sensor(uint8_t i2c_addr);
+
+/**
+ * @brief Set time spent in every bus call.
+ *
+ * @param delay_us Transaction time in microseconds.
+ */
+void
+bench_bus_set_delay_us(uint32_t delay_us);
+
+/**
+ * @brief Get bus access counters and reset them.
+ *
+ * @param p_stats Output counters.
+ */
+void
+bench_bus_take_stats(bench_bus_stats_t *p_stats);
+
+/**
+ * @brief Get register word of simulated sensor.
+ *
+ * @param i2c_addr Sensor address.
+ * @param reg_addr Register address, 0x00..0x3F.
+ *
+ * @return Register word.
+ */
+uint16_t
+bench_bus_get_reg(uint8_t i2c_addr, uint8_t reg_addr);
+
+/**
+ * @brief Get monotonic time.
+ *
+ * @return Time in nanoseconds.
+ */
+uint64_t
+bench_time_ns(void);
+
+#endif  // _BENCH_BUS_H_
+
+/* [] END OF FILE */
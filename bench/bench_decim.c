@@ -0,0 +1,334 @@
+/***************************************************************************//**
+* @file    bench_decim.c
+* @version 1.0.0
+*
+* @brief Noise, latency and throughput of decimator against chip filters.
+*
+* Synthetic TOBJ streams are fed to mlx90614_decim_push and the output noise
+* is measured. Latency is the time to settle after a temperature step, chip
+* filter settling time included. Chip rows use datasheet settling times from
+* mlx90614_warmup_settle_ms.
+*
+* Noise model, not measured on hardware:
+*   - FIR_1024 output noise is NOISE_FIR1024_LSB rms, white and Gaussian.
+*   - FIR noise scales with 1 / sqrt(FIR length).
+*   - One independent sample per IIR 100% settling time of the FIR setting,
+*     the rate a host reading at bus limit gets new values at.
+*   - Chip IIR with coefficient a reduces noise by sqrt(a / (2 - a)).
+*
+* Build and run on host:
+*   gcc -std=gnu11 -O2 -Ihost -I../lib_mlx90614/Inc/Public -I../lib_mlx90614
+*       bench_decim.c bench_bus.c ../lib_mlx90614/lib_mlx90614.c
+*       ../lib_mlx90614/mlx90614_*.c -lpthread -lm
+*   ./a.out
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_decim.h"
+#include "lib_mlx90614_warmup.h"
+#include "bench_bus.h"
+
+#define NOISE_FIR1024_LSB   2.0     // 0.04 degC rms
+#define LEVEL_RAW           15000   // 26.85 degC
+#define STEP_RAW            100     // 2 degC
+#define NOISE_OUTPUTS       20000   // Decimated outputs per noise run
+#define SPEED_SAMPLES       20000000
+
+// Chip IIR settings with their coefficients
+static const struct
+{
+    uint8_t iir;
+    double coef;
+    const char *p_name;
+} chip_iir[] = {
+    { CONF1_IIR_100, 1.0,    "100%" },
+    { CONF1_IIR_80,  0.8,    "80%" },
+    { CONF1_IIR_67,  0.666,  "67%" },
+    { CONF1_IIR_57,  0.571,  "57%" },
+    { CONF1_IIR_50,  0.5,    "50%" },
+    { CONF1_IIR_25,  0.25,   "25%" },
+    { CONF1_IIR_17,  0.1667, "17%" },
+    { CONF1_IIR_13,  0.125,  "13%" }
+};
+
+static const uint8_t input_fir[] = { CONF1_FIR_128, CONF1_FIR_1024 };
+static const uint16_t ratios[] = { 4, 16, 64, 256 };
+
+static uint64_t rng_state = 0x2545F4914F6CDD1DULL;
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Get CONF1 with given filter settings, single zone.
+ *
+ * @param iir CONF1_IIR_* setting.
+ * @param fir CONF1_FIR_* setting.
+ *
+ * @return CONF1 register contents.
+ */
+static mlx90614_conf1_t
+make_conf1(uint8_t iir, uint8_t fir);
+
+/**
+ * @brief Get output noise of FIR setting with IIR 100%.
+ *
+ * @param fir CONF1_FIR_* setting.
+ *
+ * @return Noise in raw LSB rms.
+ */
+static double
+fir_noise_lsb(uint8_t fir);
+
+/**
+ * @brief Get normally distributed random number.
+ *
+ * @return Random number with zero mean and unit variance.
+ */
+static double
+gauss(void);
+
+/**
+ * @brief Measure decimator output noise on noisy constant input.
+ *
+ * @param ratio Decimation ratio.
+ * @param order Filter order.
+ * @param noise_lsb Input noise in raw LSB rms.
+ *
+ * @return Output noise in raw LSB rms.
+ */
+static double
+measure_noise(uint16_t ratio, uint8_t order, double noise_lsb);
+
+/**
+ * @brief Measure input samples needed to settle after a step.
+ *
+ * @param ratio Decimation ratio.
+ * @param order Filter order.
+ *
+ * @return Input samples from step to first output within 0.5 LSB.
+ */
+static uint32_t
+measure_step(uint16_t ratio, uint8_t order);
+
+/**
+ * @brief Measure decimator processing time.
+ *
+ * @param ratio Decimation ratio.
+ * @param order Filter order.
+ *
+ * @return Time per input sample in nanoseconds.
+ */
+static double
+measure_speed(uint16_t ratio, uint8_t order);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+int
+main(void)
+{
+    printf("Chip filter, FIR 1024, noise %.2f LSB at IIR 100%%:\n",
+        NOISE_FIR1024_LSB);
+    printf("  IIR    noise LSB   settle ms\n");
+    for (uint8_t idx = 0; idx < sizeof(chip_iir) / sizeof(chip_iir[0]); idx++)
+    {
+        printf("  %-5s  %9.3f  %10u\n", chip_iir[idx].p_name,
+            NOISE_FIR1024_LSB * sqrt(chip_iir[idx].coef /
+            (2.0 - chip_iir[idx].coef)),
+            mlx90614_warmup_settle_ms(make_conf1(chip_iir[idx].iir,
+            CONF1_FIR_1024)));
+    }
+
+    for (uint8_t in = 0; in < sizeof(input_fir); in++)
+    {
+        uint32_t period_ms = mlx90614_warmup_settle_ms(
+            make_conf1(CONF1_IIR_100, input_fir[in]));
+        double noise_lsb = fir_noise_lsb(input_fir[in]);
+
+        printf("\nDecimator, input FIR %u IIR 100%%, %u ms per sample, "
+            "noise %.2f LSB:\n", 128U << (input_fir[in] - CONF1_FIR_128),
+            period_ms, noise_lsb);
+        printf("  ratio order  noise LSB   settle ms   delay ms  "
+            "eff bits\n");
+
+        for (uint8_t idx = 0; idx < sizeof(ratios) / sizeof(ratios[0]);
+            idx++)
+        {
+            for (uint8_t order = 1; order <= MLX90614_DECIM_ORDER_MAX;
+                order += 2)
+            {
+                mlx90614_decim_t dec;
+
+                mlx90614_decim_init(&dec, ratios[idx], order);
+                printf("  %5u %5u  %9.3f  %10u %10u  %8.2f\n", ratios[idx],
+                    order, measure_noise(ratios[idx], order, noise_lsb),
+                    period_ms * (1 + measure_step(ratios[idx], order)),
+                    period_ms * dec.latency_samples,
+                    dec.effective_bits_q8 / 256.0);
+            }
+        }
+    }
+
+    printf("\nThroughput, %u samples:\n", SPEED_SAMPLES);
+    for (uint8_t order = 1; order <= MLX90614_DECIM_ORDER_MAX; order++)
+    {
+        printf("  order %u ratio 16: %5.2f ns per input sample\n", order,
+            measure_speed(16, order));
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static mlx90614_conf1_t
+make_conf1(uint8_t iir, uint8_t fir)
+{
+    mlx90614_conf1_t conf1;
+
+    memset(&conf1, 0, sizeof(mlx90614_conf1_t));
+    conf1.IIR = iir;
+    conf1.FIR = fir;
+
+    return conf1;
+}
+
+static double
+fir_noise_lsb(uint8_t fir)
+{
+    return NOISE_FIR1024_LSB * sqrt((double)(1 << (CONF1_FIR_1024 - fir)));
+}
+
+static double
+gauss(void)
+{
+    double u1;
+    double u2;
+
+    // xorshift64*, two uniforms in (0, 1) for Box-Muller
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    u1 = ((rng_state * 0x2545F4914F6CDD1DULL) >> 11) + 0.5;
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    u2 = ((rng_state * 0x2545F4914F6CDD1DULL) >> 11) + 0.5;
+
+    u1 /= 9007199254740992.0;
+    u2 /= 9007199254740992.0;
+
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static double
+measure_noise(uint16_t ratio, uint8_t order, double noise_lsb)
+{
+    mlx90614_decim_t dec;
+    mlx90614_decimated_t out;
+    mlx90614_sample_t sample = { 0, LEVEL_RAW, 0x5A, MLX90614_RREG_TOBJ1 };
+    uint32_t outputs = 0;
+    double sum = 0.0;
+    double sum_sq = 0.0;
+    double mean;
+
+    mlx90614_decim_init(&dec, ratio, order);
+
+    while (outputs < NOISE_OUTPUTS)
+    {
+        // Chip output is quantized to whole LSB
+        sample.raw = (uint16_t)lround(LEVEL_RAW + noise_lsb * gauss());
+
+        if (mlx90614_decim_push(&dec, &sample, &out) && out.b_is_settled)
+        {
+            double value = out.value /
+                (double)(1 << MLX90614_DECIM_FRAC_BITS);
+
+            sum += value;
+            sum_sq += value * value;
+            outputs++;
+        }
+    }
+
+    mean = sum / outputs;
+
+    return sqrt(sum_sq / outputs - mean * mean);
+}
+
+static uint32_t
+measure_step(uint16_t ratio, uint8_t order)
+{
+    mlx90614_decim_t dec;
+    mlx90614_decimated_t out;
+    mlx90614_sample_t sample = { 0, LEVEL_RAW, 0x5A, MLX90614_RREG_TOBJ1 };
+    int32_t target = (LEVEL_RAW + STEP_RAW) << MLX90614_DECIM_FRAC_BITS;
+    uint32_t samples = 0;
+    bool b_is_settled = false;
+
+    mlx90614_decim_init(&dec, ratio, order);
+
+    // Settle on initial level, step right after an output
+    while (!mlx90614_decim_push(&dec, &sample, &out) || !out.b_is_settled)
+    {
+    }
+
+    sample.raw = LEVEL_RAW + STEP_RAW;
+    while (!b_is_settled)
+    {
+        samples++;
+        if (mlx90614_decim_push(&dec, &sample, &out))
+        {
+            int32_t error = out.value - target;
+
+            b_is_settled = (error < (1 << (MLX90614_DECIM_FRAC_BITS - 1))) &&
+                (error > -(1 << (MLX90614_DECIM_FRAC_BITS - 1)));
+        }
+    }
+
+    return samples;
+}
+
+static double
+measure_speed(uint16_t ratio, uint8_t order)
+{
+    static uint16_t raws[4096];
+    mlx90614_decim_t dec;
+    mlx90614_decimated_t out;
+    mlx90614_sample_t sample = { 0, LEVEL_RAW, 0x5A, MLX90614_RREG_TOBJ1 };
+    volatile int32_t sink = 0;
+    uint64_t start_ns;
+
+    for (uint32_t idx = 0; idx < sizeof(raws) / sizeof(raws[0]); idx++)
+    {
+        raws[idx] = (uint16_t)lround(LEVEL_RAW + 8.0 * gauss());
+    }
+
+    mlx90614_decim_init(&dec, ratio, order);
+
+    start_ns = bench_time_ns();
+    for (uint32_t idx = 0; idx < SPEED_SAMPLES; idx++)
+    {
+        sample.raw = raws[idx & (sizeof(raws) / sizeof(raws[0]) - 1)];
+        if (mlx90614_decim_push(&dec, &sample, &out))
+        {
+            sink += out.value;
+        }
+    }
+
+    return (double)(bench_time_ns() - start_ns) / SPEED_SAMPLES;
+}
+
+/* [] END OF FILE */
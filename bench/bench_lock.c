@@ -0,0 +1,217 @@
+/***************************************************************************//**
+* @file    bench_lock.c
+* @version 1.0.0
+*
+* @brief Contention benchmark of bus lock with many threads on one bus.
+*
+* Reader threads read all channels of four sensors on one simulated bus while
+* a writer thread updates emissivity of the first sensor. Every run is done
+* with and without bus lock attached. Reported are sample throughput, samples
+* of the written sensor, writer time, bus calls which had to wait for the
+* bus, accesses to the sensor during EEPROM cycle and whether the written
+* cell ends up correct.
+*
+* Bus calls take BUS_TRANSACTION_US, about one SMBus word read at 100 kHz.
+*
+* Build and run on host:
+*   gcc -std=gnu11 -O2 -Ihost -I../lib_mlx90614/Inc/Public -I../lib_mlx90614
+*       bench_lock.c bench_bus.c ../lib_mlx90614/lib_mlx90614.c
+*       ../lib_mlx90614/mlx90614_*.c -lpthread
+*   ./a.out 2>/dev/null
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_lock.h"
+#include "bench_bus.h"
+
+#define BUS_SENSORS         4
+#define MAX_READERS         32
+#define BUS_TRANSACTION_US  570
+#define EMISSIVITY_WRITES   20
+
+static const uint8_t thread_counts[] = { 4, 12, 32 };
+
+static mlx90614_t *p_sensors[BUS_SENSORS];
+static bool b_is_stopped;
+static uint32_t reader_samples[MAX_READERS];
+static uint64_t writer_ns;
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Read all channels of sensors in turn until stopped.
+ *
+ * @param p_arg Reader index.
+ *
+ * @return NULL.
+ */
+static void
+*reader_thread(void *p_arg);
+
+/**
+ * @brief Write emissivity of first sensor, then stop readers.
+ *
+ * @param p_arg Not used.
+ *
+ * @return NULL.
+ */
+static void
+*writer_thread(void *p_arg);
+
+/**
+ * @brief Run one contention measurement and print its results.
+ *
+ * @param readers Number of reader threads.
+ * @param b_is_locked Bus lock attached to sensors.
+ */
+static void
+run(uint8_t readers, bool b_is_locked);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+int
+main(void)
+{
+    for (uint8_t idx = 0; idx < BUS_SENSORS; idx++)
+    {
+        bench_bus_add_sensor((uint8_t)(0x5A + idx));
+    }
+    bench_bus_set_delay_us(BUS_TRANSACTION_US);
+
+    printf("%u sensors, %u us per bus call, %u emissivity writes\n",
+        BUS_SENSORS, BUS_TRANSACTION_US, EMISSIVITY_WRITES);
+    printf("readers lock    samples/s  written/s  writer ms  bus waits  "
+        "busy hits  cell\n");
+
+    for (uint8_t idx = 0; idx < sizeof(thread_counts); idx++)
+    {
+        run(thread_counts[idx], true);
+        run(thread_counts[idx], false);
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static void
+*reader_thread(void *p_arg)
+{
+    uint32_t reader = (uint32_t)(uintptr_t)p_arg;
+    mlx90614_sample_t samples[3];
+
+    while (!__atomic_load_n(&b_is_stopped, __ATOMIC_ACQUIRE))
+    {
+        reader_samples[reader] += mlx90614_read_channels(
+            p_sensors[reader % BUS_SENSORS], MLX90614_CH_TA |
+            MLX90614_CH_TOBJ1 | MLX90614_CH_TOBJ2, samples);
+    }
+
+    return NULL;
+}
+
+static void
+*writer_thread(void *p_arg)
+{
+    uint64_t start_ns = bench_time_ns();
+
+    (void)p_arg;
+
+    for (uint32_t idx = 0; idx < EMISSIVITY_WRITES; idx++)
+    {
+        mlx90614_set_emissivity(p_sensors[0], 0.5F + 0.02F * (float)idx);
+    }
+
+    writer_ns = bench_time_ns() - start_ns;
+    __atomic_store_n(&b_is_stopped, true, __ATOMIC_RELEASE);
+
+    return NULL;
+}
+
+static void
+run(uint8_t readers, bool b_is_locked)
+{
+    mlx90614_lock_t lock;
+    pthread_t reader_ids[MAX_READERS];
+    pthread_t writer_id;
+    bench_bus_stats_t stats;
+    uint32_t total = 0;
+    uint32_t written = 0;
+    uint64_t start_ns;
+    double elapsed_s;
+    uint16_t expected;
+
+    mlx90614_lock_init(&lock);
+
+    for (uint8_t idx = 0; idx < BUS_SENSORS; idx++)
+    {
+        p_sensors[idx] = mlx90614_open(0, (uint8_t)(0x5A + idx));
+        if (b_is_locked)
+        {
+            mlx90614_lock_attach(p_sensors[idx], &lock);
+        }
+    }
+
+    b_is_stopped = false;
+    for (uint8_t idx = 0; idx < readers; idx++)
+    {
+        reader_samples[idx] = 0;
+    }
+    bench_bus_take_stats(&stats);
+
+    start_ns = bench_time_ns();
+    for (uint8_t idx = 0; idx < readers; idx++)
+    {
+        pthread_create(&reader_ids[idx], NULL, reader_thread,
+            (void *)(uintptr_t)idx);
+    }
+    pthread_create(&writer_id, NULL, writer_thread, NULL);
+
+    pthread_join(writer_id, NULL);
+    for (uint8_t idx = 0; idx < readers; idx++)
+    {
+        pthread_join(reader_ids[idx], NULL);
+    }
+    elapsed_s = (double)(bench_time_ns() - start_ns) / 1e9;
+    bench_bus_take_stats(&stats);
+
+    for (uint8_t idx = 0; idx < readers; idx++)
+    {
+        total += reader_samples[idx];
+        if (idx % BUS_SENSORS == 0)
+        {
+            written += reader_samples[idx];
+        }
+    }
+
+    // Last written emissivity, converted like mlx90614_set_emissivity
+    expected = (uint16_t)((0.5F + 0.02F * (float)(EMISSIVITY_WRITES - 1)) *
+        65535.0);
+
+    printf("%7u %-6s %9.0f  %9.0f  %9.1f  %9u  %9u  %s\n", readers,
+        b_is_locked ? "on" : "off", total / elapsed_s, written / elapsed_s,
+        (double)writer_ns / 1e6, stats.waits, stats.busy_hits,
+        (bench_bus_get_reg(0x5A, MLX90614_EREG_ECC) == expected) ?
+        "ok" : "corrupt");
+
+    for (uint8_t idx = 0; idx < BUS_SENSORS; idx++)
+    {
+        mlx90614_close(p_sensors[idx]);
+    }
+    mlx90614_lock_destroy(&lock);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,196 @@
+/***************************************************************************//**
+* @file    bench_serialize.c
+* @version 1.0.0
+*
+* @brief Timing of JSON snapshot serializer against printf-style formatting.
+*
+* Writes the same snapshot batches with mlx90614_json_write and with an
+* snprintf("%.2f") writer converting raw words in float, as the library did
+* before integer formatting. Reports time per snapshot and number of batches
+* whose output differs.
+*
+* Build and run on host:
+*   gcc -std=gnu11 -O2 -Ihost -I../lib_mlx90614/Inc/Public -I../lib_mlx90614
+*       bench_serialize.c bench_bus.c ../lib_mlx90614/lib_mlx90614.c
+*       ../lib_mlx90614/mlx90614_*.c -lpthread
+*   ./a.out
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_serialize.h"
+#include "bench_bus.h"
+
+#define BATCH_SNAPSHOTS     32
+#define BATCHES             64
+#define ROUNDS              200
+#define BUFFER_SIZE         (BATCH_SNAPSHOTS * 80)
+
+static const char *channel_keys[3] = { "ta", "to1", "to2" };
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Write snapshots as JSON using snprintf and float conversion.
+ *
+ * @param p_snapshots Snapshots to be written.
+ * @param count Number of snapshots.
+ * @param p_buffer Output buffer.
+ * @param buffer_size Output buffer size.
+ *
+ * @return Number of bytes written, 0 if output does not fit into buffer.
+ */
+static uint32_t
+printf_json_write(const mlx90614_snapshot_t *p_snapshots, uint32_t count,
+    char *p_buffer, uint32_t buffer_size);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+int
+main(void)
+{
+    static mlx90614_snapshot_t snapshots[BATCHES][BATCH_SNAPSHOTS];
+    static uint8_t lib_buffer[BUFFER_SIZE];
+    static char printf_buffer[BUFFER_SIZE];
+    uint32_t seed = 1;
+    uint32_t mismatches = 0;
+    uint64_t bytes = 0;
+    uint64_t lib_ns;
+    uint64_t printf_ns;
+    uint64_t start_ns;
+    volatile uint32_t sink = 0;
+
+    // Temperatures -40..+125 degC with all three channels valid
+    for (uint32_t batch = 0; batch < BATCHES; batch++)
+    {
+        for (uint32_t idx = 0; idx < BATCH_SNAPSHOTS; idx++)
+        {
+            mlx90614_snapshot_t *p_snap = &snapshots[batch][idx];
+
+            seed = seed * 1103515245 + 12345;
+            p_snap->timestamp_ms = batch * 1000 + idx * 31;
+            p_snap->i2c_addr = (uint8_t)(0x5A + idx % 4);
+            p_snap->valid = MLX90614_CH_TA | MLX90614_CH_TOBJ1 |
+                MLX90614_CH_TOBJ2;
+            p_snap->ta = (uint16_t)(11657 + (seed >> 8) % 8250);
+            p_snap->tobj1 = (uint16_t)(11657 + (seed >> 12) % 8250);
+            p_snap->tobj2 = (uint16_t)(11657 + (seed >> 16) % 8250);
+        }
+    }
+
+    for (uint32_t batch = 0; batch < BATCHES; batch++)
+    {
+        uint32_t lib_length = mlx90614_json_write(snapshots[batch],
+            BATCH_SNAPSHOTS, MLX_TEMP_CELSIUS, lib_buffer, BUFFER_SIZE);
+        uint32_t printf_length = printf_json_write(snapshots[batch],
+            BATCH_SNAPSHOTS, printf_buffer, BUFFER_SIZE);
+
+        bytes += lib_length;
+        if ((lib_length != printf_length) ||
+            (memcmp(lib_buffer, printf_buffer, lib_length) != 0))
+        {
+            mismatches++;
+        }
+    }
+
+    start_ns = bench_time_ns();
+    for (uint32_t round = 0; round < ROUNDS; round++)
+    {
+        for (uint32_t batch = 0; batch < BATCHES; batch++)
+        {
+            sink += mlx90614_json_write(snapshots[batch], BATCH_SNAPSHOTS,
+                MLX_TEMP_CELSIUS, lib_buffer, BUFFER_SIZE);
+        }
+    }
+    lib_ns = bench_time_ns() - start_ns;
+
+    start_ns = bench_time_ns();
+    for (uint32_t round = 0; round < ROUNDS; round++)
+    {
+        for (uint32_t batch = 0; batch < BATCHES; batch++)
+        {
+            sink += printf_json_write(snapshots[batch], BATCH_SNAPSHOTS,
+                printf_buffer, BUFFER_SIZE);
+        }
+    }
+    printf_ns = bench_time_ns() - start_ns;
+
+    printf("%u snapshots per batch, %u batches, %u rounds, "
+        "%.1f bytes per snapshot\n", BATCH_SNAPSHOTS, BATCHES, ROUNDS,
+        (double)bytes / (BATCHES * BATCH_SNAPSHOTS));
+    printf("mlx90614_json_write: %7.1f ns per snapshot\n",
+        (double)lib_ns / ((uint64_t)ROUNDS * BATCHES * BATCH_SNAPSHOTS));
+    printf("snprintf(\"%%.2f\"):    %7.1f ns per snapshot\n",
+        (double)printf_ns / ((uint64_t)ROUNDS * BATCHES * BATCH_SNAPSHOTS));
+    printf("speedup %.2fx, batches with different output: %u of %u\n",
+        (double)printf_ns / (double)lib_ns, mismatches, BATCHES);
+
+    return (sink > 0) ? 0 : 1;
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static uint32_t
+printf_json_write(const mlx90614_snapshot_t *p_snapshots, uint32_t count,
+    char *p_buffer, uint32_t buffer_size)
+{
+    uint32_t length = 0;
+    bool b_is_full = false;
+    int written;
+
+    written = snprintf(p_buffer, buffer_size, "[");
+    length += (uint32_t)written;
+
+    for (uint32_t idx = 0; (idx < count) && !b_is_full; idx++)
+    {
+        const mlx90614_snapshot_t *p_snap = &p_snapshots[idx];
+        const uint16_t words[3] = { p_snap->ta, p_snap->tobj1, p_snap->tobj2 };
+
+        written = snprintf(&p_buffer[length], buffer_size - length,
+            "%s{\"addr\":%u,\"ts\":%u", (idx > 0) ? "," : "",
+            p_snap->i2c_addr, p_snap->timestamp_ms);
+        length += (uint32_t)written;
+
+        for (uint8_t ch = 0; ch < 3; ch++)
+        {
+            if ((p_snap->valid & (1 << ch)) && (length < buffer_size))
+            {
+                float celsius = (float)(words[ch] & 0x7FFF) * 0.02F - 273.15F;
+
+                written = snprintf(&p_buffer[length], buffer_size - length,
+                    ",\"%s\":%.2f", channel_keys[ch], celsius);
+                length += (uint32_t)written;
+            }
+        }
+
+        if (length < buffer_size)
+        {
+            written = snprintf(&p_buffer[length], buffer_size - length, "}");
+            length += (uint32_t)written;
+        }
+        b_is_full = (length >= buffer_size);
+    }
+
+    if (length < buffer_size)
+    {
+        written = snprintf(&p_buffer[length], buffer_size - length, "]");
+        length += (uint32_t)written;
+    }
+
+    // Output without terminator must fit, like in library writer
+    return (length < buffer_size) ? length : 0;
+}
+
+/* [] END OF FILE */
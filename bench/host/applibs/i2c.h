@@ -0,0 +1,46 @@
+/***************************************************************************//**
+* @file    i2c.h
+* @version 1.0.0
+*
+* @brief Host declarations of Azure Sphere I2C master API used by benchmarks.
+*
+* Only the subset called by lib_mlx90614 is declared. Functions are provided
+* by simulated bus in bench_bus.c.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _BENCH_APPLIBS_I2C_H_
+#define _BENCH_APPLIBS_I2C_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+typedef uint32_t I2C_DeviceAddress;
+typedef uint32_t I2C_InterfaceId;
+typedef uint32_t I2C_BusSpeed;
+
+#define I2C_BUS_SPEED_STANDARD      100000
+#define I2C_BUS_SPEED_FAST          400000
+#define I2C_BUS_SPEED_FAST_PLUS     1000000
+
+ssize_t
+I2CMaster_WriteThenRead(int fd, I2C_DeviceAddress address,
+    const uint8_t *p_write_data, size_t write_length, uint8_t *p_read_data,
+    size_t read_length);
+
+ssize_t
+I2CMaster_Write(int fd, I2C_DeviceAddress address, const uint8_t *p_data,
+    size_t length);
+
+int
+I2CMaster_SetTimeout(int fd, uint32_t timeout_ms);
+
+int
+I2CMaster_SetBusSpeed(int fd, I2C_BusSpeed speed);
+
+#endif  // _BENCH_APPLIBS_I2C_H_
+
+/* [] END OF FILE */
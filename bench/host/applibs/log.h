@@ -0,0 +1,24 @@
+/***************************************************************************//**
+* @file    log.h
+* @version 1.0.0
+*
+* @brief Host declarations of Azure Sphere debug log API used by benchmarks.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _BENCH_APPLIBS_LOG_H_
+#define _BENCH_APPLIBS_LOG_H_
+
+#include <stdarg.h>
+
+int
+Log_Debug(const char *p_format, ...);
+
+int
+Log_DebugVarArgs(const char *p_format, va_list args);
+
+#endif  // _BENCH_APPLIBS_LOG_H_
+
+/* [] END OF FILE */
@@ -96,7 +96,7 @@ typedef struct mlx90614_read_flags_struct
     };
 } mlx90614_read_flags_t;
 
-// PWMCTRL bitfields
+// PWMCTRL bitfields, 16-bit units as PWM_REP spans both bytes
 typedef struct mlx90614_pwmctrl_struct
 {
     union
@@ -104,23 +104,23 @@ typedef struct mlx90614_pwmctrl_struct
         struct
         {
             // 0 - PWM extended mode. 1 - PWM single mode
-            uint8_t PWM_MODE : 1;
+            uint16_t PWM_MODE : 1;
 
             // 0 - PWM mode disabled. 1 - PWM mode enabled.
-            uint8_t EN_PWM : 1;
+            uint16_t EN_PWM : 1;
 
             // 0 - SDA pin configured as Open Drain
             // 1 - SDA pin configured as Push-Pull
-            uint8_t PPODB : 1;
+            uint16_t PPODB : 1;
 
             // 0 - PWM mode selected, 1 - Thermal relay mode selected
-            uint8_t TRPWMB : 1;
+            uint16_t TRPWMB : 1;
 
             // PWM repetition number 062 step 2
-            uint8_t PWM_REP : 5;
+            uint16_t PWM_REP : 5;
 
             // PWM Period
-            uint8_t PWM_PERIOD : 7;
+            uint16_t PWM_PERIOD : 7;
         };
         uint16_t word;
     };
@@ -164,6 +164,21 @@ typedef struct mlx90614_conf1_struct
     };
 } mlx90614_conf1_t;
 
+#define PWMCTRL_PERIOD_SINGLE_US    1024    // PWM period unit, single mode
+#define PWMCTRL_PERIOD_EXTENDED_US  2048    // PWM period unit, extended mode
+#define PWMCTRL_PERIOD_MAX          128     // Written as 0
+#define PWMCTRL_REP_MAX             62      // Max repetitions, step 2
+
+// PWM timing calculated from PWMCTRL settings
+typedef struct mlx90614_pwm_timing_struct
+{
+    uint8_t pwm_period;     // PWM_PERIOD register field value
+    uint8_t pwm_rep;        // PWM_REP register field value
+    float period_ms;        // Resulting PWM period
+    float frequency_hz;     // Resulting PWM frequency
+    float latency_ms;       // Time between output updates of one channel
+} mlx90614_pwm_timing_t;
+
 #define CONF1_IIR_100     4   // IIR (100%) a1=1, b1=0
 #define CONF1_IIR_80      5   // IIR (80%) a1=0.8, b1=0.2
 #define CONF1_IIR_67      6   // IIR (67%) a1=0.666, b1=0.333
@@ -195,6 +210,58 @@ typedef enum {
     MLX_TEMP_FAHRENHEIT
 } mlx_temperature_unit;
 
+// Temperature channel flags
+#define MLX90614_CH_TA      0x01    // Ambient temperature
+#define MLX90614_CH_TOBJ1   0x02    // Object 1 temperature
+#define MLX90614_CH_TOBJ2   0x04    // Object 2 temperature
+
+// Filter presets
+typedef enum {
+    MLX_PRESET_FAST,            // Shortest settling time
+    MLX_PRESET_BALANCED,        // Moderate noise and settling time
+    MLX_PRESET_LOW_NOISE,       // Lowest noise
+    MLX_PRESET_COUNT
+} mlx_filter_preset;
+
+// Filter settings
+typedef struct mlx90614_filter_struct
+{
+    uint8_t iir;                // CONF1_IIR_*
+    uint8_t fir;                // CONF1_FIR_*
+} mlx90614_filter_t;
+
+// Sensor capability profile built at open
+typedef struct mlx90614_profile_struct
+{
+    uint64_t id;                // Device ID words combined, ID1 most significant
+    mlx90614_conf1_t conf1;     // CONF1 contents
+    uint8_t channels;           // MLX90614_CH_* available channels
+    uint8_t zones;              // Number of IR zones
+    uint16_t tobj_min;          // TOBJ range min, raw linearized
+    uint16_t tobj_max;          // TOBJ range max, raw linearized
+    uint16_t ta_min;            // TA range min, raw linearized
+    uint16_t ta_max;            // TA range max, raw linearized
+    mlx90614_filter_t presets[MLX_PRESET_COUNT];    // Recommended filters
+} mlx90614_profile_t;
+
+// Sensor calibration, see lib_mlx90614_cal.h
+struct mlx90614_cal_struct;
+
+// Read plausibility guard, see lib_mlx90614_guard.h
+struct mlx90614_guard_struct;
+
+// Bus time accounting, see lib_mlx90614_busstat.h
+struct mlx90614_busstat_struct;
+
+// Bus lock, see lib_mlx90614_lock.h
+struct mlx90614_lock_struct;
+
+// Adaptive timeouts, see lib_mlx90614_timeout.h
+struct mlx90614_timeout_struct;
+
+// Bus speed probing, see lib_mlx90614_speed.h
+struct mlx90614_speed_struct;
+
 // MLX90614 sensor device descriptor
 typedef struct mlx90614_struct
 {
@@ -202,8 +269,35 @@ typedef struct mlx90614_struct
     I2C_DeviceAddress i2c_addr;             // I2C device address
     uint16_t device_id[4];                  // 4x word Device ID
     mlx_temperature_unit temperature_unit;  // Temperature measurement unit
+    mlx90614_profile_t profile;             // Capability profile
+    struct mlx90614_cal_struct *p_cal;      // Calibration, NULL if none
+    struct mlx90614_guard_struct *p_guard;  // Read guard, NULL if disabled
+    struct mlx90614_busstat_struct *p_busstat;  // Bus accounting, or NULL
+    struct mlx90614_lock_struct *p_lock;    // Bus lock, NULL if unlocked
+    struct mlx90614_timeout_struct *p_timeout;  // Adaptive timeouts, or NULL
+    struct mlx90614_speed_struct *p_speed;  // Bus speed state, or NULL
 } mlx90614_t;
 
+// Single raw channel sample
+typedef struct mlx90614_sample_struct
+{
+    uint32_t timestamp_ms;      // Monotonic timestamp in milliseconds
+    uint16_t raw;               // Raw linearized word, MSB is the error flag
+    uint8_t i2c_addr;           // Source sensor I2C address
+    uint8_t channel;            // Source RAM register (MLX90614_RREG_*)
+} mlx90614_sample_t;
+
+// Raw readings of all temperature channels taken together
+typedef struct mlx90614_snapshot_struct
+{
+    uint32_t timestamp_ms;      // Monotonic timestamp in milliseconds
+    uint8_t i2c_addr;           // Source sensor I2C address
+    uint8_t valid;              // MLX90614_CH_* flags of valid readings
+    uint16_t ta;                // Raw ambient temperature word
+    uint16_t tobj1;             // Raw object 1 temperature word
+    uint16_t tobj2;             // Raw object 2 temperature word
+} mlx90614_snapshot_t;
+
 /**
  * @brief Initialize MLX90614 sensor.
  *
@@ -226,6 +320,10 @@ mlx90614_close(mlx90614_t *p_mlx);
 /**
  * @brief Sets the temperature unit used for measurement output.
  *
+ * Unit is shared by all users of the descriptor. Components sharing a sensor
+ * should use raw samples and convert them with mlx90614_convert_batch or
+ * subscribe to a sample hub (lib_mlx90614_hub.h) instead.
+ *
  * @param p_mlx Pointer to MLX90614 device descriptor.
  * @param unit Temperature measurement unit.
  */
@@ -282,6 +380,77 @@ mlx90614_get_temperature_object1(mlx90614_t *p_mlx);
 float
 mlx90614_get_temperature_object2(mlx90614_t *p_mlx);
 
+/**
+ * @brief Get object temperature difference between IR1 and IR2 sensors.
+ *
+ * Difference is expressed in current temperature unit scale, raw linearized
+ * words difference for MLX_TEMP_LINEARIZED.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ *
+ * @return Tobj1 - Tobj2 difference, MLX90614_TEMP_ERROR on single zone
+ * sensors or on failure.
+ */
+float
+mlx90614_get_temperature_gradient(mlx90614_t *p_mlx);
+
+/**
+ * @brief Read CONF1 register.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param p_conf1 Pointer to variable to store register contents.
+ *
+ * @return True on success, false on failure.
+ */
+bool
+mlx90614_get_conf1(mlx90614_t *p_mlx, mlx90614_conf1_t *p_conf1);
+
+/**
+ * @brief Build sensor capability profile from ID and EEPROM contents.
+ *
+ * Profile is built at open. It should be rebuilt after changing CONF1 or
+ * TOBJ / TA ranges.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ *
+ * @return True on success, false on failure.
+ */
+bool
+mlx90614_load_profile(mlx90614_t *p_mlx);
+
+/**
+ * @brief Get sensor capability profile.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ *
+ * @return Pointer to capability profile.
+ */
+const mlx90614_profile_t
+*mlx90614_get_profile(mlx90614_t *p_mlx);
+
+/**
+ * @brief Get temperature channels available on sensor.
+ *
+ * Channels are determined from CONF1 SENSOR_MODE in capability profile.
+ * Object 2 temperature is available on dual zone sensors only.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ *
+ * @return MLX90614_CH_* flags of available channels.
+ */
+uint8_t
+mlx90614_get_channels(mlx90614_t *p_mlx);
+
+/**
+ * @brief Get number of IR zones (object temperature channels) on sensor.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ *
+ * @return 1 for single zone, 2 for dual zone sensor.
+ */
+uint8_t
+mlx90614_get_zone_count(mlx90614_t *p_mlx);
+
 /**
  * @brief Get ambient (sensor die) temperature.
  *
@@ -292,6 +461,74 @@ mlx90614_get_temperature_object2(mlx90614_t *p_mlx);
 float
 mlx90614_get_temperature_ambient(mlx90614_t *p_mlx);
 
+/**
+ * @brief Read raw linearized word from a RAM channel as a timestamped sample.
+ *
+ * The raw word is stored as read, including the error flag, so that sample
+ * streams can be stored and transmitted without float conversion.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param channel RAM register address (MLX90614_RREG_*).
+ * @param p_sample Pointer to sample structure to be filled.
+ *
+ * @return True on success, false on failure.
+ */
+bool
+mlx90614_read_sample(mlx90614_t *p_mlx, uint8_t channel, 
+    mlx90614_sample_t *p_sample);
+
+/**
+ * @brief Read raw samples of selected channels.
+ *
+ * Channels not available on sensor are skipped without bus transaction.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param channels MLX90614_CH_* flags of channels to read.
+ * @param p_samples Output buffer for up to 3 samples, in TA, TOBJ1, TOBJ2
+ * order.
+ *
+ * @return Number of samples read.
+ */
+uint8_t
+mlx90614_read_channels(mlx90614_t *p_mlx, uint8_t channels,
+    mlx90614_sample_t *p_samples);
+
+/**
+ * @brief Read ambient and object temperature channels as a snapshot.
+ *
+ * Only channels available on sensor are read. Channels which could not be
+ * read or have error flag set are left out of snapshot valid flags.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param p_snapshot Pointer to snapshot structure to be filled.
+ *
+ * @return True if at least one channel was read, false otherwise.
+ */
+bool
+mlx90614_get_snapshot(mlx90614_t *p_mlx, mlx90614_snapshot_t *p_snapshot);
+
+/**
+ * @brief Get monotonic time used for sample timestamps.
+ *
+ * @return Monotonic time in milliseconds.
+ */
+uint32_t
+mlx90614_get_time_ms(void);
+
+/**
+ * @brief Convert raw sample values to temperature unit.
+ *
+ * Samples with error flag set are converted to MLX90614_TEMP_ERROR.
+ *
+ * @param p_samples Input samples.
+ * @param p_values Output temperatures.
+ * @param count Number of samples.
+ * @param unit Temperature unit.
+ */
+void
+mlx90614_convert_batch(const mlx90614_sample_t *p_samples, float *p_values,
+    uint32_t count, mlx_temperature_unit unit);
+
 /**
  * @brief Get current object emissivity correction coefficient.
  *
@@ -369,6 +606,58 @@ mlx90614_get_ta_range_min(mlx90614_t *p_mlx);
 float
 mlx90614_get_ta_range_max(mlx90614_t *p_mlx);
 
+/**
+ * @brief Read PWM control register.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param p_pwmctrl Pointer to variable to store register contents.
+ *
+ * @return True on success, false on failure.
+ */
+bool
+mlx90614_get_pwmctrl(mlx90614_t *p_mlx, mlx90614_pwmctrl_t *p_pwmctrl);
+
+/**
+ * @brief Write PWM control register and verify written value.
+ *
+ * EEPROM is not written if register already holds requested value.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param pwmctrl New register contents.
+ *
+ * @return True on success, false on failure.
+ */
+bool
+mlx90614_set_pwmctrl(mlx90614_t *p_mlx, mlx90614_pwmctrl_t pwmctrl);
+
+/**
+ * @brief Calculate PWM_PERIOD and PWM_REP for target PWM frequency.
+ *
+ * Latency is the time between output updates of a single temperature:
+ * the period times the repetition count (at least 1), doubled in extended
+ * mode where two temperatures are output in turn.
+ *
+ * @param frequency_hz Target PWM frequency.
+ * @param repetitions Target PWM repetition count 0 - 62, rounded up to even.
+ * @param b_is_extended True for extended PWM mode, false for single mode.
+ * @param p_timing Pointer to structure to store calculated timing.
+ *
+ * @return True if target was achieved, false if values had to be clamped.
+ */
+bool
+mlx90614_pwm_calculate(float frequency_hz, uint8_t repetitions,
+    bool b_is_extended, mlx90614_pwm_timing_t *p_timing);
+
+/**
+ * @brief Get PWM timing resulting from PWM control register contents.
+ *
+ * @param pwmctrl PWM control register contents.
+ * @param p_timing Pointer to structure to store timing.
+ */
+void
+mlx90614_pwm_timing(mlx90614_pwmctrl_t pwmctrl,
+    mlx90614_pwm_timing_t *p_timing);
+
 #ifdef __cplusplus
 }
 #endif
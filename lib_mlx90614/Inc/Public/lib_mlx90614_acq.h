@@ -0,0 +1,166 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_acq.h
+* @version 1.0.0
+*
+* @brief Parallel multi-bus acquisition of MLX90614 sensors.
+*
+* Acquisition engine runs one worker thread per I2C bus. Each worker reads its
+* sensors every period and stamps samples with the common monotonic clock of
+* mlx90614_get_time_ms(). Samples of one cycle are published to a per-bus
+* ring together with a watermark, the earliest time the worker can stamp its
+* next sample. Reader merges the rings into one stream ordered by timestamp:
+* a sample is released once every other bus either has an older sample queued
+* or its watermark has passed the sample time, so buses never wait for each
+* other and total throughput grows with the number of buses.
+*
+* Sensor descriptors are owned by the worker of their bus while acquisition is
+* running and must not be accessed from other threads.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_ACQ_H_
+#define _LIB_MLX90614_ACQ_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "lib_mlx90614.h"
+
+#define MLX90614_ACQ_MAX_SENSORS    16  // Sensors per bus
+
+// Merged sample
+typedef struct mlx90614_acq_sample_struct
+{
+    mlx90614_sample_t sample;   // Raw sample
+    uint8_t bus;                // Source bus index
+} mlx90614_acq_sample_t;
+
+// Worker statistics
+typedef struct mlx90614_acq_stats_struct
+{
+    uint32_t cycles;            // Completed read cycles
+    uint32_t overruns;          // Cycles longer than period
+    uint32_t samples;           // Samples published
+    uint32_t dropped;           // Samples dropped on full ring
+} mlx90614_acq_stats_t;
+
+struct mlx90614_acq_struct;
+
+// Bus worker
+typedef struct mlx90614_acq_bus_struct
+{
+    struct mlx90614_acq_struct *p_acq;  // Owning engine
+    pthread_t thread;           // Worker thread
+    pthread_mutex_t lock;       // Guards ring indexes, watermark, stats
+    mlx90614_t *p_sensors[MLX90614_ACQ_MAX_SENSORS];
+    uint8_t channels[MLX90614_ACQ_MAX_SENSORS];
+    uint8_t sensor_count;       // Sensors on bus
+    bool b_is_running;          // Worker keeps running
+    bool b_is_done;             // Worker exited, no more samples
+    uint32_t watermark_ms;      // Lower bound of next sample timestamp
+    uint32_t head;              // Ring read index
+    uint32_t tail;              // Ring write index
+    mlx90614_sample_t *p_ring;  // Sample ring
+    mlx90614_acq_stats_t stats; // Worker statistics
+} mlx90614_acq_bus_t;
+
+// Acquisition engine
+typedef struct mlx90614_acq_struct
+{
+    uint32_t period_ms;         // Read cycle period
+    uint32_t ring_size;         // Ring capacity per bus
+    uint8_t bus_count;          // Number of buses
+    bool b_is_started;          // Workers started
+    mlx90614_acq_bus_t *p_buses;    // Bus workers
+} mlx90614_acq_t;
+
+/**
+ * @brief Create acquisition engine.
+ *
+ * @param bus_count Number of buses.
+ * @param period_ms Read cycle period.
+ * @param ring_size Ring capacity per bus in samples.
+ *
+ * @return Pointer to acquisition engine, NULL on failure.
+ */
+mlx90614_acq_t
+*mlx90614_acq_open(uint8_t bus_count, uint32_t period_ms, uint32_t ring_size);
+
+/**
+ * @brief Stop workers and free acquisition engine.
+ *
+ * @param p_acq Pointer to acquisition engine.
+ */
+void
+mlx90614_acq_close(mlx90614_acq_t *p_acq);
+
+/**
+ * @brief Add sensor to bus worker, before start.
+ *
+ * @param p_acq Pointer to acquisition engine.
+ * @param bus Bus index.
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param channels MLX90614_CH_* flags of channels to read.
+ *
+ * @return True if sensor was added.
+ */
+bool
+mlx90614_acq_add_sensor(mlx90614_acq_t *p_acq, uint8_t bus,
+    mlx90614_t *p_mlx, uint8_t channels);
+
+/**
+ * @brief Start bus workers.
+ *
+ * @param p_acq Pointer to acquisition engine.
+ *
+ * @return True if all workers were started.
+ */
+bool
+mlx90614_acq_start(mlx90614_acq_t *p_acq);
+
+/**
+ * @brief Stop bus workers, queued samples stay readable.
+ *
+ * @param p_acq Pointer to acquisition engine.
+ */
+void
+mlx90614_acq_stop(mlx90614_acq_t *p_acq);
+
+/**
+ * @brief Read merged samples in timestamp order.
+ *
+ * @param p_acq Pointer to acquisition engine.
+ * @param p_samples Output buffer.
+ * @param max_count Output buffer capacity.
+ *
+ * @return Number of samples read.
+ */
+uint32_t
+mlx90614_acq_read(mlx90614_acq_t *p_acq, mlx90614_acq_sample_t *p_samples,
+    uint32_t max_count);
+
+/**
+ * @brief Get worker statistics.
+ *
+ * @param p_acq Pointer to acquisition engine.
+ * @param bus Bus index.
+ * @param p_stats Statistics output.
+ */
+void
+mlx90614_acq_get_stats(mlx90614_acq_t *p_acq, uint8_t bus,
+    mlx90614_acq_stats_t *p_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_ACQ_H_
+
+/* [] END OF FILE */
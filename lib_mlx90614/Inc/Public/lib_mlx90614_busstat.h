@@ -0,0 +1,156 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_busstat.h
+* @version 1.0.0
+*
+* @brief Runtime bus time accounting of MLX90614 sensors.
+*
+* Accounting object is shared by all sensors on one bus and attached to their
+* descriptors. Support layer records every SMBus transaction with measured
+* duration of the bus call, wire bytes (address, command and data bytes) and
+* operation type. Running totals are kept for the bus and per sensor, split by
+* operation. Rolling utilization is computed from busy time of a window
+* divided into MLX90614_BUSSTAT_BUCKETS buckets.
+*
+* Operation type is derived from the accessed register: RAM reads are sample
+* reads, EEPROM reads are configuration reads. EEPROM erase and write cycles
+* and reads repeated by the plausibility guard are accounted separately.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_BUSSTAT_H_
+#define _LIB_MLX90614_BUSSTAT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lib_mlx90614.h"
+
+#define MLX90614_BUSSTAT_BUCKETS        16
+#define MLX90614_BUSSTAT_MAX_SENSORS    16
+
+// Bus operation type
+typedef enum {
+    MLX_BUSOP_SAMPLE,           // RAM register reads
+    MLX_BUSOP_FLAGS,            // Flag register polls
+    MLX_BUSOP_CONFIG,           // EEPROM cell reads
+    MLX_BUSOP_ERASE,            // EEPROM cell erase
+    MLX_BUSOP_WRITE,            // EEPROM cell and RAM writes
+    MLX_BUSOP_RETRY,            // Repeated reads
+    MLX_BUSOP_COUNT
+} mlx_bus_op;
+
+// Running totals of one operation type
+typedef struct mlx90614_busstat_totals_struct
+{
+    uint32_t transactions;      // Transactions including failed
+    uint32_t errors;            // Failed transactions
+    uint64_t bytes;             // Wire bytes of successful transactions
+    uint64_t busy_us;           // Bus time
+} mlx90614_busstat_totals_t;
+
+// Totals of one sensor
+typedef struct mlx90614_busstat_sensor_struct
+{
+    uint8_t i2c_addr;           // Sensor address
+    mlx90614_busstat_totals_t ops[MLX_BUSOP_COUNT];
+} mlx90614_busstat_sensor_t;
+
+// Bus accounting
+typedef struct mlx90614_busstat_struct
+{
+    uint32_t bucket_ms;         // Rolling window bucket length
+    uint32_t start_ms;          // Accounting start
+    uint32_t bucket_start_ms;   // Start of current bucket
+    uint8_t bucket_idx;         // Current bucket
+    uint32_t bucket_us[MLX90614_BUSSTAT_BUCKETS];   // Busy time per bucket
+    mlx90614_busstat_totals_t ops[MLX_BUSOP_COUNT]; // Bus totals
+    uint32_t untracked;         // Transactions of sensors over table capacity
+    uint8_t sensor_count;       // Tracked sensors
+    mlx90614_busstat_sensor_t sensors[MLX90614_BUSSTAT_MAX_SENSORS];
+} mlx90614_busstat_t;
+
+/**
+ * @brief Initialize bus accounting.
+ *
+ * @param p_stat Pointer to bus accounting.
+ * @param window_ms Rolling utilization window.
+ */
+void
+mlx90614_busstat_init(mlx90614_busstat_t *p_stat, uint32_t window_ms);
+
+/**
+ * @brief Clear totals and rolling window, keep window length.
+ *
+ * @param p_stat Pointer to bus accounting.
+ */
+void
+mlx90614_busstat_reset(mlx90614_busstat_t *p_stat);
+
+/**
+ * @brief Attach bus accounting to sensor.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param p_stat Pointer to accounting of sensor bus, NULL to detach.
+ */
+void
+mlx90614_busstat_attach(mlx90614_t *p_mlx, mlx90614_busstat_t *p_stat);
+
+/**
+ * @brief Record transaction.
+ *
+ * @param p_stat Pointer to bus accounting.
+ * @param i2c_addr Sensor address.
+ * @param op Operation type.
+ * @param bytes Wire bytes.
+ * @param busy_us Measured transaction time.
+ * @param b_is_ok Transaction succeeded.
+ */
+void
+mlx90614_busstat_record(mlx90614_busstat_t *p_stat, uint8_t i2c_addr,
+    mlx_bus_op op, uint32_t bytes, uint32_t busy_us, bool b_is_ok);
+
+/**
+ * @brief Get totals of sensor.
+ *
+ * @param p_stat Pointer to bus accounting.
+ * @param i2c_addr Sensor address.
+ *
+ * @return Pointer to sensor totals, NULL if sensor is not tracked.
+ */
+const mlx90614_busstat_sensor_t
+*mlx90614_busstat_get_sensor(const mlx90614_busstat_t *p_stat,
+    uint8_t i2c_addr);
+
+/**
+ * @brief Sum totals over operation types.
+ *
+ * @param p_ops Totals per operation type, bus or sensor.
+ * @param p_sum Sum output.
+ */
+void
+mlx90614_busstat_sum(const mlx90614_busstat_totals_t *p_ops,
+    mlx90614_busstat_totals_t *p_sum);
+
+/**
+ * @brief Get rolling bus utilization.
+ *
+ * @param p_stat Pointer to bus accounting.
+ *
+ * @return Busy time of rolling window in permille.
+ */
+uint16_t
+mlx90614_busstat_utilization(mlx90614_busstat_t *p_stat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_BUSSTAT_H_
+
+/* [] END OF FILE */
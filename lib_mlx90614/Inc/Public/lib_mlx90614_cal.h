@@ -0,0 +1,140 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_cal.h
+* @version 1.0.0
+*
+* @brief Per-sensor object temperature calibration for MLX90614.
+*
+* Calibration is a piecewise-linear mapping of raw linearized object
+* temperatures to reference values, one table per IR zone. Calibration points
+* are precomputed into fixed point segments (Q16 slope) and applied to TOBJ1
+* and TOBJ2 readings in the library read path using a branch-free segment
+* lookup. Values outside calibration points are extrapolated from the first
+* or last segment.
+*
+* Calibration can be saved to and loaded from a compact blob keyed by device
+* ID, so it can be stored by the application alongside other settings.
+*
+* Blob layout (multi-byte fields little endian):
+*   [0]     Magic 0x43
+*   [1]     Format version
+*   [2-9]   Device ID
+*   [10]    Number of zone 1 points
+*   [11]    Number of zone 2 points
+*   [...]   Points, 2 byte raw value and 2 byte reference value each
+*   [n-2]   CRC-16 of all preceding bytes
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_CAL_H_
+#define _LIB_MLX90614_CAL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lib_mlx90614.h"
+
+#define MLX90614_CAL_MAGIC          0x43
+#define MLX90614_CAL_VERSION        1
+
+// Maximum number of calibration points per zone, must be a power of 2
+#define MLX90614_CAL_MAX_POINTS     8
+
+// Maximum calibration blob size
+#define MLX90614_CAL_BLOB_SIZE      (12 + 2 * MLX90614_CAL_MAX_POINTS * 4 + 2)
+
+// Calibration point
+typedef struct mlx90614_cal_point_struct
+{
+    uint16_t raw;               // Raw linearized value read from sensor
+    uint16_t ref;               // Reference raw linearized value
+} mlx90614_cal_point_t;
+
+// Precomputed calibration segment
+typedef struct mlx90614_cal_segment_struct
+{
+    uint16_t x0;                // Segment start raw value
+    int32_t y0;                 // Calibrated value at segment start
+    int32_t slope;              // Segment slope, Q16 fixed point
+} mlx90614_cal_segment_t;
+
+// Sensor calibration
+typedef struct mlx90614_cal_struct
+{
+    uint8_t point_count[2];     // Number of points per zone, 0 = disabled
+    mlx90614_cal_point_t points[2][MLX90614_CAL_MAX_POINTS];
+    mlx90614_cal_segment_t segments[2][MLX90614_CAL_MAX_POINTS];
+} mlx90614_cal_t;
+
+/**
+ * @brief Set calibration points for IR zone.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param zone IR zone, 1 or 2.
+ * @param p_points Calibration points, in any order.
+ * @param count Number of points, 0 disables zone calibration.
+ *
+ * @return True on success, false on invalid points or memory shortage.
+ */
+bool
+mlx90614_cal_set(mlx90614_t *p_mlx, uint8_t zone,
+    const mlx90614_cal_point_t *p_points, uint8_t count);
+
+/**
+ * @brief Remove sensor calibration.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ */
+void
+mlx90614_cal_clear(mlx90614_t *p_mlx);
+
+/**
+ * @brief Save sensor calibration to blob.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param p_buffer Output buffer.
+ * @param buffer_size Output buffer size.
+ *
+ * @return Blob length, 0 if there is no calibration or buffer is too small.
+ */
+uint32_t
+mlx90614_cal_save(mlx90614_t *p_mlx, uint8_t *p_buffer, uint32_t buffer_size);
+
+/**
+ * @brief Load sensor calibration from blob.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param p_buffer Blob.
+ * @param length Blob length.
+ *
+ * @return True on success, false if blob is invalid or belongs to a
+ * different device.
+ */
+bool
+mlx90614_cal_load(mlx90614_t *p_mlx, const uint8_t *p_buffer,
+    uint32_t length);
+
+/**
+ * @brief Apply zone calibration to raw linearized value.
+ *
+ * @param p_cal Pointer to calibration.
+ * @param zone IR zone, 1 or 2.
+ * @param raw Raw linearized value, error flag is preserved.
+ *
+ * @return Calibrated raw linearized value.
+ */
+uint16_t
+mlx90614_cal_apply(const mlx90614_cal_t *p_cal, uint8_t zone, uint16_t raw);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_CAL_H_
+
+/* [] END OF FILE */
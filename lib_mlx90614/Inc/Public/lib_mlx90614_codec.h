@@ -0,0 +1,149 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_codec.h
+* @version 1.0.0
+*
+* @brief Compact binary encoding of MLX90614 sample streams.
+*
+* Samples of a single sensor channel are packed into blocks. Raw linearized
+* words (including the error flag) are stored as zig-zag varint deltas against
+* the previous sample, timestamps as zig-zag varint delta-of-delta. Each block
+* is terminated by a CRC-16. Slowly changing temperatures sampled at a fixed
+* period typically take 2 bytes per sample.
+*
+* Block layout (multi-byte fields little endian):
+*   [0]     Magic 0x4D
+*   [1]     Format version
+*   [2]     Sensor I2C address
+*   [3]     Channel (MLX90614_RREG_*)
+*   [4-5]   Sample count
+*   [6-9]   First sample timestamp
+*   [10-11] First sample raw word
+*   [...]   Per following sample: varint(dod timestamp), varint(delta raw)
+*   [n-2]   CRC-16 of all preceding bytes
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_CODEC_H_
+#define _LIB_MLX90614_CODEC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lib_mlx90614.h"
+
+#define MLX90614_CODEC_MAGIC            0x4D
+#define MLX90614_CODEC_VERSION          1
+
+#define MLX90614_CODEC_HEADER_SIZE      12
+#define MLX90614_CODEC_CRC_SIZE         2
+
+// Worst case encoded sample size (5 byte timestamp + 3 byte value varints)
+#define MLX90614_CODEC_MAX_SAMPLE_SIZE  8
+
+// Smallest buffer able to hold a block with a single sample
+#define MLX90614_CODEC_MIN_BLOCK_SIZE   (MLX90614_CODEC_HEADER_SIZE + \
+                                         MLX90614_CODEC_CRC_SIZE)
+
+// Block encoder state
+typedef struct mlx90614_encoder_struct
+{
+    uint8_t *p_buffer;          // Caller provided output buffer
+    uint32_t buffer_size;       // Output buffer size
+    uint32_t length;            // Number of bytes used in output buffer
+    uint16_t count;             // Number of samples in block
+    uint32_t prev_timestamp;    // Timestamp of previous sample
+    int32_t prev_delta;         // Timestamp delta of previous sample
+    uint16_t prev_raw;          // Raw word of previous sample
+} mlx90614_encoder_t;
+
+// Block decoder state
+typedef struct mlx90614_decoder_struct
+{
+    const uint8_t *p_buffer;    // Block being decoded
+    uint32_t length;            // Block length without CRC
+    uint32_t offset;            // Current read offset
+    uint16_t count;             // Number of samples in block
+    uint16_t index;             // Index of next sample to decode
+    uint8_t i2c_addr;           // Block sensor I2C address
+    uint8_t channel;            // Block channel
+    uint32_t prev_timestamp;    // Timestamp of previous sample
+    int32_t prev_delta;         // Timestamp delta of previous sample
+    uint16_t prev_raw;          // Raw word of previous sample
+} mlx90614_decoder_t;
+
+/**
+ * @brief Start a new block in caller provided buffer.
+ *
+ * @param p_enc Pointer to encoder state.
+ * @param p_buffer Output buffer.
+ * @param buffer_size Output buffer size, MLX90614_CODEC_MIN_BLOCK_SIZE min.
+ *
+ * @return True on success, false if buffer is too small.
+ */
+bool
+mlx90614_encoder_init(mlx90614_encoder_t *p_enc, uint8_t *p_buffer,
+    uint32_t buffer_size);
+
+/**
+ * @brief Append sample to current block.
+ *
+ * All samples in a block must come from the same sensor and channel.
+ *
+ * @param p_enc Pointer to encoder state.
+ * @param p_sample Sample to be appended.
+ *
+ * @return True on success, false if block is full or sample source differs
+ * from block source. Block must be finished and a new one started then.
+ */
+bool
+mlx90614_encoder_put(mlx90614_encoder_t *p_enc,
+    const mlx90614_sample_t *p_sample);
+
+/**
+ * @brief Finish current block by writing sample count and CRC.
+ *
+ * @param p_enc Pointer to encoder state.
+ *
+ * @return Total block length in bytes, 0 if block contains no samples.
+ */
+uint32_t
+mlx90614_encoder_finish(mlx90614_encoder_t *p_enc);
+
+/**
+ * @brief Validate block and prepare it for decoding.
+ *
+ * @param p_dec Pointer to decoder state.
+ * @param p_buffer Encoded block.
+ * @param length Block length in bytes.
+ *
+ * @return True if block header and CRC are valid, false otherwise.
+ */
+bool
+mlx90614_decoder_init(mlx90614_decoder_t *p_dec, const uint8_t *p_buffer,
+    uint32_t length);
+
+/**
+ * @brief Decode next sample from block.
+ *
+ * @param p_dec Pointer to decoder state.
+ * @param p_sample Pointer to sample structure to be filled.
+ *
+ * @return True on success, false if no more samples are available or block
+ * is malformed.
+ */
+bool
+mlx90614_decoder_get(mlx90614_decoder_t *p_dec, mlx90614_sample_t *p_sample);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_CODEC_H_
+
+/* [] END OF FILE */
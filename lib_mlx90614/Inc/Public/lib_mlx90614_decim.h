@@ -0,0 +1,97 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_decim.h
+* @version 1.0.0
+*
+* @brief Oversampling and decimation of MLX90614 raw temperature streams.
+*
+* Decimator takes fast sampled raw linearized values of a single sensor
+* channel (e.g. TOBJ1 read at bus limit with short chip FIR) and outputs one
+* value per configured number of input samples. Anti-alias filter is a
+* cascaded integrator-comb (sinc^N) filter of order 1 to 3, running entirely
+* in integer arithmetic with fixed-size state.
+*
+* Output values are raw linearized units with MLX90614_DECIM_FRAC_BITS
+* fractional bits. Effective resolution reported at init assumes white input
+* noise of at least 1 LSB, which holds for short chip FIR settings.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_DECIM_H_
+#define _LIB_MLX90614_DECIM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lib_mlx90614.h"
+
+#define MLX90614_DECIM_ORDER_MAX    3
+#define MLX90614_DECIM_RATIO_MAX    256
+
+// Fractional bits of decimated output value
+#define MLX90614_DECIM_FRAC_BITS    8
+
+// Decimated output value
+typedef struct mlx90614_decimated_struct
+{
+    uint32_t timestamp_ms;      // Timestamp of last input sample
+    int32_t value;              // Raw linearized value, FRAC_BITS fraction
+    bool b_is_settled;          // Filter history fully filled
+} mlx90614_decimated_t;
+
+// Decimator state
+typedef struct mlx90614_decim_struct
+{
+    uint16_t ratio;             // Decimation ratio
+    uint8_t order;              // Filter order
+    uint16_t phase;             // Input samples since last output
+    uint8_t outputs;            // Outputs since init, saturates at order
+    uint16_t last_raw;          // Last valid input, substitutes errors
+    bool b_has_input;           // Any valid input seen
+    uint64_t gain;              // Filter DC gain, ratio^order
+    uint64_t integ[MLX90614_DECIM_ORDER_MAX];   // Integrators, wrapping
+    uint64_t comb[MLX90614_DECIM_ORDER_MAX];    // Comb delays, wrapping
+    uint16_t latency_samples;   // Group delay in input samples
+    uint16_t effective_bits_q8; // Output resolution bits, 8 fractional bits
+} mlx90614_decim_t;
+
+/**
+ * @brief Initialize decimator state.
+ *
+ * @param p_dec Pointer to decimator state.
+ * @param ratio Decimation ratio, 2 to MLX90614_DECIM_RATIO_MAX.
+ * @param order Anti-alias filter order, 1 to MLX90614_DECIM_ORDER_MAX.
+ *
+ * @return True on success, false on invalid parameters.
+ */
+bool
+mlx90614_decim_init(mlx90614_decim_t *p_dec, uint16_t ratio, uint8_t order);
+
+/**
+ * @brief Feed sample to decimator.
+ *
+ * Samples with error flag set are replaced by last valid sample to keep
+ * output rate constant.
+ *
+ * @param p_dec Pointer to decimator state.
+ * @param p_sample Input sample.
+ * @param p_output Output value, written when function returns true.
+ *
+ * @return True if output value was produced.
+ */
+bool
+mlx90614_decim_push(mlx90614_decim_t *p_dec,
+    const mlx90614_sample_t *p_sample, mlx90614_decimated_t *p_output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_DECIM_H_
+
+/* [] END OF FILE */
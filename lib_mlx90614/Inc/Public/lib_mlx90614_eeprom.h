@@ -0,0 +1,98 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_eeprom.h
+* @version 1.0.0
+*
+* @brief MLX90614 EEPROM dump, restore and clone.
+*
+* Dump reads the whole EEPROM (0x20 - 0x3F) including read-only ID and
+* factory calibration cells into a versioned blob protected by CRC-16.
+* Restore writes back only user cells (TOMAX, TOMIN, PWMCTRL, TA range, ECC,
+* CONF1 and optionally SMBus address) whose contents differ from the blob.
+* Factory calibration cells and calibration bits of CONF1 and SMBus address
+* cells are never written, so a blob from one sensor can be cloned to
+* another. Restore time is bounded by the number of differing cells.
+*
+* Blob layout (multi-byte fields little endian):
+*   [0]     Magic 0x45
+*   [1]     Format version
+*   [2-65]  EEPROM cells 0x20 - 0x3F
+*   [66-67] CRC-16 of all preceding bytes
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_EEPROM_H_
+#define _LIB_MLX90614_EEPROM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lib_mlx90614.h"
+
+#define MLX90614_EEPROM_MAGIC       0x45
+#define MLX90614_EEPROM_VERSION     1
+
+#define MLX90614_EEPROM_FIRST       0x20
+#define MLX90614_EEPROM_CELLS       32
+
+// Dump blob size
+#define MLX90614_EEPROM_DUMP_SIZE   (2 + 2 * MLX90614_EEPROM_CELLS + 2)
+
+// CONF1 bits holding factory calibration
+#define MLX90614_CONF1_FACTORY_MASK 0x7888
+
+/**
+ * @brief Dump sensor EEPROM to blob.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param p_buffer Output buffer of at least MLX90614_EEPROM_DUMP_SIZE bytes.
+ * @param buffer_size Output buffer size.
+ *
+ * @return Blob length, 0 on failure.
+ */
+uint32_t
+mlx90614_eeprom_dump(mlx90614_t *p_mlx, uint8_t *p_buffer,
+    uint32_t buffer_size);
+
+/**
+ * @brief Get EEPROM cell value from dump blob.
+ *
+ * @param p_buffer Dump blob.
+ * @param reg EEPROM register address.
+ *
+ * @return Cell value.
+ */
+uint16_t
+mlx90614_eeprom_dump_cell(const uint8_t *p_buffer, uint8_t reg);
+
+/**
+ * @brief Restore user EEPROM cells from blob.
+ *
+ * Written cells are verified by read back. Capability profile is reloaded
+ * whenever a cell was written, also when restore fails part way. New SMBus
+ * address takes effect after sensor power cycle.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param p_buffer Dump blob.
+ * @param length Dump blob length.
+ * @param b_with_address Restore SMBus address too.
+ * @param p_written Number of cells written and verified output, may be NULL.
+ *
+ * @return True on success, false on invalid blob or write failure.
+ */
+bool
+mlx90614_eeprom_restore(mlx90614_t *p_mlx, const uint8_t *p_buffer,
+    uint32_t length, bool b_with_address, uint8_t *p_written);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_EEPROM_H_
+
+/* [] END OF FILE */
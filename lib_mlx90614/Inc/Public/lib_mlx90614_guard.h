@@ -0,0 +1,140 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_guard.h
+* @version 1.0.0
+*
+* @brief Plausibility guarded temperature reads for MLX90614.
+*
+* Guard keeps a cheap plausibility model per temperature channel and issues
+* a confirming re-read only for implausible samples, instead of reading every
+* channel twice. Sample is implausible when:
+*
+*  - error flag is set,
+*  - value is outside sensor TA or TOBJ range from capability profile,
+*    widened by MLX90614_GUARD_RANGE_MARGIN,
+*  - value changed faster than allowed since last accepted value of the
+*    channel. Object channels use configured rate, ambient channel uses
+*    MLX90614_GUARD_TA_RATE as die temperature cannot change quickly,
+*  - object value differs from last accepted ambient value by more than
+*    max_ta_delta, widened by MLX90614_GUARD_RANGE_MARGIN and by ambient
+*    drift possible since ambient was read. Limit defaults to span of
+*    sensor TOBJ range and may be narrowed after enable when the
+*    application knows objects stay near ambient temperature.
+*
+* If re-read is plausible it replaces the suspicious sample (glitch
+* rejected). If it agrees with the suspicious sample within noise level, the
+* change is real and sample is accepted (confirmed). Otherwise read fails.
+*
+* Once enabled, guard is applied to all library temperature reads.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_GUARD_H_
+#define _LIB_MLX90614_GUARD_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lib_mlx90614.h"
+
+// Agreement tolerance and rate slack [raw LSB], 0.5 K
+#define MLX90614_GUARD_NOISE_LSB        25
+
+// Ambient temperature rate limit [raw LSB/s], 2 K/s
+#define MLX90614_GUARD_TA_RATE          100
+
+// Margin around profile temperature ranges [raw LSB], 10 K
+#define MLX90614_GUARD_RANGE_MARGIN     500
+
+// Guard statistics
+typedef struct mlx90614_guard_stats_struct
+{
+    uint32_t reads;             // Guarded reads
+    uint32_t rereads;           // Confirming re-reads issued
+    uint32_t confirmed;         // Suspicious samples confirmed by re-read
+    uint32_t rejected;          // Suspicious samples replaced by re-read
+    uint32_t unresolved;        // Reads failed due to disagreeing re-read
+} mlx90614_guard_stats_t;
+
+// Guard state
+typedef struct mlx90614_guard_struct
+{
+    uint16_t max_rate;          // Object rate limit [raw LSB/s]
+    uint16_t max_ta_delta;      // Object to ambient difference limit [raw LSB]
+    bool b_has_last[3];         // Channel has accepted value
+    uint16_t last[3];           // Last accepted value per channel
+    uint32_t last_ms[3];        // Last accepted value time per channel
+    mlx90614_guard_stats_t stats;
+} mlx90614_guard_t;
+
+/**
+ * @brief Enable guarded reads.
+ *
+ * Object to ambient difference limit is set to span of sensor TOBJ range.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param max_rate Object temperature rate limit [raw LSB/s].
+ *
+ * @return True on success, false on memory shortage.
+ */
+bool
+mlx90614_guard_enable(mlx90614_t *p_mlx, uint16_t max_rate);
+
+/**
+ * @brief Disable guarded reads.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ */
+void
+mlx90614_guard_disable(mlx90614_t *p_mlx);
+
+/**
+ * @brief Get guard statistics.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ *
+ * @return Pointer to statistics, NULL if guard is not enabled.
+ */
+const mlx90614_guard_stats_t
+*mlx90614_guard_get_stats(mlx90614_t *p_mlx);
+
+/**
+ * @brief Check sample plausibility.
+ *
+ * @param p_guard Pointer to guard state.
+ * @param p_profile Sensor capability profile.
+ * @param reg Temperature RAM register.
+ * @param raw Raw register value.
+ * @param time_ms Sample time.
+ *
+ * @return True if sample is plausible.
+ */
+bool
+mlx90614_guard_check(const mlx90614_guard_t *p_guard,
+    const mlx90614_profile_t *p_profile, uint8_t reg, uint16_t raw,
+    uint32_t time_ms);
+
+/**
+ * @brief Read temperature register with plausibility guard.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor, guard enabled.
+ * @param reg Temperature RAM register.
+ * @param p_raw Raw register value output.
+ *
+ * @return True on success, false on bus error or unresolved suspicion.
+ */
+bool
+mlx90614_guard_read(mlx90614_t *p_mlx, uint8_t reg, int16_t *p_raw);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_GUARD_H_
+
+/* [] END OF FILE */
@@ -0,0 +1,146 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_hub.h
+* @version 1.0.0
+*
+* @brief Raw sample distribution to consumers with per-consumer units.
+*
+* Hub collects raw linearized samples, read once from the bus, and delivers
+* them in batches to subscribed consumers. Each consumer declares its own
+* temperature unit, channel set and optionally sensor address. Conversion is
+* done once per consumer batch at delivery, so a shared sensor costs one bus
+* read no matter how many units are in use, and consumers do not depend on
+* descriptor temperature unit.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_HUB_H_
+#define _LIB_MLX90614_HUB_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lib_mlx90614.h"
+
+#define MLX90614_HUB_MAX_CONSUMERS  8
+#define MLX90614_HUB_BATCH_SIZE     32
+
+/**
+ * @brief Consumer delivery function.
+ *
+ * @param p_context Consumer context.
+ * @param p_samples Raw samples matching consumer filter.
+ * @param p_values Sample values in consumer unit, MLX90614_TEMP_ERROR for
+ * samples with error flag set.
+ * @param count Number of samples.
+ */
+typedef void (*mlx90614_consumer_t)(void *p_context,
+    const mlx90614_sample_t *p_samples, const float *p_values, uint32_t count);
+
+// Consumer subscription
+typedef struct mlx90614_subscription_struct
+{
+    mlx90614_consumer_t consumer;   // Delivery function, NULL if unused
+    void *p_context;                // Delivery function context
+    mlx_temperature_unit unit;      // Consumer temperature unit
+    uint8_t channels;               // MLX90614_CH_* channels of interest
+    uint8_t i2c_addr;               // Sensor address, 0 for all sensors
+} mlx90614_subscription_t;
+
+// Sample hub
+typedef struct mlx90614_hub_struct
+{
+    mlx90614_subscription_t subs[MLX90614_HUB_MAX_CONSUMERS];
+    uint32_t count;                 // Number of pending samples
+    mlx90614_sample_t pending[MLX90614_HUB_BATCH_SIZE];
+} mlx90614_hub_t;
+
+/**
+ * @brief Initialize sample hub.
+ *
+ * @param p_hub Pointer to sample hub.
+ */
+void
+mlx90614_hub_init(mlx90614_hub_t *p_hub);
+
+/**
+ * @brief Subscribe consumer.
+ *
+ * @param p_hub Pointer to sample hub.
+ * @param unit Consumer temperature unit.
+ * @param channels MLX90614_CH_* channels of interest.
+ * @param i2c_addr Sensor address, 0 for all sensors.
+ * @param consumer Delivery function.
+ * @param p_context Delivery function context.
+ *
+ * @return Subscription ID, -1 if there is no free slot.
+ */
+int
+mlx90614_hub_subscribe(mlx90614_hub_t *p_hub, mlx_temperature_unit unit,
+    uint8_t channels, uint8_t i2c_addr, mlx90614_consumer_t consumer,
+    void *p_context);
+
+/**
+ * @brief Unsubscribe consumer.
+ *
+ * @param p_hub Pointer to sample hub.
+ * @param id Subscription ID.
+ */
+void
+mlx90614_hub_unsubscribe(mlx90614_hub_t *p_hub, int id);
+
+/**
+ * @brief Get channels needed by consumers of sensor.
+ *
+ * @param p_hub Pointer to sample hub.
+ * @param i2c_addr Sensor address.
+ *
+ * @return MLX90614_CH_* channels subscribed for sensor.
+ */
+uint8_t
+mlx90614_hub_channels(mlx90614_hub_t *p_hub, uint8_t i2c_addr);
+
+/**
+ * @brief Queue raw samples for delivery.
+ *
+ * Pending samples are delivered when batch is full.
+ *
+ * @param p_hub Pointer to sample hub.
+ * @param p_samples Raw samples.
+ * @param count Number of samples.
+ */
+void
+mlx90614_hub_push(mlx90614_hub_t *p_hub, const mlx90614_sample_t *p_samples,
+    uint32_t count);
+
+/**
+ * @brief Read channels needed by consumers from sensor once and queue them.
+ *
+ * @param p_hub Pointer to sample hub.
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ *
+ * @return Number of samples read.
+ */
+uint8_t
+mlx90614_hub_poll(mlx90614_hub_t *p_hub, mlx90614_t *p_mlx);
+
+/**
+ * @brief Deliver pending samples to consumers.
+ *
+ * @param p_hub Pointer to sample hub.
+ */
+void
+mlx90614_hub_flush(mlx90614_hub_t *p_hub);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_HUB_H_
+
+/* [] END OF FILE */
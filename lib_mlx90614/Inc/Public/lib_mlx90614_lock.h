@@ -0,0 +1,130 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_lock.h
+* @version 1.0.0
+*
+* @brief Thread-safe bus access for MLX90614 sensors.
+*
+* Bus lock is shared by all descriptors of one I2C bus and attached to them.
+* Library functions acquire it around every transaction and around each
+* multi-transaction sequence (ID and profile reads, read-modify-write of
+* EEPROM cells, guarded re-reads, dump and restore), so transactions of
+* different threads never interleave within a sequence. Descriptors without
+* a lock attached are not synchronized and pay no locking cost.
+*
+* Outermost acquire also reserves the sensor for the sequence. EEPROM erase
+* and write waits release the bus while keeping the reservation, so other
+* threads keep reading other sensors during the busy wait and no lock is held
+* across nanosleep, while the sensor being written stays untouched until its
+* sequence completes. Resuming sequences take the bus before new ones, so
+* EEPROM work is not starved by busy readers.
+*
+* Lock is recursive for the owning thread. A sequence must not nest acquires
+* of different sensors, which would bypass reservation of the inner one.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_LOCK_H_
+#define _LIB_MLX90614_LOCK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "lib_mlx90614.h"
+
+// Bus lock
+typedef struct mlx90614_lock_struct
+{
+    pthread_mutex_t mutex;      // Guards fields below, held only briefly
+    pthread_cond_t cond;        // Signalled when bus or sensor is released
+    pthread_t owner;            // Owning thread
+    uint32_t depth;             // Recursion depth of owner, 0 if bus is free
+    uint8_t owner_addr;         // Sensor reserved by owner sequence
+    uint32_t resuming;          // Suspended sequences waiting for bus
+    uint32_t reserved[4];       // Reserved sensors, bit per address
+} mlx90614_lock_t;
+
+// Suspended sequence
+typedef struct mlx90614_lock_state_struct
+{
+    uint32_t depth;             // Recursion depth of suspended sequence
+    uint8_t owner_addr;         // Sensor reserved by suspended sequence
+} mlx90614_lock_state_t;
+
+/**
+ * @brief Initialize bus lock.
+ *
+ * @param p_lock Pointer to bus lock.
+ *
+ * @return True on success.
+ */
+bool
+mlx90614_lock_init(mlx90614_lock_t *p_lock);
+
+/**
+ * @brief Destroy bus lock, no descriptor may use it.
+ *
+ * @param p_lock Pointer to bus lock.
+ */
+void
+mlx90614_lock_destroy(mlx90614_lock_t *p_lock);
+
+/**
+ * @brief Attach bus lock to sensor.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param p_lock Pointer to lock of sensor bus, NULL to detach.
+ */
+void
+mlx90614_lock_attach(mlx90614_t *p_mlx, mlx90614_lock_t *p_lock);
+
+/**
+ * @brief Acquire bus for sequence on sensor.
+ *
+ * Waits until bus is free and sensor is not reserved by another sequence.
+ * No-op for descriptor without lock.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ */
+void
+mlx90614_lock_acquire(mlx90614_t *p_mlx);
+
+/**
+ * @brief Release bus, sensor reservation ends with outermost release.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ */
+void
+mlx90614_lock_release(mlx90614_t *p_mlx);
+
+/**
+ * @brief Release bus for a wait inside sequence, keep sensor reserved.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param p_state Suspended sequence output.
+ */
+void
+mlx90614_lock_suspend(mlx90614_t *p_mlx, mlx90614_lock_state_t *p_state);
+
+/**
+ * @brief Reacquire bus for suspended sequence.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param p_state Suspended sequence.
+ */
+void
+mlx90614_lock_resume(mlx90614_t *p_mlx, const mlx90614_lock_state_t *p_state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_LOCK_H_
+
+/* [] END OF FILE */
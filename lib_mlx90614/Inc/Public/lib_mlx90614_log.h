@@ -0,0 +1,158 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_log.h
+* @version 1.0.0
+*
+* @brief Crash-safe persistent MLX90614 sample log.
+*
+* Samples are stored in a file as an append-only ring of fixed-size records.
+* Each record carries a sequence number and CRC-16, so records torn by power
+* failure are detected and skipped. On open the file is scanned to the last
+* valid record and appending continues from there.
+*
+* Appended samples are collected in a RAM batch and written to file with one
+* write call per batch. File sync is limited to one per configured interval
+* to bound the flash write rate.
+*
+* Define MLX90614_LOG_MMAP to read records through a memory mapping of the
+* log file (Linux hosts) instead of read calls.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_LOG_H_
+#define _LIB_MLX90614_LOG_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "lib_mlx90614.h"
+
+// Uncomment line below to read records through memory mapping
+//#define MLX90614_LOG_MMAP
+
+#define MLX90614_LOG_MAGIC          0x4C584C4D  // "MLXL"
+#define MLX90614_LOG_VERSION        1
+
+// Number of records collected in RAM before being written to file
+#define MLX90614_LOG_BATCH_SIZE     32
+
+// Log record as stored in file
+typedef struct mlx90614_log_record_struct
+{
+    uint32_t sequence;          // Record sequence number, 0 marks empty slot
+    uint32_t timestamp_ms;      // Sample timestamp
+    uint16_t raw;               // Sample raw word
+    uint8_t i2c_addr;           // Sample sensor I2C address
+    uint8_t channel;            // Sample channel
+    uint16_t reserved;          // Always zero
+    uint16_t crc;               // CRC-16 of all preceding record bytes
+} mlx90614_log_record_t;
+
+// Log descriptor
+typedef struct mlx90614_log_struct
+{
+    int fd;                         // Log file descriptor
+    uint32_t capacity;              // Number of record slots in file
+    uint32_t first_seq;             // Sequence number of oldest record
+    uint32_t next_seq;              // Sequence number of next record
+    uint32_t sync_interval_ms;      // Minimum time between file syncs
+    uint32_t last_sync_ms;          // Time of last file sync
+    bool b_is_sync_pending;         // Written records not yet synced
+    uint32_t batch_count;           // Number of records in RAM batch
+    mlx90614_log_record_t batch[MLX90614_LOG_BATCH_SIZE];
+#   ifdef MLX90614_LOG_MMAP
+    const uint8_t *p_map;           // Read-only mapping of log file
+    size_t map_size;                // Mapping size
+#   endif
+} mlx90614_log_t;
+
+/**
+ * @brief Open sample log, recovering its state from file contents.
+ *
+ * File not containing a valid log with matching capacity is reinitialized.
+ *
+ * @param fd Log file descriptor opened for reading and writing.
+ * @param capacity Number of record slots.
+ * @param sync_interval_ms Minimum time between file syncs.
+ *
+ * @return Pointer to log descriptor, NULL on failure.
+ */
+mlx90614_log_t
+*mlx90614_log_open(int fd, uint32_t capacity, uint32_t sync_interval_ms);
+
+/**
+ * @brief Flush pending records and free log descriptor.
+ *
+ * File descriptor is not closed.
+ *
+ * @param p_log Pointer to log descriptor.
+ */
+void
+mlx90614_log_close(mlx90614_log_t *p_log);
+
+/**
+ * @brief Append sample to log.
+ *
+ * Sample is stored in RAM batch. A full batch is written to file.
+ *
+ * @param p_log Pointer to log descriptor.
+ * @param p_sample Sample to be appended.
+ *
+ * @return Sequence number assigned to sample, 0 on write failure.
+ */
+uint32_t
+mlx90614_log_append(mlx90614_log_t *p_log, const mlx90614_sample_t *p_sample);
+
+/**
+ * @brief Write RAM batch to file and sync it.
+ *
+ * @param p_log Pointer to log descriptor.
+ * @param b_force Sync even if sync interval did not elapse yet.
+ *
+ * @return True on success, false on failure.
+ */
+bool
+mlx90614_log_flush(mlx90614_log_t *p_log, bool b_force);
+
+/**
+ * @brief Find sequence number of first record not older than timestamp.
+ *
+ * @param p_log Pointer to log descriptor.
+ * @param timestamp_ms Timestamp to look for.
+ *
+ * @return Sequence number of found record, next sequence number if all
+ * records are older.
+ */
+uint32_t
+mlx90614_log_find(mlx90614_log_t *p_log, uint32_t timestamp_ms);
+
+/**
+ * @brief Read range of samples from log.
+ *
+ * Records which fail CRC check are skipped.
+ *
+ * @param p_log Pointer to log descriptor.
+ * @param p_seq Pointer to sequence number to start from. Updated to
+ * sequence number to continue reading from.
+ * @param p_samples Output sample buffer.
+ * @param max_count Output sample buffer size.
+ *
+ * @return Number of samples read.
+ */
+uint32_t
+mlx90614_log_read(mlx90614_log_t *p_log, uint32_t *p_seq,
+    mlx90614_sample_t *p_samples, uint32_t max_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_LOG_H_
+
+/* [] END OF FILE */
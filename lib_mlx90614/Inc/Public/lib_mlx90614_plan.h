@@ -0,0 +1,110 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_plan.h
+* @version 1.0.0
+*
+* @brief SMBus utilization planner for MLX90614 sensor buses.
+*
+* Planner checks whether a set of sensors read at given rates fits a bus.
+* Each channel read is one SMBus read word transaction with PEC as done by
+* the library (address, command, repeated start, address, 2 data bytes,
+* PEC), i.e. MLX90614_PLAN_READ_BITS bit periods plus measured or estimated
+* per-transaction software overhead. Retries are modelled as proportional
+* extra transactions, EEPROM work and other traffic as reserved capacity.
+*
+* Sensors are scheduled rate-monotonic (faster sensors first) with
+* non-preemptive transactions. Worst-case latency from sample release to
+* read completion is found by response time analysis. Suggested schedule
+* staggers sensor read offsets within their periods so reads do not collide
+* when periods are harmonic.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_PLAN_H_
+#define _LIB_MLX90614_PLAN_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lib_mlx90614.h"
+
+// Bit periods of read word transaction including start, repeated start,
+// stop conditions
+#define MLX90614_PLAN_READ_BITS     57
+
+#define MLX90614_PLAN_MAX_SENSORS   127
+
+// Bus parameters
+typedef struct mlx90614_plan_bus_struct
+{
+    uint32_t bus_speed_hz;      // SMBus clock
+    uint32_t overhead_us;       // Per-transaction software overhead
+    uint16_t retry_permille;    // Expected retried transactions
+    uint16_t reserve_permille;  // Capacity reserved for EEPROM work etc.
+} mlx90614_plan_bus_t;
+
+// Planned sensor
+typedef struct mlx90614_plan_sensor_struct
+{
+    uint8_t i2c_addr;           // Sensor address
+    uint8_t channels;           // MLX90614_CH_* channels read per sample
+    float rate_hz;              // Sample rate
+} mlx90614_plan_sensor_t;
+
+// Planner result of sensor
+typedef struct mlx90614_plan_result_struct
+{
+    uint32_t period_us;         // Sample period
+    uint32_t duration_us;       // Bus time per sample, with retries
+    uint32_t offset_us;         // Suggested read offset within period
+    uint32_t latency_us;        // Worst-case release to completion latency
+    float max_rate_hz;          // Highest rate fitting with others unchanged
+    uint8_t priority;           // Schedule priority, 0 = highest
+} mlx90614_plan_result_t;
+
+// Planner summary
+typedef struct mlx90614_plan_summary_struct
+{
+    uint16_t utilization_permille;  // Bus utilization without reserve
+    float rate_scale_max;           // Highest common rate scale that fits
+    bool b_is_feasible;             // All sensors fit, latencies in period
+} mlx90614_plan_summary_t;
+
+/**
+ * @brief Compute bus time of single channel read.
+ *
+ * @param p_bus Bus parameters.
+ *
+ * @return Transaction time in microseconds.
+ */
+uint32_t
+mlx90614_plan_transaction_us(const mlx90614_plan_bus_t *p_bus);
+
+/**
+ * @brief Compute bus plan.
+ *
+ * @param p_bus Bus parameters.
+ * @param p_sensors Planned sensors.
+ * @param count Number of sensors.
+ * @param p_results Per-sensor results output, count entries.
+ * @param p_summary Summary output.
+ *
+ * @return True if plan was computed, false on invalid input.
+ */
+bool
+mlx90614_plan_compute(const mlx90614_plan_bus_t *p_bus,
+    const mlx90614_plan_sensor_t *p_sensors, uint8_t count,
+    mlx90614_plan_result_t *p_results, mlx90614_plan_summary_t *p_summary);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_PLAN_H_
+
+/* [] END OF FILE */
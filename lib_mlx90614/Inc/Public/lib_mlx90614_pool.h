@@ -0,0 +1,198 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_pool.h
+* @version 1.0.0
+*
+* @brief Work-stealing post-processing pool for MLX90614 sample batches.
+*
+* Acquisition submits per-sensor sample batches and returns immediately; the
+* batch is copied to a preallocated slot, so submission never allocates or
+* waits for processing. Worker threads convert batches to the pool unit into
+* their own preallocated buffers and run the processing stages in order.
+*
+* Batches of one sensor key form a strand. A strand with queued batches is
+* scheduled on one worker deque at a time and processed by a single worker
+* until empty, which keeps per-sensor ordering while different sensors are
+* processed in parallel. Idle workers steal strands from the other end of
+* busy workers' deques.
+*
+* Stages run concurrently on batches of different strands, so every stage
+* function and its context must be thread-safe. Only batches of one sensor
+* key are passed to a stage one at a time.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_POOL_H_
+#define _LIB_MLX90614_POOL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_hub.h"
+
+#define MLX90614_POOL_BATCH_SIZE    32
+#define MLX90614_POOL_MAX_STAGES    4
+
+// Sensor key of bus index and sensor address
+#define MLX90614_POOL_KEY(bus, addr)    (((uint32_t)(bus) << 8) | (addr))
+
+// Worker statistics
+typedef struct mlx90614_pool_stats_struct
+{
+    uint32_t batches;           // Processed batches
+    uint32_t samples;           // Processed samples
+    uint32_t steals;            // Strands stolen from other workers
+} mlx90614_pool_stats_t;
+
+// Queued sample batch
+typedef struct mlx90614_pool_batch_struct
+{
+    uint32_t next;              // Next batch of strand or free list
+    uint32_t count;             // Number of samples
+    mlx90614_sample_t samples[MLX90614_POOL_BATCH_SIZE];
+} mlx90614_pool_batch_t;
+
+// Per-sensor batch queue
+typedef struct mlx90614_pool_strand_struct
+{
+    uint32_t key;               // Sensor key
+    uint32_t head;              // First queued batch
+    uint32_t tail;              // Last queued batch
+    bool b_is_used;             // Key assigned
+    bool b_is_scheduled;        // In deque or being processed
+} mlx90614_pool_strand_t;
+
+struct mlx90614_pool_struct;
+
+// Pool worker
+typedef struct mlx90614_pool_worker_struct
+{
+    struct mlx90614_pool_struct *p_pool;    // Owning pool
+    pthread_t thread;           // Worker thread
+    pthread_mutex_t lock;       // Guards deque and statistics
+    uint32_t *p_deque;          // Scheduled strands
+    uint32_t top;               // Steal end
+    uint32_t bottom;            // Owner end
+    mlx90614_pool_stats_t stats;    // Worker statistics
+    float values[MLX90614_POOL_BATCH_SIZE]; // Converted batch values
+} mlx90614_pool_worker_t;
+
+// Post-processing pool
+typedef struct mlx90614_pool_struct
+{
+    mlx_temperature_unit unit;  // Unit of values passed to stages
+    uint8_t worker_count;       // Number of workers
+    uint8_t stage_count;        // Number of stages
+    uint32_t strand_count;      // Strand table size
+    uint32_t batch_count;       // Number of batch slots
+    mlx90614_consumer_t stages[MLX90614_POOL_MAX_STAGES];
+    void *p_contexts[MLX90614_POOL_MAX_STAGES];
+    pthread_mutex_t strand_lock;    // Guards strands, batches, free list
+    uint32_t free_head;         // First free batch
+    uint32_t rejected;          // Samples rejected on full pool
+    pthread_mutex_t idle_lock;  // Guards counters and run flag below
+    pthread_cond_t work_cond;   // Signalled when strand is scheduled
+    pthread_cond_t drain_cond;  // Signalled when no batch is in flight
+    uint32_t ready;             // Strands waiting in deques
+    uint32_t in_flight;         // Batches queued or being processed
+    bool b_is_running;          // Workers keep running
+    bool b_is_started;          // Workers started
+    mlx90614_pool_worker_t *p_workers;  // Workers
+    mlx90614_pool_strand_t *p_strands;  // Strand hash table
+    mlx90614_pool_batch_t *p_batches;   // Batch slots
+} mlx90614_pool_t;
+
+/**
+ * @brief Create post-processing pool.
+ *
+ * @param worker_count Number of worker threads.
+ * @param max_sensors Maximum number of distinct sensor keys.
+ * @param batch_count Number of preallocated batch slots.
+ * @param unit Temperature unit of values passed to stages.
+ *
+ * @return Pointer to pool, NULL on failure.
+ */
+mlx90614_pool_t
+*mlx90614_pool_open(uint8_t worker_count, uint16_t max_sensors,
+    uint32_t batch_count, mlx_temperature_unit unit);
+
+/**
+ * @brief Process queued batches, stop workers and free pool.
+ *
+ * @param p_pool Pointer to pool.
+ */
+void
+mlx90614_pool_close(mlx90614_pool_t *p_pool);
+
+/**
+ * @brief Append processing stage, before start.
+ *
+ * Stage is called from all workers concurrently and must be thread-safe.
+ *
+ * @param p_pool Pointer to pool.
+ * @param stage Stage function, called with converted batch.
+ * @param p_context Stage context.
+ *
+ * @return True if stage was added.
+ */
+bool
+mlx90614_pool_add_stage(mlx90614_pool_t *p_pool, mlx90614_consumer_t stage,
+    void *p_context);
+
+/**
+ * @brief Start workers.
+ *
+ * @param p_pool Pointer to pool.
+ *
+ * @return True if all workers were started.
+ */
+bool
+mlx90614_pool_start(mlx90614_pool_t *p_pool);
+
+/**
+ * @brief Submit samples of one sensor, split to batches.
+ *
+ * @param p_pool Pointer to pool.
+ * @param key Sensor key, see MLX90614_POOL_KEY.
+ * @param p_samples Samples in acquisition order.
+ * @param count Number of samples.
+ *
+ * @return True if all samples were queued, false if pool is full.
+ */
+bool
+mlx90614_pool_submit(mlx90614_pool_t *p_pool, uint32_t key,
+    const mlx90614_sample_t *p_samples, uint32_t count);
+
+/**
+ * @brief Wait until all submitted batches are processed.
+ *
+ * @param p_pool Pointer to pool.
+ */
+void
+mlx90614_pool_drain(mlx90614_pool_t *p_pool);
+
+/**
+ * @brief Get worker statistics.
+ *
+ * @param p_pool Pointer to pool.
+ * @param worker Worker index.
+ * @param p_stats Statistics output.
+ */
+void
+mlx90614_pool_get_stats(mlx90614_pool_t *p_pool, uint8_t worker,
+    mlx90614_pool_stats_t *p_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_POOL_H_
+
+/* [] END OF FILE */
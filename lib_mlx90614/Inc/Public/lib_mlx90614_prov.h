@@ -0,0 +1,154 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_prov.h
+* @version 1.0.0
+*
+* @brief Bulk SMBus address provisioning of MLX90614 sensors.
+*
+* New sensors respond at MLX90614_I2C_ADDRESS. Provisioning workflow assigns
+* addresses from a plan to sensors attached one at a time to a provisioning
+* bus:
+*
+*  1. mlx90614_prov_assign() polls default address. Newly attached sensor
+*     gets next free plan address written to EEPROM. Assignment is verified
+*     through SMBus address 0x00, which proves a single sensor is attached and
+*     reads back its address cell. Operator can detach the sensor as soon as
+*     MLX_PROV_ASSIGNED is returned.
+*  2. After power cycle of provisioned sensors, mlx90614_prov_verify() scans
+*     planned addresses and checks device IDs of responding sensors.
+*
+* Every step is recorded in a persistent log keyed by device ID, so an
+* interrupted run resumes without assigning an address twice. Sensors found
+* with an address already written but not logged are adopted.
+*
+* Replayed records are checked before they are adopted: address must be in
+* plan and SMBus range, state must be a logged state, device ID must not be
+* blank, a sensor must not hold two addresses and state of an address must
+* not go back or change sensor. Inconsistent records are ignored, so their
+* sensors are handled by device state found on the bus.
+*
+* Log record layout (16 bytes, multi-byte fields little endian):
+*   [0]     Magic 0x50
+*   [1]     State (mlx_prov_state)
+*   [2]     Address
+*   [3]     Reserved
+*   [4-11]  Device ID words 1 - 4
+*   [12-13] CRC-16 of preceding bytes
+*   [14-15] Reserved
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_PROV_H_
+#define _LIB_MLX90614_PROV_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lib_mlx90614.h"
+
+#define MLX90614_PROV_RECORD_SIZE   16
+#define MLX90614_PROV_MAGIC         0x50
+
+// Provisioning state of sensor
+typedef enum {
+    MLX_PROV_STATE_NONE,        // Not provisioned
+    MLX_PROV_STATE_INTENT,      // Address reserved, EEPROM write started
+    MLX_PROV_STATE_ASSIGNED,    // Address written and verified by read back
+    MLX_PROV_STATE_VERIFIED     // Sensor found at address after power cycle
+} mlx_prov_state;
+
+// Assignment step result
+typedef enum {
+    MLX_PROV_IDLE,              // No sensor at default address
+    MLX_PROV_ASSIGNED,          // Address assigned, sensor can be detached
+    MLX_PROV_KNOWN,             // Sensor already provisioned earlier
+    MLX_PROV_PLAN_FULL,         // No free plan address left
+    MLX_PROV_FAILED             // Bus, EEPROM or log failure
+} mlx_prov_result;
+
+// Provisioning entry
+typedef struct mlx90614_prov_entry_struct
+{
+    uint16_t device_id[4];      // Sensor device ID
+    uint8_t address;            // Assigned address
+    mlx_prov_state state;       // Provisioning state
+} mlx90614_prov_entry_t;
+
+// Provisioning session
+typedef struct mlx90614_prov_struct
+{
+    int log_fd;                 // Log file descriptor
+    int i2c_fd;                 // Provisioning bus file descriptor
+    uint32_t log_records;       // Valid records in log
+    uint8_t plan_count;         // Number of plan addresses
+    uint8_t *p_plan;            // Plan addresses
+    mlx90614_prov_entry_t *p_entries;   // Entries, one per plan address
+} mlx90614_prov_t;
+
+/**
+ * @brief Open provisioning session, replay log of previous runs.
+ *
+ * @param log_fd Log file descriptor, opened read-write.
+ * @param i2c_fd Provisioning bus file descriptor.
+ * @param p_plan Planned addresses, in assignment order.
+ * @param plan_count Number of planned addresses.
+ *
+ * @return Pointer to provisioning session, NULL on failure.
+ */
+mlx90614_prov_t
+*mlx90614_prov_open(int log_fd, int i2c_fd, const uint8_t *p_plan,
+    uint8_t plan_count);
+
+/**
+ * @brief Close provisioning session.
+ *
+ * @param p_prov Pointer to provisioning session.
+ */
+void
+mlx90614_prov_close(mlx90614_prov_t *p_prov);
+
+/**
+ * @brief Assign address to sensor attached at default address.
+ *
+ * @param p_prov Pointer to provisioning session.
+ * @param p_address Assigned address output, may be NULL.
+ *
+ * @return Assignment step result.
+ */
+mlx_prov_result
+mlx90614_prov_assign(mlx90614_prov_t *p_prov, uint8_t *p_address);
+
+/**
+ * @brief Verify assigned sensors after power cycle.
+ *
+ * @param p_prov Pointer to provisioning session.
+ * @param i2c_fd File descriptor of bus the sensors are attached to.
+ *
+ * @return Number of assigned sensors still not verified.
+ */
+uint8_t
+mlx90614_prov_verify(mlx90614_prov_t *p_prov, int i2c_fd);
+
+/**
+ * @brief Get provisioning entry of planned address.
+ *
+ * @param p_prov Pointer to provisioning session.
+ * @param address Planned address.
+ *
+ * @return Pointer to entry, NULL if address is not in plan.
+ */
+const mlx90614_prov_entry_t
+*mlx90614_prov_get_entry(mlx90614_prov_t *p_prov, uint8_t address);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_PROV_H_
+
+/* [] END OF FILE */
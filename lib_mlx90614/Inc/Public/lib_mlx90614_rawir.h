@@ -0,0 +1,153 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_rawir.h
+* @version 1.0.0
+*
+* @brief Host-side object temperature computation from MLX90614 raw IR data.
+*
+* Object temperature is computed from raw IR channel data (RAWIR1, RAWIR2)
+* and ambient temperature using radiation balance model
+*
+*   Tobj^4 = Ta^4 + c0 + c1 * IR + c2 * IR * (Ta - Ta_ref)
+*
+* with per-device coefficients. Coefficients are fitted by least squares
+* against sensor's own linearized TOBJ output during a calibration pass,
+* which should cover the object temperature range of interest. When ambient
+* temperature does not vary during the pass, c2 is left at zero.
+*
+* Result is not quantized to 0.02 K and does not depend on sensor FIR/IIR
+* filter settling. Buffer evaluation uses fixed iteration count fourth root
+* without branches or libm calls so the loop is suitable for compiler
+* auto-vectorization.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_RAWIR_H_
+#define _LIB_MLX90614_RAWIR_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lib_mlx90614.h"
+
+// Reference ambient temperature of coefficient c2 [K]
+#define MLX90614_RAWIR_TA_REF       298.15F
+
+// Model coefficients of single IR zone
+typedef struct mlx90614_rawir_coef_struct
+{
+    float c0;                   // Offset [K^4]
+    float c1;                   // IR gain [K^4 / LSB]
+    float c2;                   // IR gain ambient dependence [K^4 / LSB / K]
+} mlx90614_rawir_coef_t;
+
+// Least squares fit accumulator
+typedef struct mlx90614_rawir_fit_struct
+{
+    uint32_t count;             // Number of accumulated points
+    double sum_ff[3][3];        // Sums of regressor products
+    double sum_fy[3];           // Sums of regressor and target products
+    float ta_min;               // Lowest ambient temperature seen [K]
+    float ta_max;               // Highest ambient temperature seen [K]
+} mlx90614_rawir_fit_t;
+
+/**
+ * @brief Convert raw IR register value to signed value.
+ *
+ * Raw IR data is in sign (bit 15) and magnitude (bits 14..0) format.
+ *
+ * @param raw Raw IR register value.
+ *
+ * @return Signed raw IR value.
+ */
+int16_t
+mlx90614_rawir_to_signed(uint16_t raw);
+
+/**
+ * @brief Initialize fit accumulator.
+ *
+ * @param p_fit Pointer to fit accumulator.
+ */
+void
+mlx90614_rawir_fit_init(mlx90614_rawir_fit_t *p_fit);
+
+/**
+ * @brief Add calibration point to fit accumulator.
+ *
+ * Points with error flag set on TA or TOBJ are ignored.
+ *
+ * @param p_fit Pointer to fit accumulator.
+ * @param ir Signed raw IR value.
+ * @param ta Raw linearized ambient temperature.
+ * @param tobj Raw linearized object temperature of the same zone.
+ *
+ * @return True if point was accumulated.
+ */
+bool
+mlx90614_rawir_fit_add(mlx90614_rawir_fit_t *p_fit, int16_t ir, uint16_t ta,
+    uint16_t tobj);
+
+/**
+ * @brief Read calibration point from sensor and add it to fit accumulator.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param zone IR zone, 1 or 2.
+ * @param p_fit Pointer to fit accumulator.
+ *
+ * @return True if point was read and accumulated.
+ */
+bool
+mlx90614_rawir_fit_read(mlx90614_t *p_mlx, uint8_t zone,
+    mlx90614_rawir_fit_t *p_fit);
+
+/**
+ * @brief Solve accumulated fit for model coefficients.
+ *
+ * @param p_fit Pointer to fit accumulator.
+ * @param p_coef Output coefficients.
+ *
+ * @return True on success, false if points do not determine the model.
+ */
+bool
+mlx90614_rawir_fit_solve(const mlx90614_rawir_fit_t *p_fit,
+    mlx90614_rawir_coef_t *p_coef);
+
+/**
+ * @brief Compute object temperatures from raw IR and ambient buffers.
+ *
+ * @param p_coef Pointer to zone coefficients.
+ * @param p_ir Signed raw IR values.
+ * @param p_ta Raw linearized ambient temperatures.
+ * @param p_tobj Output object temperatures [K].
+ * @param count Number of values.
+ */
+void
+mlx90614_rawir_eval(const mlx90614_rawir_coef_t *p_coef,
+    const int16_t *p_ir, const uint16_t *p_ta, float *p_tobj, uint32_t count);
+
+/**
+ * @brief Read raw IR and ambient data and compute object temperature.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param zone IR zone, 1 or 2.
+ * @param p_coef Pointer to zone coefficients.
+ *
+ * @return Object temperature in descriptor temperature unit, linearized unit
+ * is reported as fractional value. MLX90614_TEMP_ERROR on failure.
+ */
+float
+mlx90614_rawir_get_temperature(mlx90614_t *p_mlx, uint8_t zone,
+    const mlx90614_rawir_coef_t *p_coef);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_RAWIR_H_
+
+/* [] END OF FILE */
@@ -0,0 +1,96 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_resample.h
+* @version 1.0.0
+*
+* @brief Fixed-rate resampling of jittery MLX90614 sample streams.
+*
+* Resampler takes timestamped samples of a single sensor channel and emits
+* values on an exact time grid (multiples of the output period) using linear
+* or cubic Hermite interpolation. Linear interpolation emits grid points as
+* soon as the sample following them arrives, cubic interpolation needs one
+* more sample of lookahead. State is a fixed-size structure.
+*
+* Intervals between samples longer than configured maximum gap are not
+* interpolated across. A single gap marker is emitted on the first grid point
+* inside such an interval instead. Samples with error flag set are treated
+* as missing.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_RESAMPLE_H_
+#define _LIB_MLX90614_RESAMPLE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lib_mlx90614.h"
+
+// Interpolation methods
+typedef enum {
+    MLX_RESAMPLE_LINEAR,
+    MLX_RESAMPLE_CUBIC
+} mlx_resample_method;
+
+// Resampled output point
+typedef struct mlx90614_resampled_struct
+{
+    uint32_t timestamp_ms;      // Grid point time
+    float value;                // Interpolated raw linearized value
+    bool b_is_gap;              // Gap marker, value is not valid
+} mlx90614_resampled_t;
+
+// Resampler state
+typedef struct mlx90614_resampler_struct
+{
+    mlx_resample_method method; // Interpolation method
+    uint32_t period_ms;         // Output grid period
+    uint32_t max_gap_ms;        // Longest interval interpolated across
+    uint32_t next_ms;           // Next grid point to be emitted
+    uint8_t count;              // Number of samples in history
+    uint32_t time[4];           // Sample history times, oldest first
+    float value[4];             // Sample history values, oldest first
+} mlx90614_resampler_t;
+
+/**
+ * @brief Initialize resampler state.
+ *
+ * @param p_rs Pointer to resampler state.
+ * @param method Interpolation method.
+ * @param period_ms Output grid period.
+ * @param max_gap_ms Longest input interval to interpolate across.
+ */
+void
+mlx90614_resampler_init(mlx90614_resampler_t *p_rs, mlx_resample_method method,
+    uint32_t period_ms, uint32_t max_gap_ms);
+
+/**
+ * @brief Feed sample to resampler and collect grid points it completes.
+ *
+ * Output buffer should hold at least max_gap_ms / period_ms + 1 points,
+ * grid points not fitting into it are dropped.
+ *
+ * @param p_rs Pointer to resampler state.
+ * @param p_sample Input sample, samples must come in time order.
+ * @param p_output Output buffer.
+ * @param max_count Output buffer size.
+ *
+ * @return Number of emitted grid points.
+ */
+uint32_t
+mlx90614_resampler_push(mlx90614_resampler_t *p_rs,
+    const mlx90614_sample_t *p_sample, mlx90614_resampled_t *p_output,
+    uint32_t max_count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_RESAMPLE_H_
+
+/* [] END OF FILE */
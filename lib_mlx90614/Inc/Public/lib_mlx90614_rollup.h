@@ -0,0 +1,163 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_rollup.h
+* @version 1.0.0
+*
+* @brief Multi-resolution history store for MLX90614 sample streams.
+*
+* Store keeps the most recent raw samples of a single sensor channel and
+* min/max/mean buckets at 1 second, 1 minute and 1 hour resolution. Every
+* level is a fixed-size ring allocated at open. Buckets are updated
+* incrementally as samples arrive, each closed bucket is merged into the next
+* coarser level. Samples with error flag set are kept in raw ring but are not
+* included in rollups.
+*
+* Sample timestamps wrap after 49.7 days, so store extends them to a 64-bit
+* timeline relative to the previous sample. Buckets and queries use 64-bit
+* times, history is kept correctly for any duration as long as consecutive
+* samples are less than 24.8 days apart. mlx90614_rollup_extend converts
+* current time to the store timeline for queries.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_ROLLUP_H_
+#define _LIB_MLX90614_ROLLUP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lib_mlx90614.h"
+
+// Number of rollup levels
+#define MLX90614_ROLLUP_LEVELS      3
+
+// Rollup level resolutions
+#define MLX90614_ROLLUP_RES_SECOND  1000
+#define MLX90614_ROLLUP_RES_MINUTE  60000
+#define MLX90614_ROLLUP_RES_HOUR    3600000
+
+// Aggregated bucket of raw linearized values
+typedef struct mlx90614_rollup_bucket_struct
+{
+    uint64_t start_ms;          // Bucket start time, store timeline
+    uint32_t count;             // Number of aggregated samples
+    uint64_t sum;               // Sum of aggregated raw values
+    uint16_t min;               // Minimum raw value
+    uint16_t max;               // Maximum raw value
+} mlx90614_rollup_bucket_t;
+
+// Single rollup level ring
+typedef struct mlx90614_rollup_level_struct
+{
+    uint32_t resolution_ms;             // Bucket duration
+    uint32_t capacity;                  // Number of buckets in ring
+    uint32_t head;                      // Index of next bucket to be written
+    uint32_t count;                     // Number of closed buckets in ring
+    mlx90614_rollup_bucket_t *p_buckets;
+    mlx90614_rollup_bucket_t current;   // Open bucket
+} mlx90614_rollup_level_t;
+
+// Rollup store descriptor
+typedef struct mlx90614_rollup_struct
+{
+    uint32_t raw_capacity;              // Number of samples in raw ring
+    uint32_t raw_head;                  // Index of next sample to be written
+    uint32_t raw_count;                 // Number of samples in raw ring
+    bool b_is_started;                  // Any sample added
+    uint64_t last_ms;                   // Time of last sample, store timeline
+    mlx90614_sample_t *p_raw;
+    mlx90614_rollup_level_t levels[MLX90614_ROLLUP_LEVELS];
+} mlx90614_rollup_t;
+
+/**
+ * @brief Allocate rollup store.
+ *
+ * @param raw_capacity Number of raw samples kept.
+ * @param p_level_capacity Number of buckets kept for every rollup level,
+ * from the finest level to the coarsest.
+ *
+ * @return Pointer to rollup store descriptor, NULL on failure.
+ */
+mlx90614_rollup_t
+*mlx90614_rollup_open(uint32_t raw_capacity,
+    const uint32_t p_level_capacity[MLX90614_ROLLUP_LEVELS]);
+
+/**
+ * @brief Free rollup store.
+ *
+ * @param p_rollup Pointer to rollup store descriptor.
+ */
+void
+mlx90614_rollup_close(mlx90614_rollup_t *p_rollup);
+
+/**
+ * @brief Add sample to store. Samples must be added in time order.
+ *
+ * @param p_rollup Pointer to rollup store descriptor.
+ * @param p_sample Sample to be added.
+ */
+void
+mlx90614_rollup_add(mlx90614_rollup_t *p_rollup,
+    const mlx90614_sample_t *p_sample);
+
+/**
+ * @brief Extend sample timestamp to store timeline.
+ *
+ * Timestamp is taken as the nearest time to last added sample, so it must be
+ * within 24.8 days of it.
+ *
+ * @param p_rollup Pointer to rollup store descriptor.
+ * @param timestamp_ms Monotonic timestamp, see mlx90614_get_time_ms.
+ *
+ * @return Time on store timeline.
+ */
+uint64_t
+mlx90614_rollup_extend(const mlx90614_rollup_t *p_rollup,
+    uint32_t timestamp_ms);
+
+/**
+ * @brief Query history for time range.
+ *
+ * Query is answered from the coarsest level with resolution not exceeding
+ * requested resolution. Raw samples are returned as single sample buckets
+ * if requested resolution is finer than the finest rollup level. Open
+ * buckets are included.
+ *
+ * @param p_rollup Pointer to rollup store descriptor.
+ * @param from_ms Range start time, store timeline.
+ * @param to_ms Range end time (exclusive), store timeline.
+ * @param resolution_ms Requested resolution.
+ * @param p_buckets Output bucket buffer.
+ * @param max_count Output bucket buffer size.
+ * @param p_used_resolution_ms Pointer to variable to store resolution of
+ * returned buckets, 0 for raw samples. May be NULL.
+ *
+ * @return Number of returned buckets.
+ */
+uint32_t
+mlx90614_rollup_query(mlx90614_rollup_t *p_rollup, uint64_t from_ms,
+    uint64_t to_ms, uint32_t resolution_ms, mlx90614_rollup_bucket_t *p_buckets,
+    uint32_t max_count, uint32_t *p_used_resolution_ms);
+
+/**
+ * @brief Get bucket mean value.
+ *
+ * @param p_bucket Pointer to bucket.
+ *
+ * @return Mean raw linearized value, 0 for empty bucket.
+ */
+uint16_t
+mlx90614_rollup_mean(const mlx90614_rollup_bucket_t *p_bucket);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_ROLLUP_H_
+
+/* [] END OF FILE */
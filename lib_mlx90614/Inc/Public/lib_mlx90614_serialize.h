@@ -0,0 +1,84 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_serialize.h
+* @version 1.0.0
+*
+* @brief CBOR and JSON serialization of MLX90614 snapshots.
+*
+* Snapshots are written into caller provided buffers without allocation and
+* without printf-style formatting. Temperatures are converted from raw words
+* in fixed point (hundredths of a degree) and printed by integer routines.
+*
+* Snapshot object keys:
+*   "addr"  Sensor I2C address
+*   "ts"    Timestamp in milliseconds
+*   "ta"    Ambient temperature
+*   "to1"   Object 1 temperature
+*   "to2"   Object 2 temperature
+* Channels not valid in snapshot are omitted. CBOR temperatures are encoded
+* as decimal fractions (tag 4) with exponent -2, raw words as integers.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_SERIALIZE_H_
+#define _LIB_MLX90614_SERIALIZE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lib_mlx90614.h"
+
+/**
+ * @brief Convert raw linearized word to hundredths of a degree.
+ *
+ * @param raw Raw linearized temperature word.
+ * @param unit Temperature unit. MLX_TEMP_LINEARIZED returns raw word.
+ *
+ * @return Temperature in hundredths of a degree of given unit.
+ */
+int32_t
+mlx90614_raw_to_centi(uint16_t raw, mlx_temperature_unit unit);
+
+/**
+ * @brief Write snapshots as JSON array of objects.
+ *
+ * @param p_snapshots Snapshots to be written.
+ * @param count Number of snapshots.
+ * @param unit Temperature unit.
+ * @param p_buffer Output buffer.
+ * @param buffer_size Output buffer size.
+ *
+ * @return Number of bytes written, 0 if output does not fit into buffer.
+ * Output is not null terminated.
+ */
+uint32_t
+mlx90614_json_write(const mlx90614_snapshot_t *p_snapshots, uint32_t count,
+    mlx_temperature_unit unit, uint8_t *p_buffer, uint32_t buffer_size);
+
+/**
+ * @brief Write snapshots as CBOR array of maps.
+ *
+ * @param p_snapshots Snapshots to be written.
+ * @param count Number of snapshots.
+ * @param unit Temperature unit.
+ * @param p_buffer Output buffer.
+ * @param buffer_size Output buffer size.
+ *
+ * @return Number of bytes written, 0 if output does not fit into buffer.
+ */
+uint32_t
+mlx90614_cbor_write(const mlx90614_snapshot_t *p_snapshots, uint32_t count,
+    mlx_temperature_unit unit, uint8_t *p_buffer, uint32_t buffer_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_SERIALIZE_H_
+
+/* [] END OF FILE */
@@ -0,0 +1,147 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_speed.h
+* @version 1.0.0
+*
+* @brief Bus speed probing with PEC-verified fallback for MLX90614 sensors.
+*
+* Speed object is shared by all sensors on one bus and attached to their
+* descriptors. Probe steps through supported bus speeds from the slowest,
+* reads MLX90614_SPEED_PROBE_READS ambient temperature words from every
+* attached sensor at each speed and stops at the first speed with a NACK or
+* PEC error. Bus is then set to the fastest error-free speed lowered by a
+* configured number of margin steps. Probe must run while no other thread
+* uses the bus.
+*
+* At runtime every register read and write of attached sensors is counted.
+* When errors within a window of MLX90614_SPEED_WINDOW transactions exceed
+* MLX90614_SPEED_FALLBACK_PERMILLE, bus steps down one speed and does not
+* step up again until next probe. Errors are not attributed to their cause, so
+* a sensor failing at any speed also brings the bus down to standard speed.
+* Runtime counters are guarded by bus lock, see lib_mlx90614_lock.h, when bus
+* is shared by threads.
+*
+* Read throughput measured by probe at each speed is kept to report the gain
+* of selected speed over standard speed.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_SPEED_H_
+#define _LIB_MLX90614_SPEED_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <applibs/i2c.h>
+
+#include "lib_mlx90614.h"
+
+#define MLX90614_SPEED_LEVELS           3       // Standard, fast, fast plus
+#define MLX90614_SPEED_MAX_SENSORS      16      // Sensors per bus
+#define MLX90614_SPEED_PROBE_READS      64      // Reads per sensor and speed
+#define MLX90614_SPEED_WINDOW           256     // Runtime error rate window
+#define MLX90614_SPEED_FALLBACK_PERMILLE 10     // Error rate for step down
+
+// Bus speed state
+typedef struct mlx90614_speed_struct
+{
+    int i2c_fd;                 // I2C interface file descriptor
+    uint8_t margin_steps;       // Steps below fastest error-free speed
+    uint8_t level;              // Current speed level
+    bool b_is_probing;          // Probe in progress, runtime counting off
+    uint32_t probe_errors[MLX90614_SPEED_LEVELS];   // Errors of last probe
+    uint32_t reads_per_s[MLX90614_SPEED_LEVELS];    // Probe read throughput
+    uint32_t window_count;      // Transactions in current window
+    uint32_t window_errors;     // Errors in current window
+    uint32_t fallbacks;         // Runtime step downs
+    uint8_t sensor_count;       // Attached sensors
+    mlx90614_t *p_sensors[MLX90614_SPEED_MAX_SENSORS];
+} mlx90614_speed_t;
+
+// Speed report
+typedef struct mlx90614_speed_report_struct
+{
+    uint32_t speed_hz;          // Current bus speed
+    uint32_t reads_per_s;       // Probe read throughput at current speed
+    uint32_t base_reads_per_s;  // Probe read throughput at standard speed
+    int32_t gain_permille;      // Throughput change against standard speed
+    uint32_t fallbacks;         // Runtime step downs since probe
+} mlx90614_speed_report_t;
+
+/**
+ * @brief Initialize bus speed state, bus is set to standard speed.
+ *
+ * @param p_speed Pointer to bus speed state.
+ * @param i2c_fd I2C interface file descriptor.
+ * @param margin_steps Speed steps below fastest error-free speed.
+ *
+ * @return True on success.
+ */
+bool
+mlx90614_speed_init(mlx90614_speed_t *p_speed, int i2c_fd,
+    uint8_t margin_steps);
+
+/**
+ * @brief Attach sensor to bus speed state.
+ *
+ * @param p_speed Pointer to bus speed state.
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ *
+ * @return True on success, false if sensor table is full.
+ */
+bool
+mlx90614_speed_attach(mlx90614_speed_t *p_speed, mlx90614_t *p_mlx);
+
+/**
+ * @brief Detach sensor from its bus speed state.
+ *
+ * Called by mlx90614_close, so closed descriptors are not probed.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ */
+void
+mlx90614_speed_detach(mlx90614_t *p_mlx);
+
+/**
+ * @brief Probe attached sensors and select bus speed.
+ *
+ * @param p_speed Pointer to bus speed state.
+ *
+ * @return True if sensors read without errors at least at standard speed.
+ */
+bool
+mlx90614_speed_probe(mlx90614_speed_t *p_speed);
+
+/**
+ * @brief Count register transaction, step bus speed down on error rate.
+ *
+ * Called by support layer with bus held.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param b_is_ok Transaction succeeded and PEC matched.
+ */
+void
+mlx90614_speed_record(mlx90614_t *p_mlx, bool b_is_ok);
+
+/**
+ * @brief Get current bus speed and throughput change.
+ *
+ * @param p_speed Pointer to bus speed state.
+ * @param p_report Report output.
+ */
+void
+mlx90614_speed_get_report(const mlx90614_speed_t *p_speed,
+    mlx90614_speed_report_t *p_report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_SPEED_H_
+
+/* [] END OF FILE */
@@ -0,0 +1,144 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_timeout.h
+* @version 1.0.0
+*
+* @brief Adaptive I2C timeouts from observed MLX90614 transaction latency.
+*
+* Latency of every successful transaction is collected in a histogram per
+* sensor and per bus. Register transaction timeout is the
+* MLX90614_TIMEOUT_PERCENTILE latency of the sensor times
+* MLX90614_TIMEOUT_FACTOR, clamped to configured limits. Sensors with too few
+* samples use bus histogram, so a sensor which never answered gets a timeout
+* based on its healthy neighbours instead of a fixed worst case. EEPROM erase
+* and write use a separate longer timeout.
+*
+* Bus timeout is the higher of bus histogram timeout and timeout of sensor
+* being accessed, so polling sensors in turn does not reset it on every
+* transaction; only sensors slower than the rest of the bus raise it for their
+* own transactions. I2CMaster_SetTimeout is called only when it changes.
+* Histograms are halved periodically so timeouts follow slow changes of bus
+* load.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_TIMEOUT_H_
+#define _LIB_MLX90614_TIMEOUT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_busstat.h"
+
+#define MLX90614_TIMEOUT_BINS           32      // Histogram bins
+#define MLX90614_TIMEOUT_BIN_US         250     // Histogram bin width
+#define MLX90614_TIMEOUT_PERCENTILE     999     // Latency percentile [permille]
+#define MLX90614_TIMEOUT_FACTOR         2       // Safety factor
+#define MLX90614_TIMEOUT_MIN_SAMPLES    32      // Samples before own timeout
+#define MLX90614_TIMEOUT_DECAY          1024    // Samples before halving
+
+// Latency histogram
+typedef struct mlx90614_timeout_hist_struct
+{
+    uint16_t bins[MLX90614_TIMEOUT_BINS];   // Last bin collects overflow
+    uint16_t count;             // Samples in histogram
+} mlx90614_timeout_hist_t;
+
+// Bus timeout state, shared by sensors of one bus
+typedef struct mlx90614_timeout_bus_struct
+{
+    int i2c_fd;                 // I2C interface file descriptor
+    uint32_t min_ms;            // Lowest register transaction timeout
+    uint32_t max_ms;            // Highest register transaction timeout
+    uint32_t eeprom_ms;         // EEPROM erase and write timeout
+    uint32_t current_ms;        // Timeout set on bus, 0 if not set yet
+    uint32_t set_count;         // I2CMaster_SetTimeout calls
+    mlx90614_timeout_hist_t hist;   // Latency of all sensors
+} mlx90614_timeout_bus_t;
+
+// Sensor timeout state
+typedef struct mlx90614_timeout_struct
+{
+    mlx90614_timeout_bus_t *p_bus;  // Bus state
+    mlx90614_timeout_hist_t hist;   // Latency of sensor
+    uint32_t timeout_ms;        // Register transaction timeout
+    uint32_t expired;           // Transactions failed on timeout
+} mlx90614_timeout_t;
+
+/**
+ * @brief Initialize bus timeout state.
+ *
+ * @param p_bus Pointer to bus timeout state.
+ * @param i2c_fd I2C interface file descriptor.
+ * @param min_ms Lowest register transaction timeout.
+ * @param max_ms Highest register transaction timeout, used until latency
+ * is known.
+ * @param eeprom_ms EEPROM erase and write timeout.
+ */
+void
+mlx90614_timeout_bus_init(mlx90614_timeout_bus_t *p_bus, int i2c_fd,
+    uint32_t min_ms, uint32_t max_ms, uint32_t eeprom_ms);
+
+/**
+ * @brief Enable adaptive timeouts of sensor.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param p_bus Pointer to timeout state of sensor bus.
+ *
+ * @return True on success, false on memory shortage.
+ */
+bool
+mlx90614_timeout_enable(mlx90614_t *p_mlx, mlx90614_timeout_bus_t *p_bus);
+
+/**
+ * @brief Disable adaptive timeouts of sensor.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ */
+void
+mlx90614_timeout_disable(mlx90614_t *p_mlx);
+
+/**
+ * @brief Set bus timeout for next transaction of sensor.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param op Operation type of transaction.
+ */
+void
+mlx90614_timeout_apply(mlx90614_t *p_mlx, mlx_bus_op op);
+
+/**
+ * @brief Record transaction latency.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param latency_us Measured transaction time.
+ * @param b_is_ok Transaction succeeded.
+ * @param b_is_expired Transaction failed on timeout.
+ */
+void
+mlx90614_timeout_record(mlx90614_t *p_mlx, uint32_t latency_us,
+    bool b_is_ok, bool b_is_expired);
+
+/**
+ * @brief Get register transaction timeout of sensor.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ *
+ * @return Timeout in milliseconds, 0 if adaptive timeouts are disabled.
+ */
+uint32_t
+mlx90614_timeout_get_ms(mlx90614_t *p_mlx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_TIMEOUT_H_
+
+/* [] END OF FILE */
@@ -0,0 +1,175 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_uplink.h
+* @version 1.0.0
+*
+* @brief Telemetry batching and upload pipeline for MLX90614 samples.
+*
+* Samples from any number of sensors are staged and, once the batch reaches
+* its sample count or age limit, serialized into a preallocated buffer as a
+* sequence of compact codec blocks (one per sensor channel, split when over
+* 64 KiB). Serialized batch is handed to a pluggable sink. A sink reporting
+* busy state keeps the batch pending; samples arriving while staging is full
+* are spilled to an optional persistent sample log and replayed once the sink
+* catches up.
+*
+* Batch layout (multi-byte fields little endian):
+*   [0]     Magic 0x42
+*   [1]     Format version
+*   [2-3]   Number of blocks
+*   [...]   Per block: 2 byte block length followed by codec block
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_UPLINK_H_
+#define _LIB_MLX90614_UPLINK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_log.h"
+
+#define MLX90614_UPLINK_MAGIC       0x42
+#define MLX90614_UPLINK_VERSION     1
+
+#define MLX90614_UPLINK_HEADER_SIZE 4
+
+// Sink call result
+typedef enum {
+    MLX_SINK_OK,            // Batch accepted
+    MLX_SINK_BUSY,          // Sink cannot accept batch now, retry later
+    MLX_SINK_ERROR          // Batch rejected, batch is dropped
+} mlx_sink_result;
+
+/**
+ * @brief Sink function type.
+ *
+ * @param p_context Sink context as passed to mlx90614_uplink_open().
+ * @param p_data Serialized batch.
+ * @param length Serialized batch length.
+ *
+ * @return Sink call result.
+ */
+typedef mlx_sink_result (*mlx90614_sink_t)(void *p_context,
+    const uint8_t *p_data, uint32_t length);
+
+// Uplink statistics
+typedef struct mlx90614_uplink_stats_struct
+{
+    uint32_t batches_sent;          // Batches accepted by sink
+    uint32_t batches_failed;        // Batches rejected by sink
+    uint32_t sink_busy;             // Sink busy responses
+    uint32_t samples_sent;          // Samples accepted by sink
+    uint32_t samples_spilled;       // Samples stored to spill log
+    uint32_t samples_dropped;       // Samples lost
+    uint64_t fill_permille_sum;     // Sum of batch buffer fill ratios
+    uint32_t samples_timed;         // Sent samples with measured latency
+    uint64_t latency_sum_ms;        // Sum of sample-to-sink latencies
+    uint32_t latency_max_ms;        // Maximum sample-to-sink latency
+} mlx90614_uplink_stats_t;
+
+// Uplink descriptor
+typedef struct mlx90614_uplink_struct
+{
+    mlx90614_sink_t sink;           // Sink function
+    void *p_sink_context;           // Sink function context
+    mlx90614_log_t *p_spill;        // Spill log, may be NULL
+    uint32_t spill_seq;             // Next spilled record to be replayed
+    uint32_t open_seq;              // First record spilled after open
+    uint32_t max_samples;           // Batch sample count limit
+    uint32_t max_age_ms;            // Batch age limit
+    uint32_t sample_count;          // Number of staged samples
+    uint32_t replay_count;          // Leading staged samples from before open
+    uint32_t batch_start_ms;        // Time first sample was staged
+    mlx90614_sample_t *p_samples;   // Staged samples
+    uint8_t *p_consumed;            // Serialization scratch flags
+    uint8_t *p_buffer;              // Serialized batch buffer
+    uint32_t buffer_size;           // Serialized batch buffer size
+    uint32_t pending_length;        // Length of batch waiting for sink
+    uint32_t pending_count;         // Number of samples in pending batch
+    uint32_t pending_timed;         // Pending samples with measured latency
+    uint64_t pending_age_sum;       // Sum of timed sample ages at serialization
+    uint32_t pending_age_max;       // Oldest timed sample age at serialization
+    uint32_t pending_ms;            // Serialization time
+    mlx90614_uplink_stats_t stats;
+} mlx90614_uplink_t;
+
+/**
+ * @brief Allocate upload pipeline.
+ *
+ * Replay starts at the oldest record of spill log, so samples spilled before
+ * a restart are sent. Records replayed before the restart which are still in
+ * the log are sent again; callers persisting their own upload cursor may set
+ * spill_seq after open. Samples spilled before open carry timestamps of the
+ * previous run and are left out of latency statistics.
+ *
+ * @param max_samples Batch sample count limit.
+ * @param max_age_ms Batch age limit.
+ * @param buffer_size Serialized batch buffer size.
+ * @param sink Sink function.
+ * @param p_sink_context Sink function context.
+ * @param p_spill Spill log opened by caller, may be NULL.
+ *
+ * @return Pointer to uplink descriptor, NULL on failure.
+ */
+mlx90614_uplink_t
+*mlx90614_uplink_open(uint32_t max_samples, uint32_t max_age_ms,
+    uint32_t buffer_size, mlx90614_sink_t sink, void *p_sink_context,
+    mlx90614_log_t *p_spill);
+
+/**
+ * @brief Free upload pipeline. Pending samples are not sent.
+ *
+ * @param p_uplink Pointer to uplink descriptor.
+ */
+void
+mlx90614_uplink_close(mlx90614_uplink_t *p_uplink);
+
+/**
+ * @brief Stage sample for upload.
+ *
+ * @param p_uplink Pointer to uplink descriptor.
+ * @param p_sample Sample to be uploaded.
+ *
+ * @return True if sample was staged or spilled, false if it was dropped.
+ */
+bool
+mlx90614_uplink_push(mlx90614_uplink_t *p_uplink,
+    const mlx90614_sample_t *p_sample);
+
+/**
+ * @brief Serialize and send batch if due, retry pending batch, replay
+ * spilled samples. Should be called periodically.
+ *
+ * @param p_uplink Pointer to uplink descriptor.
+ * @param b_force Send staged samples regardless of batch limits.
+ */
+void
+mlx90614_uplink_poll(mlx90614_uplink_t *p_uplink, bool b_force);
+
+/**
+ * @brief Sink writing length-prefixed batches to a file or socket.
+ *
+ * @param p_context Pointer to int file descriptor.
+ * @param p_data Serialized batch.
+ * @param length Serialized batch length.
+ *
+ * @return MLX_SINK_BUSY if descriptor would block, MLX_SINK_OK on success.
+ */
+mlx_sink_result
+mlx90614_uplink_fd_sink(void *p_context, const uint8_t *p_data,
+    uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_UPLINK_H_
+
+/* [] END OF FILE */
@@ -0,0 +1,113 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_warmup.h
+* @version 1.0.0
+*
+* @brief Warm-up tracking and compensation for MLX90614 readings.
+*
+* After power-on or wake-up, object temperature readings are biased while
+* the chip IIR/FIR filters settle and while the die is thermally settling.
+* Warm-up model tracks both per sensor and reports a settled confidence in
+* range 0 to 1 for every sample:
+*
+*  - Filter confidence grows linearly up to filter settling time taken from
+*    datasheet settling time table for CONF1 IIR/FIR setting and zone count.
+*  - Thermal confidence is derived from ambient temperature rate of change,
+*    reaching 1 once TA changes slower than MLX90614_WARMUP_TA_SLOPE_OK. It
+*    is 0 until the rate was measured between two TA samples.
+*
+* Optional correction extrapolates the exponential filter step response of
+* unsettled object samples to its final value (Aitken delta-squared on last
+* three samples) and subtracts TA drift induced bias using per-installation
+* drift coefficient.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_WARMUP_H_
+#define _LIB_MLX90614_WARMUP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lib_mlx90614.h"
+
+// TA rate of change considered thermally settled [raw LSB/s], 0.02 K/s
+#define MLX90614_WARMUP_TA_SLOPE_OK     1.0F
+
+// Warm-up model state
+typedef struct mlx90614_warmup_struct
+{
+    uint32_t start_ms;          // Power-on or wake-up time
+    uint32_t settle_ms;         // Filter settling time
+    bool b_correct;             // Correct unsettled samples
+    float drift_coef;           // TOBJ bias per TA slope [s], 0 = none
+    uint8_t ta_count;           // TA samples since start, 2 once drift known
+    uint32_t ta_time_ms;        // Last TA sample time
+    uint16_t ta_raw;            // Last TA sample value
+    float ta_slope;             // Smoothed TA slope [raw LSB/s]
+    uint8_t hist_count[2];      // Object sample history length per zone
+    uint16_t hist[2][3];        // Object sample history per zone
+} mlx90614_warmup_t;
+
+/**
+ * @brief Get filter settling time for CONF1 setting.
+ *
+ * @param conf1 CONF1 register contents.
+ *
+ * @return Settling time in milliseconds.
+ */
+uint32_t
+mlx90614_warmup_settle_ms(mlx90614_conf1_t conf1);
+
+/**
+ * @brief Initialize warm-up model.
+ *
+ * @param p_wu Pointer to warm-up model state.
+ * @param p_profile Sensor capability profile.
+ * @param start_ms Power-on or wake-up time.
+ * @param b_correct Correct unsettled samples.
+ * @param drift_coef TOBJ bias per TA slope [s], 0 disables drift correction.
+ */
+void
+mlx90614_warmup_init(mlx90614_warmup_t *p_wu,
+    const mlx90614_profile_t *p_profile, uint32_t start_ms, bool b_correct,
+    float drift_coef);
+
+/**
+ * @brief Restart warm-up after sensor wake-up.
+ *
+ * @param p_wu Pointer to warm-up model state.
+ * @param start_ms Wake-up time.
+ */
+void
+mlx90614_warmup_restart(mlx90614_warmup_t *p_wu, uint32_t start_ms);
+
+/**
+ * @brief Update warm-up model with sample.
+ *
+ * TA samples update thermal settling state, object samples are rated and
+ * optionally corrected.
+ *
+ * @param p_wu Pointer to warm-up model state.
+ * @param p_sample Sample.
+ * @param p_corrected Corrected raw value output, may be NULL. Equals sample
+ * value when correction is disabled or not applicable.
+ *
+ * @return Settled confidence, 0 to 1.
+ */
+float
+mlx90614_warmup_update(mlx90614_warmup_t *p_wu,
+    const mlx90614_sample_t *p_sample, uint16_t *p_corrected);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_WARMUP_H_
+
+/* [] END OF FILE */
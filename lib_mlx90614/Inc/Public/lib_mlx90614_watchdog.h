@@ -0,0 +1,165 @@
+/***************************************************************************//**
+* @file    lib_mlx90614_watchdog.h
+* @version 1.0.0
+*
+* @brief Sample staleness watchdog for MLX90614 sensors.
+*
+* Watchdog tracks age of last valid sample of every registered sensor against
+* a configured sample-age SLO. Samples with error flag set do not refresh the
+* age, so a sensor reporting only errors goes stale like a silent one.
+*
+* Object channels are also checked for frozen values. Filtered readings of a
+* working sensor keep changing by a few LSB, so an object word repeated for
+* MLX90614_WATCHDOG_FROZEN_SAMPLES samples and longer than
+* MLX90614_WATCHDOG_FROZEN_FACTOR filter settling times is reported frozen.
+* Ambient channel is not checked, die temperature may legitimately stay
+* constant for long.
+*
+* Callback is called once when sensor becomes stale or frozen and once when
+* it recovers. Ages of all sensors are checked with every consumed batch, so
+* a silent sensor is reported by the first batch of another sensor after its
+* SLO expires. mlx90614_watchdog_check called once per sample period covers
+* buses where all sensors stop.
+*
+* Samples do not identify their bus, so sensors are told apart by address and
+* each watchdog covers one bus. Multi-bus setups use a watchdog per bus, fed
+* with samples of that bus only.
+*
+* Watchdog is not thread-safe, consume and check must run on one thread.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#ifndef _LIB_MLX90614_WATCHDOG_H_
+#define _LIB_MLX90614_WATCHDOG_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lib_mlx90614.h"
+
+#define MLX90614_WATCHDOG_MAX_SENSORS       16
+#define MLX90614_WATCHDOG_FROZEN_SAMPLES    8   // Identical object samples
+#define MLX90614_WATCHDOG_FROZEN_FACTOR     4   // Filter settling times
+
+// Watchdog event
+typedef enum {
+    MLX_WATCHDOG_STALE,         // No valid sample within SLO
+    MLX_WATCHDOG_FROZEN,        // Object value not changing
+    MLX_WATCHDOG_RECOVERED      // Sensor is fresh and changing again
+} mlx_watchdog_event;
+
+/**
+ * @brief Watchdog event function.
+ *
+ * @param p_context Callback context.
+ * @param i2c_addr Sensor address.
+ * @param event Watchdog event.
+ * @param age_ms Sample age for stale event, unchanged value time for frozen
+ * event, 0 for recovery.
+ */
+typedef void (*mlx90614_watchdog_cb_t)(void *p_context, uint8_t i2c_addr,
+    mlx_watchdog_event event, uint32_t age_ms);
+
+// Watched sensor
+typedef struct mlx90614_watchdog_sensor_struct
+{
+    uint8_t i2c_addr;           // Sensor address
+    uint8_t channels;           // MLX90614_CH_* object channels checked
+    uint32_t slo_ms;            // Sample age limit
+    uint32_t frozen_ms;         // Unchanged object value limit
+    uint32_t fresh_ms;          // Last valid sample time
+    uint16_t obj_raw[2];        // Last object words
+    uint32_t obj_since_ms[2];   // Last object word change time
+    uint16_t obj_repeats[2];    // Identical object samples since change
+    bool b_is_stale;            // Sample age over SLO
+    bool b_is_frozen;           // Object value frozen
+    uint32_t max_age_ms;        // Highest sample age seen
+    uint32_t violations;        // Stale and frozen events
+} mlx90614_watchdog_sensor_t;
+
+// Staleness watchdog
+typedef struct mlx90614_watchdog_struct
+{
+    mlx90614_watchdog_cb_t callback;    // Event function, or NULL
+    void *p_context;                    // Event function context
+    uint8_t sensor_count;               // Watched sensors
+    mlx90614_watchdog_sensor_t sensors[MLX90614_WATCHDOG_MAX_SENSORS];
+} mlx90614_watchdog_t;
+
+/**
+ * @brief Initialize watchdog.
+ *
+ * @param p_wd Pointer to watchdog.
+ * @param callback Event function, or NULL.
+ * @param p_context Event function context.
+ */
+void
+mlx90614_watchdog_init(mlx90614_watchdog_t *p_wd,
+    mlx90614_watchdog_cb_t callback, void *p_context);
+
+/**
+ * @brief Watch sensor, sample age is counted from now.
+ *
+ * Frozen value limit is derived from filter settling time of sensor CONF1
+ * from capability profile.
+ *
+ * @param p_wd Pointer to watchdog.
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param slo_ms Sample age limit.
+ *
+ * @return True on success, false if sensor table is full or sensor address
+ * is already watched.
+ */
+bool
+mlx90614_watchdog_add(mlx90614_watchdog_t *p_wd, mlx90614_t *p_mlx,
+    uint32_t slo_ms);
+
+/**
+ * @brief Consume raw samples and check sample ages.
+ *
+ * Has consumer signature, so watchdog can be subscribed to a sample hub.
+ *
+ * @param p_context Pointer to watchdog.
+ * @param p_samples Raw samples.
+ * @param p_values Sample values, not used.
+ * @param count Number of samples.
+ */
+void
+mlx90614_watchdog_consume(void *p_context,
+    const mlx90614_sample_t *p_samples, const float *p_values,
+    uint32_t count);
+
+/**
+ * @brief Check sample ages of all sensors.
+ *
+ * @param p_wd Pointer to watchdog.
+ * @param now_ms Current monotonic time.
+ */
+void
+mlx90614_watchdog_check(mlx90614_watchdog_t *p_wd, uint32_t now_ms);
+
+/**
+ * @brief Get watch state of sensor.
+ *
+ * @param p_wd Pointer to watchdog.
+ * @param i2c_addr Sensor address.
+ *
+ * @return Pointer to sensor state, NULL if sensor is not watched.
+ */
+const mlx90614_watchdog_sensor_t
+*mlx90614_watchdog_get_sensor(const mlx90614_watchdog_t *p_wd,
+    uint8_t i2c_addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _LIB_MLX90614_WATCHDOG_H_
+
+/* [] END OF FILE */
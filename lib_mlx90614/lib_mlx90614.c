@@ -17,11 +17,17 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <time.h>
 
 #include <applibs/log.h>
 #include <applibs/i2c.h>
 
 #include "lib_mlx90614.h"
+#include "lib_mlx90614_cal.h"
+#include "lib_mlx90614_guard.h"
+#include "lib_mlx90614_lock.h"
+#include "lib_mlx90614_speed.h"
+#include "lib_mlx90614_timeout.h"
 #include "mlx90614_support.h"
 
 /*******************************************************************************
@@ -50,6 +56,30 @@ convert_temp_unit_to_linear(float united_temp, mlx_temperature_unit unit);
 static float
 convert_temp_linear_to_unit(int16_t linear_temp, mlx_temperature_unit unit);
 
+/**
+ * @brief Read temperature register.
+ *
+ * Read is guarded when read guard is enabled. Object temperatures are
+ * calibrated when sensor calibration is set.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param reg Temperature RAM register.
+ * @param p_raw Raw linearized value output.
+ *
+ * @return True on success, false otherwise.
+ */
+static bool
+read_temperature(mlx90614_t *p_mlx, uint8_t reg, int16_t *p_raw);
+
+/*******************************************************************************
+* Global variables
+*******************************************************************************/
+
+// Temperature RAM registers, in MLX90614_CH_* bit order
+static const uint8_t channel_regs[3] = {
+    MLX90614_RREG_TA, MLX90614_RREG_TOBJ1, MLX90614_RREG_TOBJ2
+};
+
 /*******************************************************************************
 * Function definitions
 *******************************************************************************/
@@ -73,12 +103,24 @@ mlx90614_t
         p_mlx->i2c_fd = i2c_fd;
         p_mlx->i2c_addr = i2c_addr;
         p_mlx->temperature_unit = MLX_TEMP_CELSIUS;
+        p_mlx->p_cal = NULL;
+        p_mlx->p_guard = NULL;
+        p_mlx->p_busstat = NULL;
+        p_mlx->p_lock = NULL;
+        p_mlx->p_timeout = NULL;
+        p_mlx->p_speed = NULL;
 
         // Read device ID
         MLX_DEBUG_DEV("--- Reading sensor ID", __FUNCTION__, p_mlx);
         b_is_init_ok = mlx90614_get_id(p_mlx);
     }
 
+    // Read configuration, determine sensor capabilities
+    if (b_is_init_ok)
+    {
+        b_is_init_ok = mlx90614_load_profile(p_mlx);
+    }
+
     if (!b_is_init_ok)
     {
         MLX_ERROR("MLX90614 initialization failed.", __FUNCTION__);
@@ -98,6 +140,13 @@ mlx90614_close(mlx90614_t *p_mlx)
     // Free memory allocated to device decriptor
     if (p_mlx)
     {
+        mlx90614_cal_clear(p_mlx);
+        mlx90614_guard_disable(p_mlx);
+        mlx90614_timeout_disable(p_mlx);
+        if (p_mlx->p_speed)
+        {
+            mlx90614_speed_detach(p_mlx);
+        }
         free(p_mlx);
         p_mlx = NULL;
     }
@@ -115,6 +164,8 @@ mlx90614_get_id(mlx90614_t *p_mlx)
     int16_t reg_value;
     bool b_result = false;
 
+    mlx90614_lock_acquire(p_mlx);
+
     for (register uint8_t idx = 0; idx < 4; idx++)
     {
         b_result = mlx90614_reg_read(p_mlx, (uint8_t)(MLX90614_EREG_ID1 + idx),
@@ -128,6 +179,8 @@ mlx90614_get_id(mlx90614_t *p_mlx)
         p_mlx->device_id[idx] = (uint16_t)reg_value;
     }
 
+    mlx90614_lock_release(p_mlx);
+
     return b_result;
 }
 
@@ -153,6 +206,8 @@ mlx90614_set_address(mlx90614_t *p_mlx, I2C_DeviceAddress address)
     {
         uint16_t temp_addr;
 
+        mlx90614_lock_acquire(p_mlx);
+
         b_result = mlx90614_reg_read(p_mlx, MLX90614_EREG_SMBUS_ADDR, 
             &temp_addr);
 
@@ -166,6 +221,8 @@ mlx90614_set_address(mlx90614_t *p_mlx, I2C_DeviceAddress address)
             b_result = mlx90614_eeprom_write(p_mlx, MLX90614_EREG_SMBUS_ADDR,
                 (int16_t) temp_addr);
         }
+
+        mlx90614_lock_release(p_mlx);
     }
     else
     {
@@ -181,7 +238,7 @@ mlx90614_get_temperature_object1(mlx90614_t *p_mlx)
     int16_t tobj1;
     float result = MLX90614_TEMP_ERROR;
 
-    if (mlx90614_reg_read(p_mlx, MLX90614_RREG_TOBJ1, &tobj1))
+    if (read_temperature(p_mlx, MLX90614_RREG_TOBJ1, &tobj1))
     {
         if (tobj1 & 0x8000)
         {
@@ -203,7 +260,12 @@ mlx90614_get_temperature_object2(mlx90614_t *p_mlx)
     int16_t tobj2;
     float result = MLX90614_TEMP_ERROR;
 
-    if (mlx90614_reg_read(p_mlx, MLX90614_RREG_TOBJ2, &tobj2))
+    if ((p_mlx->profile.channels & MLX90614_CH_TOBJ2) == 0)
+    {
+        MLX_DEBUG_DEV("Object2 not available on single zone sensor.",
+            __FUNCTION__, p_mlx);
+    }
+    else if (read_temperature(p_mlx, MLX90614_RREG_TOBJ2, &tobj2))
     {
         if (tobj2 & 0x8000)
         {
@@ -219,13 +281,142 @@ mlx90614_get_temperature_object2(mlx90614_t *p_mlx)
     return result;
 }
 
+float
+mlx90614_get_temperature_gradient(mlx90614_t *p_mlx)
+{
+    mlx90614_sample_t samples[2];
+    float result = MLX90614_TEMP_ERROR;
+
+    if (((p_mlx->profile.channels & MLX90614_CH_TOBJ2) != 0) &&
+        (mlx90614_read_channels(p_mlx, MLX90614_CH_TOBJ1 | MLX90614_CH_TOBJ2,
+            samples) == 2) &&
+        (((samples[0].raw | samples[1].raw) & 0x8000) == 0))
+    {
+        int32_t diff = (int32_t)samples[0].raw - (int32_t)samples[1].raw;
+
+        if (p_mlx->temperature_unit == MLX_TEMP_LINEARIZED)
+        {
+            result = (float)diff;
+        }
+        else if (p_mlx->temperature_unit == MLX_TEMP_FAHRENHEIT)
+        {
+            result = (float)diff * 0.02F * 9.0F / 5.0F;
+        }
+        else
+        {
+            result = (float)diff * 0.02F;
+        }
+    }
+
+    return result;
+}
+
+bool
+mlx90614_get_conf1(mlx90614_t *p_mlx, mlx90614_conf1_t *p_conf1)
+{
+    int16_t conf1;
+    bool b_result = false;
+
+    if (mlx90614_reg_read(p_mlx, MLX90614_EREG_CONF1, &conf1))
+    {
+        p_conf1->word = (uint16_t)conf1;
+        b_result = true;
+    }
+
+    return b_result;
+}
+
+uint8_t
+mlx90614_get_channels(mlx90614_t *p_mlx)
+{
+    return p_mlx->profile.channels;
+}
+
+uint8_t
+mlx90614_get_zone_count(mlx90614_t *p_mlx)
+{
+    return p_mlx->profile.zones;
+}
+
+bool
+mlx90614_load_profile(mlx90614_t *p_mlx)
+{
+    static const mlx90614_filter_t single_presets[MLX_PRESET_COUNT] = {
+        { CONF1_IIR_100, CONF1_FIR_128 },
+        { CONF1_IIR_100, CONF1_FIR_512 },
+        { CONF1_IIR_50, CONF1_FIR_1024 }
+    };
+
+    // Dual zone sensors measure channels in turn, use shorter FIR to keep
+    // per-channel settling time comparable
+    static const mlx90614_filter_t dual_presets[MLX_PRESET_COUNT] = {
+        { CONF1_IIR_100, CONF1_FIR_128 },
+        { CONF1_IIR_100, CONF1_FIR_256 },
+        { CONF1_IIR_50, CONF1_FIR_512 }
+    };
+
+    mlx90614_profile_t *p_prof = &p_mlx->profile;
+    int16_t tomin;
+    int16_t tomax;
+    int16_t tarange;
+    bool b_result;
+
+    mlx90614_lock_acquire(p_mlx);
+
+    b_result = mlx90614_get_conf1(p_mlx, &p_prof->conf1) &&
+        mlx90614_reg_read(p_mlx, MLX90614_EREG_TOMIN, &tomin) &&
+        mlx90614_reg_read(p_mlx, MLX90614_EREG_TOMAX, &tomax) &&
+        mlx90614_reg_read(p_mlx, MLX90614_EREG_TA_RANGE, &tarange);
+
+    if (b_result)
+    {
+        p_prof->id = ((uint64_t)p_mlx->device_id[0] << 48) |
+            ((uint64_t)p_mlx->device_id[1] << 32) |
+            ((uint64_t)p_mlx->device_id[2] << 16) |
+            (uint64_t)p_mlx->device_id[3];
+
+        p_prof->channels = MLX90614_CH_TA | MLX90614_CH_TOBJ1;
+        p_prof->zones = 1;
+        if (p_prof->conf1.SENSOR_MODE)
+        {
+            p_prof->channels |= MLX90614_CH_TOBJ2;
+            p_prof->zones = 2;
+        }
+
+        // TOBJ range is stored in 0.01 degK, linearized values are 0.02 degK
+        p_prof->tobj_min = (uint16_t)tomin / 2;
+        p_prof->tobj_max = (uint16_t)tomax / 2;
+
+        // TA range bytes: Ta[degC] = byte * 0.64 - 38.2
+        // Linearized: (Ta[degC] + 273.15) * 50 = byte * 32 + 11747.5
+        p_prof->ta_min = (uint16_t)(((uint16_t)tarange & 0xFF) * 32 + 11748);
+        p_prof->ta_max = (uint16_t)(((uint16_t)tarange >> 8) * 32 + 11748);
+
+        memcpy(p_prof->presets, p_prof->zones == 2 ? dual_presets :
+            single_presets, sizeof(p_prof->presets));
+
+        MLX_DEBUG_DEV("%u IR zone(s), FIR %u, IIR %u", __FUNCTION__, p_mlx,
+            p_prof->zones, p_prof->conf1.FIR, p_prof->conf1.IIR);
+    }
+
+    mlx90614_lock_release(p_mlx);
+
+    return b_result;
+}
+
+const mlx90614_profile_t
+*mlx90614_get_profile(mlx90614_t *p_mlx)
+{
+    return &p_mlx->profile;
+}
+
 float
 mlx90614_get_temperature_ambient(mlx90614_t *p_mlx)
 {
     int16_t ta;
     float result = MLX90614_TEMP_ERROR;
 
-    if (mlx90614_reg_read(p_mlx, MLX90614_RREG_TA, &ta))
+    if (read_temperature(p_mlx, MLX90614_RREG_TA, &ta))
     {
         result = convert_temp_linear_to_unit(ta, p_mlx->temperature_unit);
     }
@@ -233,6 +424,113 @@ mlx90614_get_temperature_ambient(mlx90614_t *p_mlx)
     return result;
 }
 
+bool
+mlx90614_read_sample(mlx90614_t *p_mlx, uint8_t channel,
+    mlx90614_sample_t *p_sample)
+{
+    int16_t raw;
+    bool b_result = false;
+
+    if (read_temperature(p_mlx, channel, &raw))
+    {
+        p_sample->timestamp_ms = mlx90614_get_time_ms();
+        p_sample->raw = (uint16_t)raw;
+        p_sample->i2c_addr = (uint8_t)p_mlx->i2c_addr;
+        p_sample->channel = channel;
+        b_result = true;
+    }
+
+    return b_result;
+}
+
+uint8_t
+mlx90614_read_channels(mlx90614_t *p_mlx, uint8_t channels,
+    mlx90614_sample_t *p_samples)
+{
+    uint8_t count = 0;
+
+    channels &= p_mlx->profile.channels;
+
+    mlx90614_lock_acquire(p_mlx);
+
+    for (uint8_t idx = 0; idx < 3; idx++)
+    {
+        if ((channels & (1 << idx)) &&
+            mlx90614_read_sample(p_mlx, channel_regs[idx], &p_samples[count]))
+        {
+            count++;
+        }
+    }
+
+    mlx90614_lock_release(p_mlx);
+
+    return count;
+}
+
+bool
+mlx90614_get_snapshot(mlx90614_t *p_mlx, mlx90614_snapshot_t *p_snapshot)
+{
+    uint16_t *p_words[3] = {
+        &p_snapshot->ta, &p_snapshot->tobj1, &p_snapshot->tobj2
+    };
+
+    p_snapshot->timestamp_ms = mlx90614_get_time_ms();
+    p_snapshot->i2c_addr = (uint8_t)p_mlx->i2c_addr;
+    p_snapshot->valid = 0;
+
+    mlx90614_lock_acquire(p_mlx);
+
+    for (uint8_t idx = 0; idx < 3; idx++)
+    {
+        int16_t raw;
+
+        *p_words[idx] = 0;
+        if ((p_mlx->profile.channels & (1 << idx)) &&
+            read_temperature(p_mlx, channel_regs[idx], &raw))
+        {
+            *p_words[idx] = (uint16_t)raw;
+            if ((raw & 0x8000) == 0)
+            {
+                p_snapshot->valid |= (uint8_t)(1 << idx);
+            }
+        }
+    }
+
+    mlx90614_lock_release(p_mlx);
+
+    return p_snapshot->valid != 0;
+}
+
+uint32_t
+mlx90614_get_time_ms(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint32_t)((uint64_t)now.tv_sec * 1000 +
+        (uint64_t)now.tv_nsec / 1000000);
+}
+
+void
+mlx90614_convert_batch(const mlx90614_sample_t *p_samples, float *p_values,
+    uint32_t count, mlx_temperature_unit unit)
+{
+    // Linear conversion coefficients, in mlx_temperature_unit order
+    static const float scale[4] = { 1.0F, 0.02F, 0.02F, 0.036F };
+    static const float offset[4] = { 0.0F, 0.0F, -273.15F, -459.67F };
+    const float a = scale[unit & 3];
+    const float b = offset[unit & 3];
+
+    for (uint32_t idx = 0; idx < count; idx++)
+    {
+        uint16_t raw = p_samples[idx].raw;
+        float value = (float)(raw & 0x7FFF) * a + b;
+
+        p_values[idx] = (raw & 0x8000) ? MLX90614_TEMP_ERROR : value;
+    }
+}
+
 float
 mlx90614_get_emissivity(mlx90614_t *p_mlx)
 {
@@ -342,6 +640,115 @@ mlx90614_get_ta_range_max(mlx90614_t *p_mlx)
     return result;
 }
 
+bool
+mlx90614_get_pwmctrl(mlx90614_t *p_mlx, mlx90614_pwmctrl_t *p_pwmctrl)
+{
+    int16_t pwmctrl;
+    bool b_result = false;
+
+    if (mlx90614_reg_read(p_mlx, MLX90614_EREG_PWMCTRL, &pwmctrl))
+    {
+        p_pwmctrl->word = (uint16_t)pwmctrl;
+        b_result = true;
+    }
+
+    return b_result;
+}
+
+bool
+mlx90614_set_pwmctrl(mlx90614_t *p_mlx, mlx90614_pwmctrl_t pwmctrl)
+{
+    mlx90614_pwmctrl_t current;
+    bool b_result;
+
+    mlx90614_lock_acquire(p_mlx);
+
+    b_result = mlx90614_get_pwmctrl(p_mlx, &current);
+
+    if (b_result && (current.word != pwmctrl.word))
+    {
+        b_result = mlx90614_eeprom_write(p_mlx, MLX90614_EREG_PWMCTRL,
+            (int16_t)pwmctrl.word);
+
+        // Read back to verify EEPROM contents
+        if (b_result)
+        {
+            b_result = mlx90614_get_pwmctrl(p_mlx, &current) &&
+                (current.word == pwmctrl.word);
+        }
+
+        if (!b_result)
+        {
+            MLX_ERROR("PWMCTRL write failed.", __FUNCTION__);
+        }
+    }
+
+    mlx90614_lock_release(p_mlx);
+
+    return b_result;
+}
+
+bool
+mlx90614_pwm_calculate(float frequency_hz, uint8_t repetitions,
+    bool b_is_extended, mlx90614_pwm_timing_t *p_timing)
+{
+    bool b_result = true;
+    float unit_ms = (b_is_extended ? PWMCTRL_PERIOD_EXTENDED_US :
+        PWMCTRL_PERIOD_SINGLE_US) / 1000.0F;
+    float period = 0.0F;
+    mlx90614_pwmctrl_t pwmctrl = { .word = 0 };
+
+    if (frequency_hz > 0.0F)
+    {
+        period = 1000.0F / (frequency_hz * unit_ms) + 0.5F;
+    }
+
+    if (period < 1.0F)
+    {
+        period = (frequency_hz > 0.0F) ? 1.0F : PWMCTRL_PERIOD_MAX;
+        b_result = false;
+    }
+    else if (period > PWMCTRL_PERIOD_MAX)
+    {
+        period = PWMCTRL_PERIOD_MAX;
+        b_result = false;
+    }
+
+    if (repetitions > PWMCTRL_REP_MAX)
+    {
+        repetitions = PWMCTRL_REP_MAX;
+        b_result = false;
+    }
+
+    pwmctrl.PWM_MODE = b_is_extended ? 0 : 1;
+    pwmctrl.EN_PWM = 1;
+    pwmctrl.PWM_PERIOD = (uint8_t)period & 0x7F;    // 128 is written as 0
+    pwmctrl.PWM_REP = (uint8_t)((repetitions + 1) / 2);
+
+    mlx90614_pwm_timing(pwmctrl, p_timing);
+
+    return b_result;
+}
+
+void
+mlx90614_pwm_timing(mlx90614_pwmctrl_t pwmctrl,
+    mlx90614_pwm_timing_t *p_timing)
+{
+    uint32_t period = (pwmctrl.PWM_PERIOD == 0) ? PWMCTRL_PERIOD_MAX :
+        pwmctrl.PWM_PERIOD;
+    uint32_t repetitions = (uint32_t)pwmctrl.PWM_REP * 2;
+    uint32_t unit_us = (pwmctrl.PWM_MODE == 0) ? PWMCTRL_PERIOD_EXTENDED_US :
+        PWMCTRL_PERIOD_SINGLE_US;
+
+    p_timing->pwm_period = pwmctrl.PWM_PERIOD;
+    p_timing->pwm_rep = pwmctrl.PWM_REP;
+    p_timing->period_ms = (float)(period * unit_us) / 1000.0F;
+    p_timing->frequency_hz = 1000.0F / p_timing->period_ms;
+    p_timing->latency_ms = p_timing->period_ms *
+        (float)((repetitions > 0) ? repetitions : 1) *
+        ((pwmctrl.PWM_MODE == 0) ? 2.0F : 1.0F);
+}
+
 /*******************************************************************************
 * Private function definitions
 *******************************************************************************/
@@ -404,4 +811,29 @@ convert_temp_linear_to_unit(int16_t linear_temp, mlx_temperature_unit unit)
     return united_temp;
 }
 
+static bool
+read_temperature(mlx90614_t *p_mlx, uint8_t reg, int16_t *p_raw)
+{
+    bool b_result;
+
+    if (p_mlx->p_guard && (reg >= MLX90614_RREG_TA) &&
+        (reg <= MLX90614_RREG_TOBJ2))
+    {
+        b_result = mlx90614_guard_read(p_mlx, reg, p_raw);
+    }
+    else
+    {
+        b_result = mlx90614_reg_read(p_mlx, reg, p_raw);
+    }
+
+    if (b_result && p_mlx->p_cal && ((reg == MLX90614_RREG_TOBJ1) ||
+        (reg == MLX90614_RREG_TOBJ2)))
+    {
+        *p_raw = (int16_t)mlx90614_cal_apply(p_mlx->p_cal,
+            (uint8_t)((reg == MLX90614_RREG_TOBJ1) ? 1 : 2), (uint16_t)*p_raw);
+    }
+
+    return b_result;
+}
+
 /* [] END OF FILE */
@@ -0,0 +1,370 @@
+/***************************************************************************//**
+* @file    mlx90614_acq.c
+* @version 1.0.0
+*
+* @brief Parallel multi-bus acquisition of MLX90614 sensors.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_acq.h"
+#include "mlx90614_support.h"
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Bus worker thread, reads sensors of bus every period.
+ *
+ * @param p_arg Pointer to bus worker.
+ *
+ * @return NULL.
+ */
+static void
+*worker(void *p_arg);
+
+/**
+ * @brief Compare timestamps, wrap-around safe.
+ *
+ * @param a_ms First timestamp.
+ * @param b_ms Second timestamp.
+ *
+ * @return True if first timestamp is earlier than second.
+ */
+static bool
+is_before(uint32_t a_ms, uint32_t b_ms);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+mlx90614_acq_t
+*mlx90614_acq_open(uint8_t bus_count, uint32_t period_ms, uint32_t ring_size)
+{
+    mlx90614_acq_t *p_acq = NULL;
+    size_t size = sizeof(mlx90614_acq_t) +
+        bus_count * sizeof(mlx90614_acq_bus_t) +
+        (size_t)bus_count * ring_size * sizeof(mlx90614_sample_t);
+
+    if ((bus_count == 0) || (period_ms == 0) || (ring_size == 0))
+    {
+        MLX_ERROR("Invalid acquisition parameters.", __FUNCTION__);
+    }
+    else if ((p_acq = malloc(size)) == NULL)
+    {
+        MLX_ERROR("Not enough free memory.", __FUNCTION__);
+    }
+    else
+    {
+        memset(p_acq, 0, size);
+        p_acq->period_ms = period_ms;
+        p_acq->ring_size = ring_size;
+        p_acq->bus_count = bus_count;
+        p_acq->p_buses = (mlx90614_acq_bus_t *)&p_acq[1];
+
+        mlx90614_sample_t *p_rings =
+            (mlx90614_sample_t *)&p_acq->p_buses[bus_count];
+
+        for (uint8_t bus = 0; bus < bus_count; bus++)
+        {
+            p_acq->p_buses[bus].p_acq = p_acq;
+            p_acq->p_buses[bus].p_ring = &p_rings[bus * ring_size];
+            p_acq->p_buses[bus].b_is_done = true;
+            pthread_mutex_init(&p_acq->p_buses[bus].lock, NULL);
+        }
+    }
+
+    return p_acq;
+}
+
+void
+mlx90614_acq_close(mlx90614_acq_t *p_acq)
+{
+    if (p_acq)
+    {
+        mlx90614_acq_stop(p_acq);
+
+        for (uint8_t bus = 0; bus < p_acq->bus_count; bus++)
+        {
+            pthread_mutex_destroy(&p_acq->p_buses[bus].lock);
+        }
+
+        free(p_acq);
+        p_acq = NULL;
+    }
+}
+
+bool
+mlx90614_acq_add_sensor(mlx90614_acq_t *p_acq, uint8_t bus,
+    mlx90614_t *p_mlx, uint8_t channels)
+{
+    bool b_result = false;
+
+    if (p_acq->b_is_started || (bus >= p_acq->bus_count) ||
+        (p_acq->p_buses[bus].sensor_count >= MLX90614_ACQ_MAX_SENSORS))
+    {
+        MLX_ERROR("Cannot add sensor to bus %u.", __FUNCTION__, bus);
+    }
+    else
+    {
+        mlx90614_acq_bus_t *p_bus = &p_acq->p_buses[bus];
+
+        p_bus->p_sensors[p_bus->sensor_count] = p_mlx;
+        p_bus->channels[p_bus->sensor_count] = channels;
+        p_bus->sensor_count++;
+        b_result = true;
+    }
+
+    return b_result;
+}
+
+bool
+mlx90614_acq_start(mlx90614_acq_t *p_acq)
+{
+    bool b_result = true;
+    uint32_t now_ms = mlx90614_get_time_ms();
+
+    for (uint8_t bus = 0; !p_acq->b_is_started && (bus < p_acq->bus_count);
+        bus++)
+    {
+        mlx90614_acq_bus_t *p_bus = &p_acq->p_buses[bus];
+
+        // Idle buses never hold back merge
+        p_bus->watermark_ms = now_ms;
+        p_bus->b_is_running = (p_bus->sensor_count > 0);
+        p_bus->b_is_done = !p_bus->b_is_running;
+
+        if (p_bus->b_is_running &&
+            (pthread_create(&p_bus->thread, NULL, worker, p_bus) != 0))
+        {
+            MLX_ERROR("Cannot start worker of bus %u.", __FUNCTION__, bus);
+            p_bus->b_is_running = false;
+            p_bus->b_is_done = true;
+            b_result = false;
+        }
+    }
+
+    p_acq->b_is_started = true;
+
+    return b_result;
+}
+
+void
+mlx90614_acq_stop(mlx90614_acq_t *p_acq)
+{
+    bool b_has_thread[p_acq->bus_count];
+
+    for (uint8_t bus = 0; p_acq->b_is_started && (bus < p_acq->bus_count);
+        bus++)
+    {
+        mlx90614_acq_bus_t *p_bus = &p_acq->p_buses[bus];
+
+        pthread_mutex_lock(&p_bus->lock);
+        b_has_thread[bus] = p_bus->b_is_running;
+        p_bus->b_is_running = false;
+        pthread_mutex_unlock(&p_bus->lock);
+    }
+
+    for (uint8_t bus = 0; p_acq->b_is_started && (bus < p_acq->bus_count);
+        bus++)
+    {
+        if (b_has_thread[bus])
+        {
+            pthread_join(p_acq->p_buses[bus].thread, NULL);
+        }
+    }
+
+    p_acq->b_is_started = false;
+}
+
+uint32_t
+mlx90614_acq_read(mlx90614_acq_t *p_acq, mlx90614_acq_sample_t *p_samples,
+    uint32_t max_count)
+{
+    uint8_t bus_count = p_acq->bus_count;
+    uint32_t head[bus_count];
+    uint32_t avail[bus_count];
+    uint32_t watermark_ms[bus_count];
+    bool b_is_done[bus_count];
+    uint32_t count = 0;
+    bool b_is_ready = true;
+
+    // Snapshot rings, slots below tail are not touched by workers
+    for (uint8_t bus = 0; bus < bus_count; bus++)
+    {
+        mlx90614_acq_bus_t *p_bus = &p_acq->p_buses[bus];
+
+        pthread_mutex_lock(&p_bus->lock);
+        head[bus] = p_bus->head;
+        avail[bus] = p_bus->tail - p_bus->head;
+        watermark_ms[bus] = p_bus->watermark_ms;
+        b_is_done[bus] = p_bus->b_is_done;
+        pthread_mutex_unlock(&p_bus->lock);
+    }
+
+    while (b_is_ready && (count < max_count))
+    {
+        uint8_t best = bus_count;
+        uint32_t best_ms = 0;
+
+        // Oldest queued sample, lower bus index on equal timestamps
+        for (uint8_t bus = 0; bus < bus_count; bus++)
+        {
+            if (avail[bus] > 0)
+            {
+                uint32_t time_ms = p_acq->p_buses[bus].p_ring[head[bus] %
+                    p_acq->ring_size].timestamp_ms;
+
+                if ((best == bus_count) || is_before(time_ms, best_ms))
+                {
+                    best = bus;
+                    best_ms = time_ms;
+                }
+            }
+        }
+
+        b_is_ready = (best < bus_count);
+
+        // Empty running buses may still produce older samples
+        for (uint8_t bus = 0; b_is_ready && (bus < bus_count); bus++)
+        {
+            if ((avail[bus] == 0) && !b_is_done[bus] &&
+                is_before(watermark_ms[bus], best_ms))
+            {
+                b_is_ready = false;
+            }
+        }
+
+        if (b_is_ready)
+        {
+            p_samples[count].sample = p_acq->p_buses[best].p_ring[head[best] %
+                p_acq->ring_size];
+            p_samples[count].bus = best;
+            head[best]++;
+            avail[best]--;
+            count++;
+        }
+    }
+
+    for (uint8_t bus = 0; bus < bus_count; bus++)
+    {
+        mlx90614_acq_bus_t *p_bus = &p_acq->p_buses[bus];
+
+        if (head[bus] != p_bus->head)
+        {
+            pthread_mutex_lock(&p_bus->lock);
+            p_bus->head = head[bus];
+            pthread_mutex_unlock(&p_bus->lock);
+        }
+    }
+
+    return count;
+}
+
+void
+mlx90614_acq_get_stats(mlx90614_acq_t *p_acq, uint8_t bus,
+    mlx90614_acq_stats_t *p_stats)
+{
+    mlx90614_acq_bus_t *p_bus = &p_acq->p_buses[bus];
+
+    pthread_mutex_lock(&p_bus->lock);
+    *p_stats = p_bus->stats;
+    pthread_mutex_unlock(&p_bus->lock);
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static void
+*worker(void *p_arg)
+{
+    mlx90614_acq_bus_t *p_bus = (mlx90614_acq_bus_t *)p_arg;
+    uint32_t period_ms = p_bus->p_acq->period_ms;
+    uint32_t ring_size = p_bus->p_acq->ring_size;
+    mlx90614_sample_t cycle[MLX90614_ACQ_MAX_SENSORS * 3];
+    uint32_t next_ms = mlx90614_get_time_ms();
+    bool b_is_running = true;
+
+    while (b_is_running)
+    {
+        uint32_t count = 0;
+        uint32_t now_ms;
+        bool b_is_overrun;
+
+        for (uint8_t idx = 0; idx < p_bus->sensor_count; idx++)
+        {
+            count += mlx90614_read_channels(p_bus->p_sensors[idx],
+                p_bus->channels[idx], &cycle[count]);
+        }
+
+        next_ms += period_ms;
+        now_ms = mlx90614_get_time_ms();
+        b_is_overrun = is_before(next_ms, now_ms);
+        if (b_is_overrun)
+        {
+            next_ms = now_ms;
+        }
+
+        // Publish cycle, next cycle cannot stamp samples before next_ms
+        pthread_mutex_lock(&p_bus->lock);
+        for (uint32_t idx = 0; idx < count; idx++)
+        {
+            if (p_bus->tail - p_bus->head < ring_size)
+            {
+                p_bus->p_ring[p_bus->tail % ring_size] = cycle[idx];
+                p_bus->tail++;
+                p_bus->stats.samples++;
+            }
+            else
+            {
+                p_bus->stats.dropped++;
+            }
+        }
+        p_bus->watermark_ms = next_ms;
+        p_bus->stats.cycles++;
+        p_bus->stats.overruns += b_is_overrun ? 1 : 0;
+        b_is_running = p_bus->b_is_running;
+        pthread_mutex_unlock(&p_bus->lock);
+
+        now_ms = mlx90614_get_time_ms();
+        if (b_is_running && is_before(now_ms, next_ms))
+        {
+            struct timespec delay_time;
+            uint32_t delay_ms = next_ms - now_ms;
+
+            delay_time.tv_sec = delay_ms / 1000;
+            delay_time.tv_nsec = (long)(delay_ms % 1000) * 1000000;
+
+            // Signal must not shorten the cycle, sleep the remaining time
+            while ((nanosleep(&delay_time, &delay_time) == -1) &&
+                (errno == EINTR))
+            {
+                // Remaining time stored by nanosleep
+            }
+        }
+    }
+
+    pthread_mutex_lock(&p_bus->lock);
+    p_bus->b_is_done = true;
+    pthread_mutex_unlock(&p_bus->lock);
+
+    return NULL;
+}
+
+static bool
+is_before(uint32_t a_ms, uint32_t b_ms)
+{
+    return (int32_t)(a_ms - b_ms) < 0;
+}
+
+/* [] END OF FILE */
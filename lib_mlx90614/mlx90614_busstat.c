@@ -0,0 +1,207 @@
+/***************************************************************************//**
+* @file    mlx90614_busstat.c
+* @version 1.0.0
+*
+* @brief Runtime bus time accounting of MLX90614 sensors.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_busstat.h"
+#include "mlx90614_support.h"
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Move rolling window to current time, clear elapsed buckets.
+ *
+ * @param p_stat Pointer to bus accounting.
+ * @param now_ms Current time.
+ */
+static void
+advance(mlx90614_busstat_t *p_stat, uint32_t now_ms);
+
+/**
+ * @brief Add transaction to totals.
+ *
+ * @param p_totals Pointer to totals.
+ * @param bytes Wire bytes.
+ * @param busy_us Transaction time.
+ * @param b_is_ok Transaction succeeded.
+ */
+static void
+add(mlx90614_busstat_totals_t *p_totals, uint32_t bytes, uint32_t busy_us,
+    bool b_is_ok);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+void
+mlx90614_busstat_init(mlx90614_busstat_t *p_stat, uint32_t window_ms)
+{
+    p_stat->bucket_ms = window_ms / MLX90614_BUSSTAT_BUCKETS;
+    if (p_stat->bucket_ms == 0)
+    {
+        p_stat->bucket_ms = 1;
+    }
+
+    mlx90614_busstat_reset(p_stat);
+}
+
+void
+mlx90614_busstat_reset(mlx90614_busstat_t *p_stat)
+{
+    uint32_t bucket_ms = p_stat->bucket_ms;
+
+    memset(p_stat, 0, sizeof(mlx90614_busstat_t));
+    p_stat->bucket_ms = bucket_ms;
+    p_stat->start_ms = mlx90614_get_time_ms();
+    p_stat->bucket_start_ms = p_stat->start_ms;
+}
+
+void
+mlx90614_busstat_attach(mlx90614_t *p_mlx, mlx90614_busstat_t *p_stat)
+{
+    p_mlx->p_busstat = p_stat;
+}
+
+void
+mlx90614_busstat_record(mlx90614_busstat_t *p_stat, uint8_t i2c_addr,
+    mlx_bus_op op, uint32_t bytes, uint32_t busy_us, bool b_is_ok)
+{
+    mlx90614_busstat_sensor_t *p_sensor = (mlx90614_busstat_sensor_t *)
+        mlx90614_busstat_get_sensor(p_stat, i2c_addr);
+
+    if ((p_sensor == NULL) &&
+        (p_stat->sensor_count < MLX90614_BUSSTAT_MAX_SENSORS))
+    {
+        p_sensor = &p_stat->sensors[p_stat->sensor_count++];
+        p_sensor->i2c_addr = i2c_addr;
+    }
+
+    if (p_sensor)
+    {
+        add(&p_sensor->ops[op], bytes, busy_us, b_is_ok);
+    }
+    else
+    {
+        p_stat->untracked++;
+    }
+
+    add(&p_stat->ops[op], bytes, busy_us, b_is_ok);
+
+    advance(p_stat, mlx90614_get_time_ms());
+    p_stat->bucket_us[p_stat->bucket_idx] += busy_us;
+}
+
+const mlx90614_busstat_sensor_t
+*mlx90614_busstat_get_sensor(const mlx90614_busstat_t *p_stat,
+    uint8_t i2c_addr)
+{
+    const mlx90614_busstat_sensor_t *p_sensor = NULL;
+
+    for (uint8_t idx = 0; (p_sensor == NULL) && (idx < p_stat->sensor_count);
+        idx++)
+    {
+        if (p_stat->sensors[idx].i2c_addr == i2c_addr)
+        {
+            p_sensor = &p_stat->sensors[idx];
+        }
+    }
+
+    return p_sensor;
+}
+
+void
+mlx90614_busstat_sum(const mlx90614_busstat_totals_t *p_ops,
+    mlx90614_busstat_totals_t *p_sum)
+{
+    memset(p_sum, 0, sizeof(mlx90614_busstat_totals_t));
+
+    for (uint8_t op = 0; op < MLX_BUSOP_COUNT; op++)
+    {
+        p_sum->transactions += p_ops[op].transactions;
+        p_sum->errors += p_ops[op].errors;
+        p_sum->bytes += p_ops[op].bytes;
+        p_sum->busy_us += p_ops[op].busy_us;
+    }
+}
+
+uint16_t
+mlx90614_busstat_utilization(mlx90614_busstat_t *p_stat)
+{
+    uint32_t now_ms = mlx90614_get_time_ms();
+    uint64_t busy_us = 0;
+    uint64_t span_us;
+
+    advance(p_stat, now_ms);
+
+    for (uint8_t idx = 0; idx < MLX90614_BUSSTAT_BUCKETS; idx++)
+    {
+        busy_us += p_stat->bucket_us[idx];
+    }
+
+    // Completed buckets of window plus elapsed part of current one
+    span_us = ((uint64_t)(MLX90614_BUSSTAT_BUCKETS - 1) * p_stat->bucket_ms +
+        (now_ms - p_stat->bucket_start_ms)) * 1000;
+    if (span_us > (uint64_t)(now_ms - p_stat->start_ms) * 1000)
+    {
+        span_us = (uint64_t)(now_ms - p_stat->start_ms) * 1000;
+    }
+
+    return (span_us == 0) ? 0 :
+        (uint16_t)((busy_us >= span_us) ? 1000 : busy_us * 1000 / span_us);
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static void
+advance(mlx90614_busstat_t *p_stat, uint32_t now_ms)
+{
+    uint32_t elapsed = (now_ms - p_stat->bucket_start_ms) / p_stat->bucket_ms;
+
+    if (elapsed >= MLX90614_BUSSTAT_BUCKETS)
+    {
+        memset(p_stat->bucket_us, 0, sizeof(p_stat->bucket_us));
+        p_stat->bucket_start_ms += elapsed * p_stat->bucket_ms;
+        elapsed = 0;
+    }
+
+    while (elapsed > 0)
+    {
+        p_stat->bucket_idx = (uint8_t)((p_stat->bucket_idx + 1) %
+            MLX90614_BUSSTAT_BUCKETS);
+        p_stat->bucket_us[p_stat->bucket_idx] = 0;
+        p_stat->bucket_start_ms += p_stat->bucket_ms;
+        elapsed--;
+    }
+}
+
+static void
+add(mlx90614_busstat_totals_t *p_totals, uint32_t bytes, uint32_t busy_us,
+    bool b_is_ok)
+{
+    p_totals->transactions++;
+    p_totals->busy_us += busy_us;
+
+    if (b_is_ok)
+    {
+        p_totals->bytes += bytes;
+    }
+    else
+    {
+        p_totals->errors++;
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,277 @@
+/***************************************************************************//**
+* @file    mlx90614_cal.c
+* @version 1.0.0
+*
+* @brief Per-sensor object temperature calibration for MLX90614.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_cal.h"
+#include "mlx90614_support.h"
+
+// Segment start value of unused table entries, above any linearized value
+#define SEGMENT_UNUSED  0xFFFF
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Precompute zone segments from zone points.
+ *
+ * @param p_cal Pointer to calibration.
+ * @param zone_idx Zone index 0 or 1.
+ */
+static void
+build_segments(mlx90614_cal_t *p_cal, uint8_t zone_idx);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+bool
+mlx90614_cal_set(mlx90614_t *p_mlx, uint8_t zone,
+    const mlx90614_cal_point_t *p_points, uint8_t count)
+{
+    bool b_result = true;
+    mlx90614_cal_point_t sorted[MLX90614_CAL_MAX_POINTS];
+
+    if ((zone < 1) || (zone > 2) || (count > MLX90614_CAL_MAX_POINTS))
+    {
+        MLX_ERROR("Invalid calibration zone or point count.", __FUNCTION__);
+        b_result = false;
+    }
+
+    // Insertion sort by raw value, reject duplicate raw values
+    for (uint8_t idx = 0; b_result && (idx < count); idx++)
+    {
+        uint8_t pos = idx;
+
+        while ((pos > 0) && (sorted[pos - 1].raw > p_points[idx].raw))
+        {
+            sorted[pos] = sorted[pos - 1];
+            pos--;
+        }
+        sorted[pos] = p_points[idx];
+
+        if ((pos > 0) && (sorted[pos - 1].raw == p_points[idx].raw))
+        {
+            MLX_ERROR("Duplicate calibration point.", __FUNCTION__);
+            b_result = false;
+        }
+    }
+
+    if (b_result && (p_mlx->p_cal == NULL))
+    {
+        if ((p_mlx->p_cal = malloc(sizeof(mlx90614_cal_t))) == NULL)
+        {
+            MLX_ERROR("Not enough free memory.", __FUNCTION__);
+            b_result = false;
+        }
+        else
+        {
+            memset(p_mlx->p_cal, 0, sizeof(mlx90614_cal_t));
+        }
+    }
+
+    if (b_result)
+    {
+        mlx90614_cal_t *p_cal = p_mlx->p_cal;
+
+        p_cal->point_count[zone - 1] = count;
+        memcpy(p_cal->points[zone - 1], sorted,
+            count * sizeof(mlx90614_cal_point_t));
+        build_segments(p_cal, (uint8_t)(zone - 1));
+    }
+
+    return b_result;
+}
+
+void
+mlx90614_cal_clear(mlx90614_t *p_mlx)
+{
+    if (p_mlx->p_cal)
+    {
+        free(p_mlx->p_cal);
+        p_mlx->p_cal = NULL;
+    }
+}
+
+uint32_t
+mlx90614_cal_save(mlx90614_t *p_mlx, uint8_t *p_buffer, uint32_t buffer_size)
+{
+    uint32_t length = 0;
+    const mlx90614_cal_t *p_cal = p_mlx->p_cal;
+
+    if (p_cal && (buffer_size >= 12 + 4 * (uint32_t)(p_cal->point_count[0] +
+        p_cal->point_count[1]) + 2))
+    {
+        uint64_t id = p_mlx->profile.id;
+
+        p_buffer[0] = MLX90614_CAL_MAGIC;
+        p_buffer[1] = MLX90614_CAL_VERSION;
+        for (uint8_t idx = 0; idx < 8; idx++)
+        {
+            p_buffer[2 + idx] = (uint8_t)(id >> (8 * idx));
+        }
+        p_buffer[10] = p_cal->point_count[0];
+        p_buffer[11] = p_cal->point_count[1];
+        length = 12;
+
+        for (uint8_t zone_idx = 0; zone_idx < 2; zone_idx++)
+        {
+            for (uint8_t idx = 0; idx < p_cal->point_count[zone_idx]; idx++)
+            {
+                const mlx90614_cal_point_t *p_pt = &p_cal->points[zone_idx][idx];
+
+                p_buffer[length++] = (uint8_t)(p_pt->raw);
+                p_buffer[length++] = (uint8_t)(p_pt->raw >> 8);
+                p_buffer[length++] = (uint8_t)(p_pt->ref);
+                p_buffer[length++] = (uint8_t)(p_pt->ref >> 8);
+            }
+        }
+
+        uint16_t crc = mlx90614_crc16(0xFFFF, p_buffer, length);
+        p_buffer[length++] = (uint8_t)(crc);
+        p_buffer[length++] = (uint8_t)(crc >> 8);
+    }
+
+    return length;
+}
+
+bool
+mlx90614_cal_load(mlx90614_t *p_mlx, const uint8_t *p_buffer,
+    uint32_t length)
+{
+    bool b_result = false;
+    mlx90614_cal_point_t points[MLX90614_CAL_MAX_POINTS];
+    uint64_t id = 0;
+
+    if ((length >= 14) && (p_buffer[0] == MLX90614_CAL_MAGIC) &&
+        (p_buffer[1] == MLX90614_CAL_VERSION) &&
+        (p_buffer[10] <= MLX90614_CAL_MAX_POINTS) &&
+        (p_buffer[11] <= MLX90614_CAL_MAX_POINTS) &&
+        (length == 12 + 4 * (uint32_t)(p_buffer[10] + p_buffer[11]) + 2) &&
+        (mlx90614_crc16(0xFFFF, p_buffer, length - 2) ==
+            (uint16_t)(p_buffer[length - 2] | (p_buffer[length - 1] << 8))))
+    {
+        for (uint8_t idx = 0; idx < 8; idx++)
+        {
+            id |= (uint64_t)p_buffer[2 + idx] << (8 * idx);
+        }
+
+        if (id == p_mlx->profile.id)
+        {
+            b_result = true;
+        }
+        else
+        {
+            MLX_ERROR("Calibration belongs to a different device.",
+                __FUNCTION__);
+        }
+    }
+    else
+    {
+        MLX_ERROR("Invalid calibration blob.", __FUNCTION__);
+    }
+
+    const uint8_t *p_data = &p_buffer[12];
+
+    for (uint8_t zone_idx = 0; b_result && (zone_idx < 2); zone_idx++)
+    {
+        uint8_t count = p_buffer[10 + zone_idx];
+
+        for (uint8_t idx = 0; idx < count; idx++)
+        {
+            points[idx].raw = (uint16_t)(p_data[0] | (p_data[1] << 8));
+            points[idx].ref = (uint16_t)(p_data[2] | (p_data[3] << 8));
+            p_data += 4;
+        }
+
+        b_result = mlx90614_cal_set(p_mlx, (uint8_t)(zone_idx + 1), points,
+            count);
+    }
+
+    return b_result;
+}
+
+uint16_t
+mlx90614_cal_apply(const mlx90614_cal_t *p_cal, uint8_t zone, uint16_t raw)
+{
+    uint16_t result = raw;
+    uint8_t zone_idx = (uint8_t)((zone - 1) & 1);
+
+    if ((p_cal->point_count[zone_idx] > 0) && ((raw & 0x8000) == 0))
+    {
+        const mlx90614_cal_segment_t *p_seg = p_cal->segments[zone_idx];
+        uint32_t idx = 0;
+
+        // Branch-free search for last segment starting at or below raw,
+        // unused entries start above any linearized value
+        for (uint32_t step = MLX90614_CAL_MAX_POINTS / 2; step > 0; step >>= 1)
+        {
+            idx += step * (uint32_t)(raw >= p_seg[idx + step].x0);
+        }
+        p_seg = &p_seg[idx];
+
+        int32_t value = p_seg->y0 + (int32_t)(((int64_t)((int32_t)raw -
+            p_seg->x0) * p_seg->slope + 0x8000) >> 16);
+
+        value = (value < 0) ? 0 : value;
+        result = (uint16_t)((value > 0x7FFF) ? 0x7FFF : value);
+    }
+
+    return result;
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static void
+build_segments(mlx90614_cal_t *p_cal, uint8_t zone_idx)
+{
+    const mlx90614_cal_point_t *p_pts = p_cal->points[zone_idx];
+    mlx90614_cal_segment_t *p_seg = p_cal->segments[zone_idx];
+    uint8_t count = p_cal->point_count[zone_idx];
+
+    for (uint8_t idx = 0; idx < MLX90614_CAL_MAX_POINTS; idx++)
+    {
+        p_seg[idx].x0 = SEGMENT_UNUSED;
+        p_seg[idx].y0 = 0;
+        p_seg[idx].slope = 0;
+    }
+
+    if (count == 1)
+    {
+        // Single point calibration is a pure offset
+        p_seg[0].x0 = p_pts[0].raw;
+        p_seg[0].y0 = p_pts[0].ref;
+        p_seg[0].slope = 1 << 16;
+    }
+
+    for (uint8_t idx = 0; idx + 1 < count; idx++)
+    {
+        p_seg[idx].x0 = p_pts[idx].raw;
+        p_seg[idx].y0 = p_pts[idx].ref;
+        p_seg[idx].slope = (int32_t)((((int64_t)p_pts[idx + 1].ref -
+            p_pts[idx].ref) * 65536) / (p_pts[idx + 1].raw - p_pts[idx].raw));
+    }
+
+    // First segment also covers values below first point
+    p_seg[0].x0 = 0;
+    if (count > 0)
+    {
+        p_seg[0].y0 = p_pts[0].ref - (int32_t)(((int64_t)p_pts[0].raw *
+            p_seg[0].slope + 0x8000) >> 16);
+    }
+}
+
+/* [] END OF FILE */
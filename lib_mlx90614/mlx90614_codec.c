@@ -0,0 +1,258 @@
+/***************************************************************************//**
+* @file    mlx90614_codec.c
+* @version 1.0.0
+*
+* @brief Compact binary encoding of MLX90614 sample streams.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_codec.h"
+#include "mlx90614_support.h"
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Write zig-zag encoded signed value as varint.
+ *
+ * @param p_data Output position.
+ * @param value Value to be written.
+ *
+ * @return Number of bytes written.
+ */
+static uint32_t
+varint_write(uint8_t *p_data, int32_t value);
+
+/**
+ * @brief Read zig-zag encoded varint as signed value.
+ *
+ * @param p_dec Pointer to decoder state.
+ * @param p_value Pointer to variable to store decoded value.
+ *
+ * @return True on success, false if block data is exhausted or malformed.
+ */
+static bool
+varint_read(mlx90614_decoder_t *p_dec, int32_t *p_value);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+bool
+mlx90614_encoder_init(mlx90614_encoder_t *p_enc, uint8_t *p_buffer,
+    uint32_t buffer_size)
+{
+    bool b_result = false;
+
+    if (buffer_size >= MLX90614_CODEC_MIN_BLOCK_SIZE)
+    {
+        p_enc->p_buffer = p_buffer;
+        p_enc->buffer_size = buffer_size;
+        p_enc->length = MLX90614_CODEC_HEADER_SIZE;
+        p_enc->count = 0;
+        p_enc->prev_timestamp = 0;
+        p_enc->prev_delta = 0;
+        p_enc->prev_raw = 0;
+
+        p_buffer[0] = MLX90614_CODEC_MAGIC;
+        p_buffer[1] = MLX90614_CODEC_VERSION;
+        b_result = true;
+    }
+
+    return b_result;
+}
+
+bool
+mlx90614_encoder_put(mlx90614_encoder_t *p_enc,
+    const mlx90614_sample_t *p_sample)
+{
+    bool b_result = false;
+    uint8_t *p_buf = p_enc->p_buffer;
+
+    if (p_enc->count == 0)
+    {
+        // First sample is stored verbatim in block header
+        p_buf[2] = p_sample->i2c_addr;
+        p_buf[3] = p_sample->channel;
+        p_buf[6] = (uint8_t)(p_sample->timestamp_ms);
+        p_buf[7] = (uint8_t)(p_sample->timestamp_ms >> 8);
+        p_buf[8] = (uint8_t)(p_sample->timestamp_ms >> 16);
+        p_buf[9] = (uint8_t)(p_sample->timestamp_ms >> 24);
+        p_buf[10] = (uint8_t)(p_sample->raw);
+        p_buf[11] = (uint8_t)(p_sample->raw >> 8);
+        p_enc->prev_delta = 0;
+        b_result = true;
+    }
+    else if ((p_enc->count < UINT16_MAX) &&
+        (p_buf[2] == p_sample->i2c_addr) && (p_buf[3] == p_sample->channel) &&
+        (p_enc->length + MLX90614_CODEC_MAX_SAMPLE_SIZE +
+            MLX90614_CODEC_CRC_SIZE <= p_enc->buffer_size))
+    {
+        int32_t delta = (int32_t)(p_sample->timestamp_ms -
+            p_enc->prev_timestamp);
+
+        p_enc->length += varint_write(&p_buf[p_enc->length],
+            delta - p_enc->prev_delta);
+        p_enc->length += varint_write(&p_buf[p_enc->length],
+            (int16_t)(p_sample->raw - p_enc->prev_raw));
+        p_enc->prev_delta = delta;
+        b_result = true;
+    }
+
+    if (b_result)
+    {
+        p_enc->prev_timestamp = p_sample->timestamp_ms;
+        p_enc->prev_raw = p_sample->raw;
+        p_enc->count++;
+    }
+
+    return b_result;
+}
+
+uint32_t
+mlx90614_encoder_finish(mlx90614_encoder_t *p_enc)
+{
+    uint32_t result = 0;
+    uint8_t *p_buf = p_enc->p_buffer;
+
+    if (p_enc->count > 0)
+    {
+        p_buf[4] = (uint8_t)(p_enc->count);
+        p_buf[5] = (uint8_t)(p_enc->count >> 8);
+
+        uint16_t crc = mlx90614_crc16(0xFFFF, p_buf, p_enc->length);
+        p_buf[p_enc->length] = (uint8_t)(crc);
+        p_buf[p_enc->length + 1] = (uint8_t)(crc >> 8);
+
+        result = p_enc->length + MLX90614_CODEC_CRC_SIZE;
+    }
+
+    return result;
+}
+
+bool
+mlx90614_decoder_init(mlx90614_decoder_t *p_dec, const uint8_t *p_buffer,
+    uint32_t length)
+{
+    bool b_result = false;
+
+    if ((length >= MLX90614_CODEC_MIN_BLOCK_SIZE) &&
+        (p_buffer[0] == MLX90614_CODEC_MAGIC) &&
+        (p_buffer[1] == MLX90614_CODEC_VERSION))
+    {
+        uint32_t data_len = length - MLX90614_CODEC_CRC_SIZE;
+        uint16_t crc = (uint16_t)(p_buffer[data_len] |
+            (p_buffer[data_len + 1] << 8));
+
+        if (crc == mlx90614_crc16(0xFFFF, p_buffer, data_len))
+        {
+            p_dec->p_buffer = p_buffer;
+            p_dec->length = data_len;
+            p_dec->offset = MLX90614_CODEC_HEADER_SIZE;
+            p_dec->i2c_addr = p_buffer[2];
+            p_dec->channel = p_buffer[3];
+            p_dec->count = (uint16_t)(p_buffer[4] | (p_buffer[5] << 8));
+            p_dec->index = 0;
+            p_dec->prev_delta = 0;
+            b_result = true;
+        }
+        else
+        {
+            MLX_ERROR("Block CRC mismatch.", __FUNCTION__);
+        }
+    }
+
+    return b_result;
+}
+
+bool
+mlx90614_decoder_get(mlx90614_decoder_t *p_dec, mlx90614_sample_t *p_sample)
+{
+    bool b_result = false;
+    const uint8_t *p_buf = p_dec->p_buffer;
+
+    if (p_dec->index == 0 && p_dec->count > 0)
+    {
+        p_dec->prev_timestamp = (uint32_t)p_buf[6] |
+            ((uint32_t)p_buf[7] << 8) | ((uint32_t)p_buf[8] << 16) |
+            ((uint32_t)p_buf[9] << 24);
+        p_dec->prev_raw = (uint16_t)(p_buf[10] | (p_buf[11] << 8));
+        b_result = true;
+    }
+    else if (p_dec->index < p_dec->count)
+    {
+        int32_t dod;
+        int32_t delta_raw;
+
+        if (varint_read(p_dec, &dod) && varint_read(p_dec, &delta_raw))
+        {
+            p_dec->prev_delta += dod;
+            p_dec->prev_timestamp += (uint32_t)p_dec->prev_delta;
+            p_dec->prev_raw = (uint16_t)(p_dec->prev_raw + delta_raw);
+            b_result = true;
+        }
+    }
+
+    if (b_result)
+    {
+        p_sample->timestamp_ms = p_dec->prev_timestamp;
+        p_sample->raw = p_dec->prev_raw;
+        p_sample->i2c_addr = p_dec->i2c_addr;
+        p_sample->channel = p_dec->channel;
+        p_dec->index++;
+    }
+
+    return b_result;
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static uint32_t
+varint_write(uint8_t *p_data, int32_t value)
+{
+    uint32_t zigzag = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    uint32_t length = 0;
+
+    while (zigzag >= 0x80)
+    {
+        p_data[length++] = (uint8_t)(zigzag | 0x80);
+        zigzag >>= 7;
+    }
+    p_data[length++] = (uint8_t)zigzag;
+
+    return length;
+}
+
+static bool
+varint_read(mlx90614_decoder_t *p_dec, int32_t *p_value)
+{
+    uint32_t zigzag = 0;
+    bool b_result = false;
+
+    for (uint8_t shift = 0; (shift < 35) && (p_dec->offset < p_dec->length);
+        shift += 7)
+    {
+        uint8_t byte = p_dec->p_buffer[p_dec->offset++];
+
+        zigzag |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            *p_value = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+            b_result = true;
+            break;
+        }
+    }
+
+    return b_result;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,192 @@
+/***************************************************************************//**
+* @file    mlx90614_decim.c
+* @version 1.0.0
+*
+* @brief Oversampling and decimation of MLX90614 raw temperature streams.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_decim.h"
+#include "mlx90614_support.h"
+
+// Input resolution of raw linearized values
+#define INPUT_BITS      15
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Compute base 2 logarithm of ratio.
+ *
+ * @param num Numerator.
+ * @param den Denominator, not greater than numerator.
+ *
+ * @return log2(num / den) with 8 fractional bits.
+ */
+static uint16_t
+log2_ratio_q8(uint64_t num, uint64_t den);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+bool
+mlx90614_decim_init(mlx90614_decim_t *p_dec, uint16_t ratio, uint8_t order)
+{
+    bool b_result = true;
+
+    if ((ratio < 2) || (ratio > MLX90614_DECIM_RATIO_MAX) || (order < 1) ||
+        (order > MLX90614_DECIM_ORDER_MAX))
+    {
+        MLX_ERROR("Invalid decimation ratio or filter order.", __FUNCTION__);
+        b_result = false;
+    }
+    else
+    {
+        // Filter impulse response, boxcar convolved order times
+        uint32_t h[MLX90614_DECIM_ORDER_MAX * (MLX90614_DECIM_RATIO_MAX - 1)
+            + 1];
+        uint32_t len = 1;
+        uint64_t sum_h2 = 0;
+
+        memset(p_dec, 0, sizeof(mlx90614_decim_t));
+        p_dec->ratio = ratio;
+        p_dec->order = order;
+        p_dec->gain = 1;
+        p_dec->latency_samples = (uint16_t)(order * (ratio - 1) / 2);
+
+        h[0] = 1;
+        for (uint8_t stage = 0; stage < order; stage++)
+        {
+            p_dec->gain *= ratio;
+
+            for (uint32_t idx = len; idx < len + ratio - 1; idx++)
+            {
+                h[idx] = 0;
+            }
+            len += ratio - 1U;
+
+            // Moving sum of length ratio as difference of prefix sums
+            for (uint32_t idx = 1; idx < len; idx++)
+            {
+                h[idx] += h[idx - 1];
+            }
+            for (uint32_t idx = len - 1; idx >= ratio; idx--)
+            {
+                h[idx] -= h[idx - ratio];
+            }
+        }
+
+        for (uint32_t idx = 0; idx < len; idx++)
+        {
+            sum_h2 += (uint64_t)h[idx] * h[idx];
+        }
+
+        // Noise power reduction is gain^2 / sum(h^2), half of it in bits
+        p_dec->effective_bits_q8 = (uint16_t)((INPUT_BITS << 8) +
+            log2_ratio_q8(p_dec->gain * p_dec->gain, sum_h2) / 2);
+    }
+
+    return b_result;
+}
+
+bool
+mlx90614_decim_push(mlx90614_decim_t *p_dec,
+    const mlx90614_sample_t *p_sample, mlx90614_decimated_t *p_output)
+{
+    bool b_result = false;
+    uint64_t value;
+
+    if ((p_sample->raw & 0x8000) == 0)
+    {
+        p_dec->last_raw = p_sample->raw;
+        p_dec->b_has_input = true;
+    }
+
+    if (p_dec->b_has_input)
+    {
+        // Integrators at input rate, wrap around is harmless
+        value = p_dec->last_raw;
+        for (uint8_t stage = 0; stage < p_dec->order; stage++)
+        {
+            p_dec->integ[stage] += value;
+            value = p_dec->integ[stage];
+        }
+
+        if (++p_dec->phase >= p_dec->ratio)
+        {
+            p_dec->phase = 0;
+
+            // Combs at output rate
+            for (uint8_t stage = 0; stage < p_dec->order; stage++)
+            {
+                uint64_t delayed = p_dec->comb[stage];
+
+                p_dec->comb[stage] = value;
+                value -= delayed;
+            }
+
+            if (p_dec->outputs < p_dec->order)
+            {
+                p_dec->outputs++;
+            }
+
+            p_output->timestamp_ms = p_sample->timestamp_ms;
+            p_output->value = (int32_t)((((int64_t)value <<
+                MLX90614_DECIM_FRAC_BITS) + (int64_t)(p_dec->gain / 2)) /
+                (int64_t)p_dec->gain);
+            p_output->b_is_settled = (p_dec->outputs >= p_dec->order);
+            b_result = true;
+        }
+    }
+
+    return b_result;
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static uint16_t
+log2_ratio_q8(uint64_t num, uint64_t den)
+{
+    uint16_t result = 0;
+
+    // Integer part
+    while (num >= 2 * den)
+    {
+        den *= 2;
+        result += 1 << 8;
+    }
+
+    // Keep ratio in Q30 within 64 bits
+    while (num >= (1ULL << 32))
+    {
+        num >>= 1;
+        den >>= 1;
+    }
+
+    // Fractional part by repeated squaring of ratio in Q30
+    uint64_t x = (num << 30) / den;
+
+    for (int8_t bit = 7; bit >= 0; bit--)
+    {
+        x = (x * x) >> 30;
+        if (x >= (2ULL << 30))
+        {
+            x >>= 1;
+            result |= (uint16_t)(1 << bit);
+        }
+    }
+
+    return result;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,187 @@
+/***************************************************************************//**
+* @file    mlx90614_eeprom.c
+* @version 1.0.0
+*
+* @brief MLX90614 EEPROM dump, restore and clone.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_eeprom.h"
+#include "lib_mlx90614_lock.h"
+#include "mlx90614_support.h"
+
+/*******************************************************************************
+* Global variables
+*******************************************************************************/
+
+// User writable cells and bits which may be written on restore
+static const struct
+{
+    uint8_t reg;
+    uint16_t mask;
+} user_cells[] = {
+    { MLX90614_EREG_TOMAX, 0xFFFF },
+    { MLX90614_EREG_TOMIN, 0xFFFF },
+    { MLX90614_EREG_PWMCTRL, 0xFFFF },
+    { MLX90614_EREG_TA_RANGE, 0xFFFF },
+    { MLX90614_EREG_ECC, 0xFFFF },
+    { MLX90614_EREG_CONF1, (uint16_t)~MLX90614_CONF1_FACTORY_MASK },
+    { MLX90614_EREG_SMBUS_ADDR, 0x00FF }
+};
+
+#define USER_CELL_COUNT     (sizeof(user_cells) / sizeof(user_cells[0]))
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+uint32_t
+mlx90614_eeprom_dump(mlx90614_t *p_mlx, uint8_t *p_buffer,
+    uint32_t buffer_size)
+{
+    uint32_t length = 0;
+    bool b_result = (buffer_size >= MLX90614_EEPROM_DUMP_SIZE);
+
+    if (!b_result)
+    {
+        MLX_ERROR("Buffer too small.", __FUNCTION__);
+    }
+
+    mlx90614_lock_acquire(p_mlx);
+
+    for (uint8_t idx = 0; b_result && (idx < MLX90614_EEPROM_CELLS); idx++)
+    {
+        int16_t value;
+
+        b_result = mlx90614_reg_read(p_mlx,
+            (uint8_t)(MLX90614_EEPROM_FIRST + idx), &value);
+        p_buffer[2 + 2 * idx] = (uint8_t)value;
+        p_buffer[3 + 2 * idx] = (uint8_t)(value >> 8);
+    }
+
+    mlx90614_lock_release(p_mlx);
+
+    if (b_result)
+    {
+        p_buffer[0] = MLX90614_EEPROM_MAGIC;
+        p_buffer[1] = MLX90614_EEPROM_VERSION;
+        length = MLX90614_EEPROM_DUMP_SIZE - 2;
+
+        uint16_t crc = mlx90614_crc16(0xFFFF, p_buffer, length);
+        p_buffer[length++] = (uint8_t)crc;
+        p_buffer[length++] = (uint8_t)(crc >> 8);
+    }
+
+    return length;
+}
+
+uint16_t
+mlx90614_eeprom_dump_cell(const uint8_t *p_buffer, uint8_t reg)
+{
+    uint8_t idx = (uint8_t)((reg - MLX90614_EEPROM_FIRST) &
+        (MLX90614_EEPROM_CELLS - 1));
+
+    return (uint16_t)(p_buffer[2 + 2 * idx] | (p_buffer[3 + 2 * idx] << 8));
+}
+
+bool
+mlx90614_eeprom_restore(mlx90614_t *p_mlx, const uint8_t *p_buffer,
+    uint32_t length, bool b_with_address, uint8_t *p_written)
+{
+    bool b_result = false;
+    bool b_is_same_device = true;
+    bool b_is_changed = false;
+    uint8_t written = 0;
+
+    if ((length == MLX90614_EEPROM_DUMP_SIZE) &&
+        (p_buffer[0] == MLX90614_EEPROM_MAGIC) &&
+        (p_buffer[1] == MLX90614_EEPROM_VERSION) &&
+        (mlx90614_crc16(0xFFFF, p_buffer, length - 2) ==
+            (uint16_t)(p_buffer[length - 2] | (p_buffer[length - 1] << 8))))
+    {
+        b_result = true;
+    }
+    else
+    {
+        MLX_ERROR("Invalid EEPROM dump.", __FUNCTION__);
+    }
+
+    mlx90614_lock_acquire(p_mlx);
+
+    for (uint8_t idx = 0; b_result && (idx < 4); idx++)
+    {
+        if (mlx90614_eeprom_dump_cell(p_buffer,
+            (uint8_t)(MLX90614_EREG_ID1 + idx)) != p_mlx->device_id[idx])
+        {
+            b_is_same_device = false;
+        }
+    }
+
+    if (b_result && !b_is_same_device)
+    {
+        MLX_DEBUG_DEV("Dump is from another sensor, cloning", __FUNCTION__,
+            p_mlx);
+    }
+
+    for (uint8_t idx = 0; b_result && (idx < USER_CELL_COUNT); idx++)
+    {
+        uint8_t reg = user_cells[idx].reg;
+        uint16_t mask = user_cells[idx].mask;
+        int16_t current;
+        uint16_t target;
+
+        if ((reg == MLX90614_EREG_SMBUS_ADDR) && !b_with_address)
+        {
+            // Address kept
+        }
+        else if ((b_result = mlx90614_reg_read(p_mlx, reg, &current)))
+        {
+            target = (uint16_t)(((uint16_t)current & ~mask) |
+                (mlx90614_eeprom_dump_cell(p_buffer, reg) & mask));
+
+            if (target != (uint16_t)current)
+            {
+                MLX_DEBUG_DEV("Writing 0x%02X: 0x%04X -> 0x%04X", __FUNCTION__,
+                    p_mlx, reg, (uint16_t)current, target);
+
+                b_is_changed = true;
+                b_result = mlx90614_eeprom_write(p_mlx, reg, (int16_t)target) &&
+                    mlx90614_reg_read(p_mlx, reg, &current) &&
+                    ((uint16_t)current == target);
+
+                if (b_result)
+                {
+                    written++;
+                }
+                else
+                {
+                    MLX_ERROR("EEPROM cell 0x%02X not written.", __FUNCTION__,
+                        reg);
+                }
+            }
+        }
+    }
+
+    // Keep capability profile in sync even after partial restore, a failed
+    // cell may also have changed
+    if (b_is_changed && !mlx90614_load_profile(p_mlx))
+    {
+        b_result = false;
+    }
+
+    mlx90614_lock_release(p_mlx);
+
+    if (p_written)
+    {
+        *p_written = written;
+    }
+
+    return b_result;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,268 @@
+/***************************************************************************//**
+* @file    mlx90614_guard.c
+* @version 1.0.0
+*
+* @brief Plausibility guarded temperature reads for MLX90614.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_guard.h"
+#include "lib_mlx90614_lock.h"
+#include "mlx90614_support.h"
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Get channel index of temperature register.
+ *
+ * @param reg Temperature RAM register.
+ *
+ * @return Channel index 0 (TA) to 2 (TOBJ2).
+ */
+static uint8_t
+channel_index(uint8_t reg);
+
+/**
+ * @brief Get allowed change of value since reference.
+ *
+ * @param rate Rate limit [raw LSB/s].
+ * @param elapsed_ms Time since reference.
+ *
+ * @return Allowed change [raw LSB], including noise level.
+ */
+static uint32_t
+change_limit(uint32_t rate, uint32_t elapsed_ms);
+
+/**
+ * @brief Store accepted sample as channel reference.
+ *
+ * @param p_guard Pointer to guard state.
+ * @param reg Temperature RAM register.
+ * @param raw Raw register value.
+ * @param time_ms Sample time.
+ */
+static void
+accept(mlx90614_guard_t *p_guard, uint8_t reg, uint16_t raw, uint32_t time_ms);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+bool
+mlx90614_guard_enable(mlx90614_t *p_mlx, uint16_t max_rate)
+{
+    bool b_result = true;
+
+    if (p_mlx->p_guard == NULL)
+    {
+        if ((p_mlx->p_guard = malloc(sizeof(mlx90614_guard_t))) == NULL)
+        {
+            MLX_ERROR("Not enough free memory.", __FUNCTION__);
+            b_result = false;
+        }
+        else
+        {
+            memset(p_mlx->p_guard, 0, sizeof(mlx90614_guard_t));
+        }
+    }
+
+    if (b_result)
+    {
+        p_mlx->p_guard->max_rate = max_rate;
+        p_mlx->p_guard->max_ta_delta =
+            (p_mlx->profile.tobj_max > p_mlx->profile.tobj_min) ?
+            (uint16_t)(p_mlx->profile.tobj_max - p_mlx->profile.tobj_min) :
+            0;
+    }
+
+    return b_result;
+}
+
+void
+mlx90614_guard_disable(mlx90614_t *p_mlx)
+{
+    if (p_mlx->p_guard)
+    {
+        free(p_mlx->p_guard);
+        p_mlx->p_guard = NULL;
+    }
+}
+
+const mlx90614_guard_stats_t
+*mlx90614_guard_get_stats(mlx90614_t *p_mlx)
+{
+    return p_mlx->p_guard ? &p_mlx->p_guard->stats : NULL;
+}
+
+bool
+mlx90614_guard_check(const mlx90614_guard_t *p_guard,
+    const mlx90614_profile_t *p_profile, uint8_t reg, uint16_t raw,
+    uint32_t time_ms)
+{
+    bool b_result = true;
+    uint8_t idx = channel_index(reg);
+    int32_t low = (idx == 0) ? p_profile->ta_min : p_profile->tobj_min;
+    int32_t high = (idx == 0) ? p_profile->ta_max : p_profile->tobj_max;
+
+    if (raw & 0x8000)
+    {
+        b_result = false;
+    }
+    else if (((int32_t)raw < low - MLX90614_GUARD_RANGE_MARGIN) ||
+        ((int32_t)raw > high + MLX90614_GUARD_RANGE_MARGIN))
+    {
+        b_result = false;
+    }
+    else if (p_guard->b_has_last[idx])
+    {
+        uint32_t rate = (idx == 0) ? MLX90614_GUARD_TA_RATE :
+            p_guard->max_rate;
+        int32_t diff = (int32_t)raw - (int32_t)p_guard->last[idx];
+
+        if ((uint32_t)((diff < 0) ? -diff : diff) >
+            change_limit(rate, time_ms - p_guard->last_ms[idx]))
+        {
+            b_result = false;
+        }
+    }
+
+    // Object value consistent with ambient, which may have drifted since
+    if (b_result && (idx != 0) && p_guard->b_has_last[0])
+    {
+        int32_t diff = (int32_t)raw - (int32_t)p_guard->last[0];
+        uint32_t limit = (uint32_t)p_guard->max_ta_delta +
+            MLX90614_GUARD_RANGE_MARGIN + change_limit(MLX90614_GUARD_TA_RATE,
+            time_ms - p_guard->last_ms[0]);
+
+        if ((uint32_t)((diff < 0) ? -diff : diff) > limit)
+        {
+            b_result = false;
+        }
+    }
+
+    return b_result;
+}
+
+bool
+mlx90614_guard_read(mlx90614_t *p_mlx, uint8_t reg, int16_t *p_raw)
+{
+    mlx90614_guard_t *p_guard = p_mlx->p_guard;
+    bool b_result = false;
+    int16_t first;
+    int16_t second;
+    uint32_t now_ms;
+
+    // Re-read and guard state update are one sequence
+    mlx90614_lock_acquire(p_mlx);
+
+    p_guard->stats.reads++;
+
+    if (mlx90614_reg_read(p_mlx, reg, &first))
+    {
+        now_ms = mlx90614_get_time_ms();
+
+        if (mlx90614_guard_check(p_guard, &p_mlx->profile, reg,
+            (uint16_t)first, now_ms))
+        {
+            *p_raw = first;
+            b_result = true;
+        }
+        else
+        {
+            MLX_DEBUG_DEV("Implausible 0x%04X, re-reading", __FUNCTION__,
+                p_mlx, (uint16_t)first);
+            p_guard->stats.rereads++;
+
+            if (mlx90614_reg_read_op(p_mlx, reg, &second, MLX_BUSOP_RETRY))
+            {
+                int32_t diff = (int32_t)(uint16_t)second -
+                    (int32_t)(uint16_t)first;
+
+                if (mlx90614_guard_check(p_guard, &p_mlx->profile, reg,
+                    (uint16_t)second, now_ms))
+                {
+                    p_guard->stats.rejected++;
+                    *p_raw = second;
+                    b_result = true;
+                }
+                else if ((diff >= -MLX90614_GUARD_NOISE_LSB) &&
+                    (diff <= MLX90614_GUARD_NOISE_LSB))
+                {
+                    // Change is real, error flagged values are reported too
+                    p_guard->stats.confirmed++;
+                    *p_raw = second;
+                    b_result = true;
+                }
+                else
+                {
+                    p_guard->stats.unresolved++;
+                    MLX_ERROR("Re-read does not confirm register 0x%02X.",
+                        __FUNCTION__, reg);
+                }
+            }
+        }
+
+        if (b_result && ((*p_raw & 0x8000) == 0))
+        {
+            accept(p_guard, reg, (uint16_t)*p_raw, now_ms);
+        }
+    }
+
+    mlx90614_lock_release(p_mlx);
+
+    return b_result;
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static uint8_t
+channel_index(uint8_t reg)
+{
+    uint8_t idx = 0;
+
+    if (reg == MLX90614_RREG_TOBJ1)
+    {
+        idx = 1;
+    }
+    else if (reg == MLX90614_RREG_TOBJ2)
+    {
+        idx = 2;
+    }
+
+    return idx;
+}
+
+static uint32_t
+change_limit(uint32_t rate, uint32_t elapsed_ms)
+{
+    uint32_t limit = MLX90614_GUARD_NOISE_LSB;
+
+    // Saturate allowed change, long pauses allow any change
+    limit += (elapsed_ms < 0x7FFFFFFFUL / (rate + 1)) ?
+        rate * elapsed_ms / 1000 : 0x7FFF;
+
+    return limit;
+}
+
+static void
+accept(mlx90614_guard_t *p_guard, uint8_t reg, uint16_t raw, uint32_t time_ms)
+{
+    uint8_t idx = channel_index(reg);
+
+    p_guard->b_has_last[idx] = true;
+    p_guard->last[idx] = raw;
+    p_guard->last_ms[idx] = time_ms;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,194 @@
+/***************************************************************************//**
+* @file    mlx90614_hub.c
+* @version 1.0.0
+*
+* @brief Raw sample distribution to consumers with per-consumer units.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_hub.h"
+#include "mlx90614_support.h"
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Get channel bit of sample.
+ *
+ * @param p_sample Pointer to sample.
+ *
+ * @return MLX90614_CH_* bit, 0 for non-temperature registers.
+ */
+static uint8_t
+sample_channel_bit(const mlx90614_sample_t *p_sample);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+void
+mlx90614_hub_init(mlx90614_hub_t *p_hub)
+{
+    memset(p_hub, 0, sizeof(mlx90614_hub_t));
+}
+
+int
+mlx90614_hub_subscribe(mlx90614_hub_t *p_hub, mlx_temperature_unit unit,
+    uint8_t channels, uint8_t i2c_addr, mlx90614_consumer_t consumer,
+    void *p_context)
+{
+    int id = -1;
+
+    for (int idx = 0; (id < 0) && (idx < MLX90614_HUB_MAX_CONSUMERS); idx++)
+    {
+        if (p_hub->subs[idx].consumer == NULL)
+        {
+            p_hub->subs[idx].consumer = consumer;
+            p_hub->subs[idx].p_context = p_context;
+            p_hub->subs[idx].unit = unit;
+            p_hub->subs[idx].channels = channels;
+            p_hub->subs[idx].i2c_addr = i2c_addr;
+            id = idx;
+        }
+    }
+
+    if (id < 0)
+    {
+        MLX_ERROR("No free consumer slot.", __FUNCTION__);
+    }
+
+    return id;
+}
+
+void
+mlx90614_hub_unsubscribe(mlx90614_hub_t *p_hub, int id)
+{
+    if ((id >= 0) && (id < MLX90614_HUB_MAX_CONSUMERS))
+    {
+        p_hub->subs[id].consumer = NULL;
+    }
+}
+
+uint8_t
+mlx90614_hub_channels(mlx90614_hub_t *p_hub, uint8_t i2c_addr)
+{
+    uint8_t channels = 0;
+
+    for (uint8_t idx = 0; idx < MLX90614_HUB_MAX_CONSUMERS; idx++)
+    {
+        const mlx90614_subscription_t *p_sub = &p_hub->subs[idx];
+
+        if (p_sub->consumer &&
+            ((p_sub->i2c_addr == 0) || (p_sub->i2c_addr == i2c_addr)))
+        {
+            channels |= p_sub->channels;
+        }
+    }
+
+    return channels;
+}
+
+void
+mlx90614_hub_push(mlx90614_hub_t *p_hub, const mlx90614_sample_t *p_samples,
+    uint32_t count)
+{
+    for (uint32_t idx = 0; idx < count; idx++)
+    {
+        if (p_hub->count == MLX90614_HUB_BATCH_SIZE)
+        {
+            mlx90614_hub_flush(p_hub);
+        }
+        p_hub->pending[p_hub->count++] = p_samples[idx];
+    }
+
+    if (p_hub->count == MLX90614_HUB_BATCH_SIZE)
+    {
+        mlx90614_hub_flush(p_hub);
+    }
+}
+
+uint8_t
+mlx90614_hub_poll(mlx90614_hub_t *p_hub, mlx90614_t *p_mlx)
+{
+    mlx90614_sample_t samples[3];
+    uint8_t count = 0;
+    uint8_t channels = mlx90614_hub_channels(p_hub,
+        (uint8_t)p_mlx->i2c_addr);
+
+    if (channels)
+    {
+        count = mlx90614_read_channels(p_mlx, channels, samples);
+        mlx90614_hub_push(p_hub, samples, count);
+    }
+
+    return count;
+}
+
+void
+mlx90614_hub_flush(mlx90614_hub_t *p_hub)
+{
+    mlx90614_sample_t selected[MLX90614_HUB_BATCH_SIZE];
+    float values[MLX90614_HUB_BATCH_SIZE];
+    uint8_t bits[MLX90614_HUB_BATCH_SIZE];
+
+    for (uint32_t idx = 0; idx < p_hub->count; idx++)
+    {
+        bits[idx] = sample_channel_bit(&p_hub->pending[idx]);
+    }
+
+    for (uint8_t sub = 0; sub < MLX90614_HUB_MAX_CONSUMERS; sub++)
+    {
+        const mlx90614_subscription_t *p_sub = &p_hub->subs[sub];
+        const mlx90614_sample_t *p_batch = p_hub->pending;
+        uint32_t count = 0;
+
+        // Pass pending batch as is when consumer takes all of it
+        for (uint32_t idx = 0; p_sub->consumer && (idx < p_hub->count); idx++)
+        {
+            if ((bits[idx] & p_sub->channels) && ((p_sub->i2c_addr == 0) ||
+                (p_sub->i2c_addr == p_hub->pending[idx].i2c_addr)))
+            {
+                selected[count++] = p_hub->pending[idx];
+            }
+        }
+        if (count < p_hub->count)
+        {
+            p_batch = selected;
+        }
+
+        if (count > 0)
+        {
+            mlx90614_convert_batch(p_batch, values, count, p_sub->unit);
+            p_sub->consumer(p_sub->p_context, p_batch, values, count);
+        }
+    }
+
+    p_hub->count = 0;
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static uint8_t
+sample_channel_bit(const mlx90614_sample_t *p_sample)
+{
+    uint8_t bit = 0;
+
+    if ((p_sample->channel >= MLX90614_RREG_TA) &&
+        (p_sample->channel <= MLX90614_RREG_TOBJ2))
+    {
+        bit = (uint8_t)(1 << (p_sample->channel - MLX90614_RREG_TA));
+    }
+
+    return bit;
+}
+
+/* [] END OF FILE */
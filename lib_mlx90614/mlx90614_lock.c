@@ -0,0 +1,181 @@
+/***************************************************************************//**
+* @file    mlx90614_lock.c
+* @version 1.0.0
+*
+* @brief Thread-safe bus access for MLX90614 sensors.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_lock.h"
+#include "mlx90614_support.h"
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Check if sensor is reserved, lock mutex held.
+ *
+ * @param p_lock Pointer to bus lock.
+ * @param address Sensor address.
+ *
+ * @return True if reserved.
+ */
+static bool
+is_reserved(const mlx90614_lock_t *p_lock, uint8_t address);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+bool
+mlx90614_lock_init(mlx90614_lock_t *p_lock)
+{
+    bool b_result = false;
+
+    memset(p_lock, 0, sizeof(mlx90614_lock_t));
+
+    if (pthread_mutex_init(&p_lock->mutex, NULL) != 0)
+    {
+        MLX_ERROR("Cannot create bus mutex.", __FUNCTION__);
+    }
+    else if (pthread_cond_init(&p_lock->cond, NULL) != 0)
+    {
+        MLX_ERROR("Cannot create bus condition.", __FUNCTION__);
+        pthread_mutex_destroy(&p_lock->mutex);
+    }
+    else
+    {
+        b_result = true;
+    }
+
+    return b_result;
+}
+
+void
+mlx90614_lock_destroy(mlx90614_lock_t *p_lock)
+{
+    pthread_cond_destroy(&p_lock->cond);
+    pthread_mutex_destroy(&p_lock->mutex);
+}
+
+void
+mlx90614_lock_attach(mlx90614_t *p_mlx, mlx90614_lock_t *p_lock)
+{
+    p_mlx->p_lock = p_lock;
+}
+
+void
+mlx90614_lock_acquire(mlx90614_t *p_mlx)
+{
+    mlx90614_lock_t *p_lock = p_mlx->p_lock;
+
+    if (p_lock)
+    {
+        uint8_t address = (uint8_t)(p_mlx->i2c_addr & 0x7F);
+
+        pthread_mutex_lock(&p_lock->mutex);
+
+        if ((p_lock->depth > 0) && pthread_equal(p_lock->owner, pthread_self()))
+        {
+            p_lock->depth++;
+        }
+        else
+        {
+            while ((p_lock->depth > 0) || (p_lock->resuming > 0) ||
+                is_reserved(p_lock, address))
+            {
+                pthread_cond_wait(&p_lock->cond, &p_lock->mutex);
+            }
+
+            p_lock->owner = pthread_self();
+            p_lock->depth = 1;
+            p_lock->owner_addr = address;
+            p_lock->reserved[address >> 5] |= 1UL << (address & 31);
+        }
+
+        pthread_mutex_unlock(&p_lock->mutex);
+    }
+}
+
+void
+mlx90614_lock_release(mlx90614_t *p_mlx)
+{
+    mlx90614_lock_t *p_lock = p_mlx->p_lock;
+
+    if (p_lock)
+    {
+        pthread_mutex_lock(&p_lock->mutex);
+
+        p_lock->depth--;
+        if (p_lock->depth == 0)
+        {
+            p_lock->reserved[p_lock->owner_addr >> 5] &=
+                ~(1UL << (p_lock->owner_addr & 31));
+            pthread_cond_broadcast(&p_lock->cond);
+        }
+
+        pthread_mutex_unlock(&p_lock->mutex);
+    }
+}
+
+void
+mlx90614_lock_suspend(mlx90614_t *p_mlx, mlx90614_lock_state_t *p_state)
+{
+    mlx90614_lock_t *p_lock = p_mlx->p_lock;
+
+    if (p_lock)
+    {
+        pthread_mutex_lock(&p_lock->mutex);
+
+        p_state->depth = p_lock->depth;
+        p_state->owner_addr = p_lock->owner_addr;
+        p_lock->depth = 0;
+        pthread_cond_broadcast(&p_lock->cond);
+
+        pthread_mutex_unlock(&p_lock->mutex);
+    }
+}
+
+void
+mlx90614_lock_resume(mlx90614_t *p_mlx, const mlx90614_lock_state_t *p_state)
+{
+    mlx90614_lock_t *p_lock = p_mlx->p_lock;
+
+    if (p_lock)
+    {
+        pthread_mutex_lock(&p_lock->mutex);
+
+        // Sensor is still reserved by this sequence, wait for bus only
+        p_lock->resuming++;
+        while (p_lock->depth > 0)
+        {
+            pthread_cond_wait(&p_lock->cond, &p_lock->mutex);
+        }
+        p_lock->resuming--;
+
+        p_lock->owner = pthread_self();
+        p_lock->depth = p_state->depth;
+        p_lock->owner_addr = p_state->owner_addr;
+
+        pthread_mutex_unlock(&p_lock->mutex);
+    }
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static bool
+is_reserved(const mlx90614_lock_t *p_lock, uint8_t address)
+{
+    return (p_lock->reserved[address >> 5] & (1UL << (address & 31))) != 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,584 @@
+/***************************************************************************//**
+* @file    mlx90614_log.c
+* @version 1.0.0
+*
+* @brief Crash-safe persistent MLX90614 sample log.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+
+#ifdef MLX90614_LOG_MMAP
+#include <sys/mman.h>
+#endif
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_log.h"
+#include "mlx90614_support.h"
+
+// File header size, records follow the header
+#define LOG_HEADER_SIZE     16
+
+// Number of bytes of a record covered by its CRC
+#define LOG_RECORD_CRC_LEN  (sizeof(mlx90614_log_record_t) - sizeof(uint16_t))
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Initialize empty log file.
+ *
+ * @param p_log Pointer to log descriptor.
+ *
+ * @return True on success, false on failure.
+ */
+static bool
+log_format(mlx90614_log_t *p_log);
+
+/**
+ * @brief Scan log file for last valid record and set log sequence numbers.
+ *
+ * @param p_log Pointer to log descriptor.
+ *
+ * @return True on success, false on failure.
+ */
+static bool
+log_recover(mlx90614_log_t *p_log);
+
+/**
+ * @brief Write RAM batch records to file.
+ *
+ * @param p_log Pointer to log descriptor.
+ *
+ * @return True on success, false on failure.
+ */
+static bool
+log_write_batch(mlx90614_log_t *p_log);
+
+/**
+ * @brief Read consecutive record slots from file.
+ *
+ * @param p_log Pointer to log descriptor.
+ * @param slot Index of first slot.
+ * @param count Number of slots to read, must not cross end of file.
+ * @param p_records Output record buffer.
+ *
+ * @return True on success, false on failure.
+ */
+static bool
+log_read_slots(mlx90614_log_t *p_log, uint32_t slot, uint32_t count,
+    mlx90614_log_record_t *p_records);
+
+/**
+ * @brief Read record with given sequence number from batch or file.
+ *
+ * @param p_log Pointer to log descriptor.
+ * @param seq Record sequence number.
+ * @param p_record Output record.
+ *
+ * @return True if valid record was read, false otherwise.
+ */
+static bool
+log_get_record(mlx90614_log_t *p_log, uint32_t seq,
+    mlx90614_log_record_t *p_record);
+
+/**
+ * @brief Check record CRC and sequence number.
+ *
+ * @param p_record Pointer to record.
+ *
+ * @return True if record is valid, false otherwise.
+ */
+static bool
+is_record_valid(const mlx90614_log_record_t *p_record);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+mlx90614_log_t
+*mlx90614_log_open(int fd, uint32_t capacity, uint32_t sync_interval_ms)
+{
+    mlx90614_log_t *p_log = NULL;
+    bool b_is_init_ok = true;
+    uint8_t header[LOG_HEADER_SIZE];
+
+    if (capacity == 0)
+    {
+        b_is_init_ok = false;
+        MLX_ERROR("Log capacity must not be zero.", __FUNCTION__);
+    }
+    else if ((p_log = malloc(sizeof(mlx90614_log_t))) == NULL)
+    {
+        b_is_init_ok = false;
+        MLX_ERROR("Not enough free memory.", __FUNCTION__);
+    }
+
+    if (b_is_init_ok)
+    {
+        memset(p_log, 0, sizeof(mlx90614_log_t));
+        p_log->fd = fd;
+        p_log->capacity = capacity;
+        p_log->sync_interval_ms = sync_interval_ms;
+        p_log->last_sync_ms = mlx90614_get_time_ms();
+
+        uint32_t magic = 0;
+        uint32_t file_capacity = 0;
+        uint16_t record_size = 0;
+        struct stat file_stat;
+
+        if (pread(fd, header, LOG_HEADER_SIZE, 0) == LOG_HEADER_SIZE)
+        {
+            memcpy(&magic, &header[0], sizeof(magic));
+            memcpy(&record_size, &header[6], sizeof(record_size));
+            memcpy(&file_capacity, &header[8], sizeof(file_capacity));
+        }
+
+        if ((magic == MLX90614_LOG_MAGIC) && (header[4] == MLX90614_LOG_VERSION)
+            && (record_size == sizeof(mlx90614_log_record_t))
+            && (file_capacity == capacity))
+        {
+            // Slots beyond end of truncated file cannot be read or mapped
+            if ((fstat(fd, &file_stat) != 0) || (file_stat.st_size <
+                LOG_HEADER_SIZE + (off_t)capacity *
+                (off_t)sizeof(mlx90614_log_record_t)))
+            {
+                MLX_DEBUG("Log file truncated, formatting new log.",
+                    __FUNCTION__);
+                b_is_init_ok = log_format(p_log);
+            }
+            else
+            {
+                MLX_DEBUG("Recovering existing log.", __FUNCTION__);
+            }
+        }
+        else
+        {
+            MLX_DEBUG("Formatting new log.", __FUNCTION__);
+            b_is_init_ok = log_format(p_log);
+        }
+    }
+
+#   ifdef MLX90614_LOG_MMAP
+    if (b_is_init_ok)
+    {
+        p_log->map_size = LOG_HEADER_SIZE +
+            (size_t)capacity * sizeof(mlx90614_log_record_t);
+        void *p_map = mmap(NULL, p_log->map_size, PROT_READ, MAP_SHARED, fd, 0);
+
+        if (p_map == MAP_FAILED)
+        {
+            MLX_ERROR("Cannot map log file: %s.", __FUNCTION__,
+                strerror(errno));
+            b_is_init_ok = false;
+        }
+        else
+        {
+            p_log->p_map = p_map;
+        }
+    }
+#   endif
+
+    if (b_is_init_ok)
+    {
+        b_is_init_ok = log_recover(p_log);
+    }
+
+    if (!b_is_init_ok)
+    {
+        MLX_ERROR("Sample log initialization failed.", __FUNCTION__);
+        if (p_log)
+        {
+#           ifdef MLX90614_LOG_MMAP
+            if (p_log->p_map)
+            {
+                munmap((void *)p_log->p_map, p_log->map_size);
+            }
+#           endif
+            free(p_log);
+            p_log = NULL;
+        }
+    }
+
+    return p_log;
+}
+
+void
+mlx90614_log_close(mlx90614_log_t *p_log)
+{
+    if (p_log)
+    {
+        mlx90614_log_flush(p_log, true);
+
+#       ifdef MLX90614_LOG_MMAP
+        munmap((void *)p_log->p_map, p_log->map_size);
+#       endif
+
+        free(p_log);
+        p_log = NULL;
+    }
+}
+
+uint32_t
+mlx90614_log_append(mlx90614_log_t *p_log, const mlx90614_sample_t *p_sample)
+{
+    uint32_t result = 0;
+
+    if (p_log->batch_count == MLX90614_LOG_BATCH_SIZE)
+    {
+        // Previous batch write failed, retry before accepting new records
+        mlx90614_log_flush(p_log, false);
+    }
+
+    if (p_log->batch_count < MLX90614_LOG_BATCH_SIZE)
+    {
+        mlx90614_log_record_t *p_rec = &p_log->batch[p_log->batch_count];
+
+        p_rec->sequence = p_log->next_seq;
+        p_rec->timestamp_ms = p_sample->timestamp_ms;
+        p_rec->raw = p_sample->raw;
+        p_rec->i2c_addr = p_sample->i2c_addr;
+        p_rec->channel = p_sample->channel;
+        p_rec->reserved = 0;
+        p_rec->crc = mlx90614_crc16(0xFFFF, (const uint8_t *)p_rec,
+            LOG_RECORD_CRC_LEN);
+
+        result = p_log->next_seq++;
+        p_log->batch_count++;
+
+        if (p_log->next_seq - p_log->first_seq > p_log->capacity)
+        {
+            // Oldest record is going to be overwritten
+            p_log->first_seq++;
+        }
+
+        if (p_log->batch_count == MLX90614_LOG_BATCH_SIZE)
+        {
+            mlx90614_log_flush(p_log, false);
+        }
+    }
+
+    return result;
+}
+
+bool
+mlx90614_log_flush(mlx90614_log_t *p_log, bool b_force)
+{
+    bool b_result = true;
+
+    if (p_log->batch_count > 0)
+    {
+        b_result = log_write_batch(p_log);
+    }
+
+    if (b_result && p_log->b_is_sync_pending)
+    {
+        uint32_t now = mlx90614_get_time_ms();
+
+        if (b_force || (now - p_log->last_sync_ms >= p_log->sync_interval_ms))
+        {
+            if (fdatasync(p_log->fd) == 0)
+            {
+                p_log->b_is_sync_pending = false;
+                p_log->last_sync_ms = now;
+            }
+            else
+            {
+                MLX_ERROR("Log sync failed: %s.", __FUNCTION__,
+                    strerror(errno));
+                b_result = false;
+            }
+        }
+    }
+
+    return b_result;
+}
+
+uint32_t
+mlx90614_log_find(mlx90614_log_t *p_log, uint32_t timestamp_ms)
+{
+    uint32_t low = p_log->first_seq;
+    uint32_t high = p_log->next_seq;
+    mlx90614_log_record_t record;
+
+    // Binary search for first record with timestamp >= timestamp_ms
+    while (low < high)
+    {
+        uint32_t mid = low + (high - low) / 2;
+
+        if (!log_get_record(p_log, mid, &record) ||
+            ((int32_t)(record.timestamp_ms - timestamp_ms) < 0))
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+uint32_t
+mlx90614_log_read(mlx90614_log_t *p_log, uint32_t *p_seq,
+    mlx90614_sample_t *p_samples, uint32_t max_count)
+{
+    uint32_t count = 0;
+    uint32_t seq = *p_seq;
+    uint32_t batch_first_seq = p_log->next_seq - p_log->batch_count;
+    mlx90614_log_record_t records[MLX90614_LOG_BATCH_SIZE];
+
+    if ((int32_t)(seq - p_log->first_seq) < 0)
+    {
+        seq = p_log->first_seq;
+    }
+
+    while ((count < max_count) && ((int32_t)(p_log->next_seq - seq) > 0))
+    {
+        const mlx90614_log_record_t *p_chunk;
+        uint32_t chunk_len;
+
+        if ((int32_t)(seq - batch_first_seq) >= 0)
+        {
+            // Records not written to file yet
+            p_chunk = &p_log->batch[seq - batch_first_seq];
+            chunk_len = p_log->next_seq - seq;
+        }
+        else
+        {
+            uint32_t slot = (seq - 1) % p_log->capacity;
+
+            chunk_len = batch_first_seq - seq;
+            if (chunk_len > MLX90614_LOG_BATCH_SIZE)
+            {
+                chunk_len = MLX90614_LOG_BATCH_SIZE;
+            }
+            if (chunk_len > p_log->capacity - slot)
+            {
+                chunk_len = p_log->capacity - slot;
+            }
+
+            if (!log_read_slots(p_log, slot, chunk_len, records))
+            {
+                break;
+            }
+            p_chunk = records;
+        }
+
+        if (chunk_len > max_count - count)
+        {
+            chunk_len = max_count - count;
+        }
+
+        for (uint32_t idx = 0; idx < chunk_len; idx++)
+        {
+            const mlx90614_log_record_t *p_rec = &p_chunk[idx];
+
+            if ((p_rec->sequence == seq + idx) && is_record_valid(p_rec))
+            {
+                p_samples[count].timestamp_ms = p_rec->timestamp_ms;
+                p_samples[count].raw = p_rec->raw;
+                p_samples[count].i2c_addr = p_rec->i2c_addr;
+                p_samples[count].channel = p_rec->channel;
+                count++;
+            }
+        }
+
+        seq += chunk_len;
+    }
+
+    *p_seq = seq;
+
+    return count;
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static bool
+log_format(mlx90614_log_t *p_log)
+{
+    bool b_result = false;
+    uint8_t header[LOG_HEADER_SIZE];
+    uint32_t magic = MLX90614_LOG_MAGIC;
+    uint16_t record_size = sizeof(mlx90614_log_record_t);
+    off_t file_size = LOG_HEADER_SIZE +
+        (off_t)p_log->capacity * (off_t)sizeof(mlx90614_log_record_t);
+
+    memset(header, 0, LOG_HEADER_SIZE);
+    memcpy(&header[0], &magic, sizeof(magic));
+    header[4] = MLX90614_LOG_VERSION;
+    memcpy(&header[6], &record_size, sizeof(record_size));
+    memcpy(&header[8], &p_log->capacity, sizeof(p_log->capacity));
+
+    // Truncate first to zero all record slots
+    if ((ftruncate(p_log->fd, 0) == 0) &&
+        (ftruncate(p_log->fd, file_size) == 0) &&
+        (pwrite(p_log->fd, header, LOG_HEADER_SIZE, 0) == LOG_HEADER_SIZE) &&
+        (fdatasync(p_log->fd) == 0))
+    {
+        b_result = true;
+    }
+    else
+    {
+        MLX_ERROR("Cannot format log file: %s.", __FUNCTION__,
+            strerror(errno));
+    }
+
+    return b_result;
+}
+
+static bool
+log_recover(mlx90614_log_t *p_log)
+{
+    bool b_result = true;
+    uint32_t last_seq = 0;
+
+    for (uint32_t slot = 0; b_result && (slot < p_log->capacity);
+        slot += MLX90614_LOG_BATCH_SIZE)
+    {
+        uint32_t count = p_log->capacity - slot;
+
+        if (count > MLX90614_LOG_BATCH_SIZE)
+        {
+            count = MLX90614_LOG_BATCH_SIZE;
+        }
+
+        // Batch is empty at this point and serves as scan buffer
+        b_result = log_read_slots(p_log, slot, count, p_log->batch);
+
+        for (uint32_t idx = 0; b_result && (idx < count); idx++)
+        {
+            const mlx90614_log_record_t *p_rec = &p_log->batch[idx];
+
+            if (is_record_valid(p_rec) &&
+                ((p_rec->sequence - 1) % p_log->capacity == slot + idx) &&
+                (p_rec->sequence > last_seq))
+            {
+                last_seq = p_rec->sequence;
+            }
+        }
+    }
+
+    p_log->next_seq = last_seq + 1;
+    p_log->first_seq = (last_seq > p_log->capacity) ?
+        (last_seq - p_log->capacity + 1) : 1;
+    p_log->batch_count = 0;
+
+    MLX_DEBUG("Log recovered, next sequence %u.", __FUNCTION__,
+        p_log->next_seq);
+
+    return b_result;
+}
+
+static bool
+log_write_batch(mlx90614_log_t *p_log)
+{
+    bool b_result = true;
+    uint32_t idx = 0;
+
+    while (b_result && (idx < p_log->batch_count))
+    {
+        // Write consecutive slots up to end of file in one call
+        uint32_t slot = (p_log->batch[idx].sequence - 1) % p_log->capacity;
+        uint32_t count = p_log->batch_count - idx;
+
+        if (count > p_log->capacity - slot)
+        {
+            count = p_log->capacity - slot;
+        }
+
+        size_t len = count * sizeof(mlx90614_log_record_t);
+        off_t offset = LOG_HEADER_SIZE +
+            (off_t)slot * (off_t)sizeof(mlx90614_log_record_t);
+
+        if (pwrite(p_log->fd, &p_log->batch[idx], len, offset) == (ssize_t)len)
+        {
+            idx += count;
+        }
+        else
+        {
+            MLX_ERROR("Log write failed: %s.", __FUNCTION__, strerror(errno));
+            b_result = false;
+        }
+    }
+
+    if (idx > 0)
+    {
+        // Keep records which could not be written
+        memmove(&p_log->batch[0], &p_log->batch[idx],
+            (p_log->batch_count - idx) * sizeof(mlx90614_log_record_t));
+        p_log->batch_count -= idx;
+        p_log->b_is_sync_pending = true;
+    }
+
+    return b_result;
+}
+
+static bool
+log_read_slots(mlx90614_log_t *p_log, uint32_t slot, uint32_t count,
+    mlx90614_log_record_t *p_records)
+{
+    bool b_result = false;
+    size_t len = count * sizeof(mlx90614_log_record_t);
+    off_t offset = LOG_HEADER_SIZE +
+        (off_t)slot * (off_t)sizeof(mlx90614_log_record_t);
+
+#   ifdef MLX90614_LOG_MMAP
+    memcpy(p_records, p_log->p_map + offset, len);
+    b_result = true;
+#   else
+    if (pread(p_log->fd, p_records, len, offset) == (ssize_t)len)
+    {
+        b_result = true;
+    }
+    else
+    {
+        MLX_ERROR("Log read failed: %s.", __FUNCTION__, strerror(errno));
+    }
+#   endif
+
+    return b_result;
+}
+
+static bool
+log_get_record(mlx90614_log_t *p_log, uint32_t seq,
+    mlx90614_log_record_t *p_record)
+{
+    bool b_result = false;
+    uint32_t batch_first_seq = p_log->next_seq - p_log->batch_count;
+
+    if ((int32_t)(seq - batch_first_seq) >= 0)
+    {
+        *p_record = p_log->batch[seq - batch_first_seq];
+        b_result = true;
+    }
+    else
+    {
+        b_result = log_read_slots(p_log, (seq - 1) % p_log->capacity, 1,
+            p_record);
+    }
+
+    return b_result && (p_record->sequence == seq) && is_record_valid(p_record);
+}
+
+static bool
+is_record_valid(const mlx90614_log_record_t *p_record)
+{
+    return (p_record->sequence != 0) &&
+        (p_record->crc == mlx90614_crc16(0xFFFF, (const uint8_t *)p_record,
+            LOG_RECORD_CRC_LEN));
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,200 @@
+/***************************************************************************//**
+* @file    mlx90614_plan.c
+* @version 1.0.0
+*
+* @brief SMBus utilization planner for MLX90614 sensor buses.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_plan.h"
+#include "mlx90614_support.h"
+
+// Response time analysis iteration limit
+#define RTA_MAX_ITERATIONS  1000
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Compute worst-case response time of sensor.
+ *
+ * @param p_results Per-sensor results with periods and durations.
+ * @param p_order Sensor indexes in priority order.
+ * @param count Number of sensors.
+ * @param prio Priority of analysed sensor.
+ *
+ * @return Response time in microseconds, UINT32_MAX if unbounded.
+ */
+static uint32_t
+response_time(const mlx90614_plan_result_t *p_results, const uint8_t *p_order,
+    uint8_t count, uint8_t prio);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+uint32_t
+mlx90614_plan_transaction_us(const mlx90614_plan_bus_t *p_bus)
+{
+    return (uint32_t)(((uint64_t)MLX90614_PLAN_READ_BITS * 1000000 +
+        p_bus->bus_speed_hz - 1) / p_bus->bus_speed_hz) + p_bus->overhead_us;
+}
+
+bool
+mlx90614_plan_compute(const mlx90614_plan_bus_t *p_bus,
+    const mlx90614_plan_sensor_t *p_sensors, uint8_t count,
+    mlx90614_plan_result_t *p_results, mlx90614_plan_summary_t *p_summary)
+{
+    bool b_result = true;
+    uint8_t order[MLX90614_PLAN_MAX_SENSORS];
+    float capacity = 1.0F - (float)p_bus->reserve_permille / 1000.0F;
+    float utilization = 0.0F;
+
+    if ((p_bus->bus_speed_hz == 0) || (count > MLX90614_PLAN_MAX_SENSORS))
+    {
+        MLX_ERROR("Invalid bus speed or sensor count.", __FUNCTION__);
+        b_result = false;
+    }
+
+    for (uint8_t idx = 0; b_result && (idx < count); idx++)
+    {
+        // Period must fit 1 us - UINT32_MAX us, NaN fails all tests
+        float rate_hz = p_sensors[idx].rate_hz;
+
+        if (!((rate_hz > 0.0F) && (rate_hz <= 1e6F) &&
+            (1000000.0F / rate_hz < 4294967296.0F)))
+        {
+            MLX_ERROR("Invalid rate of sensor 0x%02X.", __FUNCTION__,
+                p_sensors[idx].i2c_addr);
+            b_result = false;
+        }
+    }
+
+    if (b_result)
+    {
+        uint32_t transaction_us = mlx90614_plan_transaction_us(p_bus);
+
+        memset(p_results, 0, count * sizeof(mlx90614_plan_result_t));
+        memset(p_summary, 0, sizeof(mlx90614_plan_summary_t));
+
+        // Bus time and utilization per sensor
+        for (uint8_t idx = 0; idx < count; idx++)
+        {
+            mlx90614_plan_result_t *p_res = &p_results[idx];
+            uint8_t channels = p_sensors[idx].channels;
+            uint8_t reads = 0;
+
+            for (uint8_t bit = 0; bit < 3; bit++)
+            {
+                reads = (uint8_t)(reads + ((channels >> bit) & 1));
+            }
+
+            p_res->period_us = (uint32_t)(1000000.0F / p_sensors[idx].rate_hz);
+            p_res->duration_us = (uint32_t)((uint64_t)reads * transaction_us *
+                (1000 + p_bus->retry_permille) / 1000);
+            utilization += (float)p_res->duration_us / (float)p_res->period_us;
+        }
+
+        // Rate monotonic priorities, insertion sort keeps input order on ties
+        for (uint8_t idx = 0; idx < count; idx++)
+        {
+            uint8_t pos = idx;
+
+            while ((pos > 0) && (p_results[order[pos - 1]].period_us >
+                p_results[idx].period_us))
+            {
+                order[pos] = order[pos - 1];
+                pos--;
+            }
+            order[pos] = idx;
+        }
+
+        p_summary->b_is_feasible = (utilization <= capacity);
+
+        uint32_t offset_us = 0;
+
+        for (uint8_t prio = 0; prio < count; prio++)
+        {
+            mlx90614_plan_result_t *p_res = &p_results[order[prio]];
+            float own = (float)p_res->duration_us / (float)p_res->period_us;
+
+            p_res->priority = prio;
+            p_res->offset_us = offset_us % p_res->period_us;
+            offset_us += p_res->duration_us;
+
+            p_res->latency_us = response_time(p_results, order, count, prio);
+            if (p_res->latency_us > p_res->period_us)
+            {
+                p_summary->b_is_feasible = false;
+            }
+
+            p_res->max_rate_hz = (p_res->duration_us > 0) ?
+                (capacity - (utilization - own)) * 1000000.0F /
+                (float)p_res->duration_us : 0.0F;
+            if (p_res->max_rate_hz < 0.0F)
+            {
+                p_res->max_rate_hz = 0.0F;
+            }
+        }
+
+        // Overloaded bus saturates permille value
+        p_summary->utilization_permille = (utilization < 65.535F) ?
+            (uint16_t)(utilization * 1000.0F + 0.5F) : UINT16_MAX;
+        p_summary->rate_scale_max = (utilization > 0.0F) ?
+            capacity / utilization : 0.0F;
+    }
+
+    return b_result;
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static uint32_t
+response_time(const mlx90614_plan_result_t *p_results, const uint8_t *p_order,
+    uint8_t count, uint8_t prio)
+{
+    const mlx90614_plan_result_t *p_res = &p_results[p_order[prio]];
+    uint64_t blocking = 0;
+    uint64_t response;
+    uint64_t previous = 0;
+    uint32_t iterations = 0;
+
+    // Transaction already on the bus cannot be preempted
+    for (uint8_t idx = (uint8_t)(prio + 1); idx < count; idx++)
+    {
+        if (p_results[p_order[idx]].duration_us > blocking)
+        {
+            blocking = p_results[p_order[idx]].duration_us;
+        }
+    }
+
+    response = blocking + p_res->duration_us;
+
+    while ((response != previous) && (response <= p_res->period_us) &&
+        (iterations++ < RTA_MAX_ITERATIONS))
+    {
+        previous = response;
+        response = blocking + p_res->duration_us;
+
+        for (uint8_t idx = 0; idx < prio; idx++)
+        {
+            const mlx90614_plan_result_t *p_hp = &p_results[p_order[idx]];
+
+            response += ((previous + p_hp->period_us - 1) / p_hp->period_us) *
+                p_hp->duration_us;
+        }
+    }
+
+    return (response > UINT32_MAX) ? UINT32_MAX : (uint32_t)response;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,528 @@
+/***************************************************************************//**
+* @file    mlx90614_pool.c
+* @version 1.0.0
+*
+* @brief Work-stealing post-processing pool for MLX90614 sample batches.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_pool.h"
+#include "mlx90614_support.h"
+
+#define POOL_NONE   0xFFFFFFFFUL    // No batch / strand
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Pool worker thread.
+ *
+ * @param p_arg Pointer to worker.
+ *
+ * @return NULL.
+ */
+static void
+*worker(void *p_arg);
+
+/**
+ * @brief Find or assign strand of sensor key, strand lock held.
+ *
+ * @param p_pool Pointer to pool.
+ * @param key Sensor key.
+ *
+ * @return Strand index, POOL_NONE if strand table is full.
+ */
+static uint32_t
+find_strand(mlx90614_pool_t *p_pool, uint32_t key);
+
+/**
+ * @brief Take strand from deque of worker.
+ *
+ * @param p_worker Pointer to worker.
+ * @param b_is_owner Take from owner end, else steal from other end.
+ *
+ * @return Strand index, POOL_NONE if deque is empty.
+ */
+static uint32_t
+take_strand(mlx90614_pool_worker_t *p_worker, bool b_is_owner);
+
+/**
+ * @brief Process queued batches of strand until it is empty.
+ *
+ * @param p_worker Pointer to worker.
+ * @param strand Strand index.
+ */
+static void
+run_strand(mlx90614_pool_worker_t *p_worker, uint32_t strand);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+mlx90614_pool_t
+*mlx90614_pool_open(uint8_t worker_count, uint16_t max_sensors,
+    uint32_t batch_count, mlx_temperature_unit unit)
+{
+    mlx90614_pool_t *p_pool = NULL;
+    uint32_t strand_count = 2;
+    size_t size;
+
+    // Half-full hash table keeps probing short
+    while (strand_count < 2 * (uint32_t)max_sensors)
+    {
+        strand_count *= 2;
+    }
+
+    size = sizeof(mlx90614_pool_t) +
+        worker_count * sizeof(mlx90614_pool_worker_t) +
+        strand_count * sizeof(mlx90614_pool_strand_t) +
+        batch_count * sizeof(mlx90614_pool_batch_t) +
+        (size_t)worker_count * strand_count * sizeof(uint32_t);
+
+    if ((worker_count == 0) || (max_sensors == 0) || (batch_count == 0))
+    {
+        MLX_ERROR("Invalid pool parameters.", __FUNCTION__);
+    }
+    else if ((p_pool = malloc(size)) == NULL)
+    {
+        MLX_ERROR("Not enough free memory.", __FUNCTION__);
+    }
+    else
+    {
+        memset(p_pool, 0, size);
+        p_pool->unit = unit;
+        p_pool->worker_count = worker_count;
+        p_pool->strand_count = strand_count;
+        p_pool->batch_count = batch_count;
+        p_pool->p_workers = (mlx90614_pool_worker_t *)&p_pool[1];
+        p_pool->p_strands =
+            (mlx90614_pool_strand_t *)&p_pool->p_workers[worker_count];
+        p_pool->p_batches =
+            (mlx90614_pool_batch_t *)&p_pool->p_strands[strand_count];
+
+        uint32_t *p_deques = (uint32_t *)&p_pool->p_batches[batch_count];
+
+        for (uint8_t idx = 0; idx < worker_count; idx++)
+        {
+            p_pool->p_workers[idx].p_pool = p_pool;
+            p_pool->p_workers[idx].p_deque = &p_deques[idx * strand_count];
+            pthread_mutex_init(&p_pool->p_workers[idx].lock, NULL);
+        }
+
+        for (uint32_t idx = 0; idx < batch_count; idx++)
+        {
+            p_pool->p_batches[idx].next = (idx + 1 < batch_count) ?
+                idx + 1 : POOL_NONE;
+        }
+
+        pthread_mutex_init(&p_pool->strand_lock, NULL);
+        pthread_mutex_init(&p_pool->idle_lock, NULL);
+        pthread_cond_init(&p_pool->work_cond, NULL);
+        pthread_cond_init(&p_pool->drain_cond, NULL);
+    }
+
+    return p_pool;
+}
+
+void
+mlx90614_pool_close(mlx90614_pool_t *p_pool)
+{
+    if (p_pool)
+    {
+        if (p_pool->b_is_started)
+        {
+            mlx90614_pool_drain(p_pool);
+
+            pthread_mutex_lock(&p_pool->idle_lock);
+            p_pool->b_is_running = false;
+            pthread_cond_broadcast(&p_pool->work_cond);
+            pthread_mutex_unlock(&p_pool->idle_lock);
+
+            for (uint8_t idx = 0; idx < p_pool->worker_count; idx++)
+            {
+                pthread_join(p_pool->p_workers[idx].thread, NULL);
+            }
+        }
+
+        for (uint8_t idx = 0; idx < p_pool->worker_count; idx++)
+        {
+            pthread_mutex_destroy(&p_pool->p_workers[idx].lock);
+        }
+
+        pthread_mutex_destroy(&p_pool->strand_lock);
+        pthread_mutex_destroy(&p_pool->idle_lock);
+        pthread_cond_destroy(&p_pool->work_cond);
+        pthread_cond_destroy(&p_pool->drain_cond);
+
+        free(p_pool);
+        p_pool = NULL;
+    }
+}
+
+bool
+mlx90614_pool_add_stage(mlx90614_pool_t *p_pool, mlx90614_consumer_t stage,
+    void *p_context)
+{
+    bool b_result = false;
+
+    if (p_pool->b_is_started ||
+        (p_pool->stage_count >= MLX90614_POOL_MAX_STAGES))
+    {
+        MLX_ERROR("Cannot add processing stage.", __FUNCTION__);
+    }
+    else
+    {
+        p_pool->stages[p_pool->stage_count] = stage;
+        p_pool->p_contexts[p_pool->stage_count] = p_context;
+        p_pool->stage_count++;
+        b_result = true;
+    }
+
+    return b_result;
+}
+
+bool
+mlx90614_pool_start(mlx90614_pool_t *p_pool)
+{
+    bool b_result = true;
+    uint8_t started = 0;
+
+    p_pool->b_is_running = true;
+
+    while (b_result && (started < p_pool->worker_count))
+    {
+        if (pthread_create(&p_pool->p_workers[started].thread, NULL, worker,
+            &p_pool->p_workers[started]) == 0)
+        {
+            started++;
+        }
+        else
+        {
+            MLX_ERROR("Cannot start pool worker %u.", __FUNCTION__, started);
+            b_result = false;
+        }
+    }
+
+    // Stop workers already started on failure
+    if (!b_result)
+    {
+        pthread_mutex_lock(&p_pool->idle_lock);
+        p_pool->b_is_running = false;
+        pthread_cond_broadcast(&p_pool->work_cond);
+        pthread_mutex_unlock(&p_pool->idle_lock);
+
+        for (uint8_t idx = 0; idx < started; idx++)
+        {
+            pthread_join(p_pool->p_workers[idx].thread, NULL);
+        }
+    }
+
+    p_pool->b_is_started = b_result;
+
+    return b_result;
+}
+
+bool
+mlx90614_pool_submit(mlx90614_pool_t *p_pool, uint32_t key,
+    const mlx90614_sample_t *p_samples, uint32_t count)
+{
+    uint32_t parts = (count + MLX90614_POOL_BATCH_SIZE - 1) /
+        MLX90614_POOL_BATCH_SIZE;
+    uint32_t queued = 0;
+    uint32_t strand;
+    bool b_is_new = false;
+
+    // Count batches in flight before workers can see them
+    pthread_mutex_lock(&p_pool->idle_lock);
+    p_pool->in_flight += parts;
+    pthread_mutex_unlock(&p_pool->idle_lock);
+
+    pthread_mutex_lock(&p_pool->strand_lock);
+
+    strand = find_strand(p_pool, key);
+
+    while ((strand != POOL_NONE) && (queued < parts) &&
+        (p_pool->free_head != POOL_NONE))
+    {
+        mlx90614_pool_strand_t *p_strand = &p_pool->p_strands[strand];
+        uint32_t batch = p_pool->free_head;
+        mlx90614_pool_batch_t *p_batch = &p_pool->p_batches[batch];
+        uint32_t offset = queued * MLX90614_POOL_BATCH_SIZE;
+
+        p_pool->free_head = p_batch->next;
+        p_batch->next = POOL_NONE;
+        p_batch->count = (count - offset < MLX90614_POOL_BATCH_SIZE) ?
+            count - offset : MLX90614_POOL_BATCH_SIZE;
+        memcpy(p_batch->samples, &p_samples[offset],
+            p_batch->count * sizeof(mlx90614_sample_t));
+
+        if (p_strand->head == POOL_NONE)
+        {
+            p_strand->head = batch;
+        }
+        else
+        {
+            p_pool->p_batches[p_strand->tail].next = batch;
+        }
+        p_strand->tail = batch;
+        queued++;
+    }
+
+    if ((strand != POOL_NONE) && (queued > 0) &&
+        !p_pool->p_strands[strand].b_is_scheduled)
+    {
+        p_pool->p_strands[strand].b_is_scheduled = true;
+        b_is_new = true;
+    }
+
+    if (queued < parts)
+    {
+        p_pool->rejected += count - queued * MLX90614_POOL_BATCH_SIZE;
+    }
+
+    pthread_mutex_unlock(&p_pool->strand_lock);
+
+    pthread_mutex_lock(&p_pool->idle_lock);
+    p_pool->in_flight -= parts - queued;
+
+    // Strand starts on worker chosen by key, idle workers steal it. Strand
+    // is counted ready before it is published, so worker taking it cannot
+    // decrement first.
+    if (b_is_new)
+    {
+        mlx90614_pool_worker_t *p_worker =
+            &p_pool->p_workers[key % p_pool->worker_count];
+
+        p_pool->ready++;
+
+        pthread_mutex_lock(&p_worker->lock);
+        p_worker->p_deque[p_worker->bottom % p_pool->strand_count] = strand;
+        p_worker->bottom++;
+        pthread_mutex_unlock(&p_worker->lock);
+
+        pthread_cond_signal(&p_pool->work_cond);
+    }
+    if (p_pool->in_flight == 0)
+    {
+        pthread_cond_broadcast(&p_pool->drain_cond);
+    }
+    pthread_mutex_unlock(&p_pool->idle_lock);
+
+    if (queued < parts)
+    {
+        MLX_DEBUG("Pool full, samples of key 0x%04X rejected", __FUNCTION__,
+            key);
+    }
+
+    return queued == parts;
+}
+
+void
+mlx90614_pool_drain(mlx90614_pool_t *p_pool)
+{
+    pthread_mutex_lock(&p_pool->idle_lock);
+    while (p_pool->b_is_started && (p_pool->in_flight > 0))
+    {
+        pthread_cond_wait(&p_pool->drain_cond, &p_pool->idle_lock);
+    }
+    pthread_mutex_unlock(&p_pool->idle_lock);
+}
+
+void
+mlx90614_pool_get_stats(mlx90614_pool_t *p_pool, uint8_t worker,
+    mlx90614_pool_stats_t *p_stats)
+{
+    mlx90614_pool_worker_t *p_worker = &p_pool->p_workers[worker];
+
+    pthread_mutex_lock(&p_worker->lock);
+    *p_stats = p_worker->stats;
+    pthread_mutex_unlock(&p_worker->lock);
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static void
+*worker(void *p_arg)
+{
+    mlx90614_pool_worker_t *p_worker = (mlx90614_pool_worker_t *)p_arg;
+    mlx90614_pool_t *p_pool = p_worker->p_pool;
+    uint8_t self = (uint8_t)(p_worker - p_pool->p_workers);
+    bool b_is_running = true;
+
+    while (b_is_running)
+    {
+        uint32_t strand = take_strand(p_worker, true);
+        bool b_is_stolen = false;
+
+        // Own deque empty, steal oldest strand of another worker
+        for (uint8_t idx = 1; (strand == POOL_NONE) &&
+            (idx < p_pool->worker_count); idx++)
+        {
+            strand = take_strand(&p_pool->p_workers[(self + idx) %
+                p_pool->worker_count], false);
+            b_is_stolen = (strand != POOL_NONE);
+        }
+
+        pthread_mutex_lock(&p_pool->idle_lock);
+        if (strand != POOL_NONE)
+        {
+            p_pool->ready--;
+        }
+        else
+        {
+            while (p_pool->b_is_running && (p_pool->ready == 0))
+            {
+                pthread_cond_wait(&p_pool->work_cond, &p_pool->idle_lock);
+            }
+            b_is_running = p_pool->b_is_running || (p_pool->ready > 0);
+        }
+        pthread_mutex_unlock(&p_pool->idle_lock);
+
+        if (strand != POOL_NONE)
+        {
+            if (b_is_stolen)
+            {
+                pthread_mutex_lock(&p_worker->lock);
+                p_worker->stats.steals++;
+                pthread_mutex_unlock(&p_worker->lock);
+            }
+
+            run_strand(p_worker, strand);
+        }
+    }
+
+    return NULL;
+}
+
+static uint32_t
+find_strand(mlx90614_pool_t *p_pool, uint32_t key)
+{
+    uint32_t mask = p_pool->strand_count - 1;
+    uint32_t slot = (key ^ (key >> 8)) & mask;
+    uint32_t strand = POOL_NONE;
+
+    for (uint32_t probe = 0; (strand == POOL_NONE) &&
+        (probe < p_pool->strand_count); probe++)
+    {
+        mlx90614_pool_strand_t *p_strand = &p_pool->p_strands[slot];
+
+        if (!p_strand->b_is_used)
+        {
+            p_strand->b_is_used = true;
+            p_strand->key = key;
+            p_strand->head = POOL_NONE;
+            p_strand->tail = POOL_NONE;
+            strand = slot;
+        }
+        else if (p_strand->key == key)
+        {
+            strand = slot;
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    return strand;
+}
+
+static uint32_t
+take_strand(mlx90614_pool_worker_t *p_worker, bool b_is_owner)
+{
+    uint32_t strand = POOL_NONE;
+    uint32_t size = p_worker->p_pool->strand_count;
+
+    pthread_mutex_lock(&p_worker->lock);
+    if (p_worker->bottom != p_worker->top)
+    {
+        if (b_is_owner)
+        {
+            p_worker->bottom--;
+            strand = p_worker->p_deque[p_worker->bottom % size];
+        }
+        else
+        {
+            strand = p_worker->p_deque[p_worker->top % size];
+            p_worker->top++;
+        }
+    }
+    pthread_mutex_unlock(&p_worker->lock);
+
+    return strand;
+}
+
+static void
+run_strand(mlx90614_pool_worker_t *p_worker, uint32_t strand)
+{
+    mlx90614_pool_t *p_pool = p_worker->p_pool;
+    mlx90614_pool_strand_t *p_strand = &p_pool->p_strands[strand];
+    uint32_t batches = 0;
+    uint32_t samples = 0;
+    bool b_has_batch = true;
+
+    while (b_has_batch)
+    {
+        uint32_t batch;
+
+        // Strand is released only when found empty under lock
+        pthread_mutex_lock(&p_pool->strand_lock);
+        batch = p_strand->head;
+        if (batch == POOL_NONE)
+        {
+            p_strand->b_is_scheduled = false;
+            b_has_batch = false;
+        }
+        pthread_mutex_unlock(&p_pool->strand_lock);
+
+        if (b_has_batch)
+        {
+            mlx90614_pool_batch_t *p_batch = &p_pool->p_batches[batch];
+
+            mlx90614_convert_batch(p_batch->samples, p_worker->values,
+                p_batch->count, p_pool->unit);
+
+            for (uint8_t idx = 0; idx < p_pool->stage_count; idx++)
+            {
+                p_pool->stages[idx](p_pool->p_contexts[idx], p_batch->samples,
+                    p_worker->values, p_batch->count);
+            }
+
+            batches++;
+            samples += p_batch->count;
+
+            pthread_mutex_lock(&p_pool->strand_lock);
+            p_strand->head = p_batch->next;
+            if (p_strand->head == POOL_NONE)
+            {
+                p_strand->tail = POOL_NONE;
+            }
+            p_batch->next = p_pool->free_head;
+            p_pool->free_head = batch;
+            pthread_mutex_unlock(&p_pool->strand_lock);
+        }
+    }
+
+    pthread_mutex_lock(&p_worker->lock);
+    p_worker->stats.batches += batches;
+    p_worker->stats.samples += samples;
+    pthread_mutex_unlock(&p_worker->lock);
+
+    pthread_mutex_lock(&p_pool->idle_lock);
+    p_pool->in_flight -= batches;
+    if (p_pool->in_flight == 0)
+    {
+        pthread_cond_broadcast(&p_pool->drain_cond);
+    }
+    pthread_mutex_unlock(&p_pool->idle_lock);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,428 @@
+/***************************************************************************//**
+* @file    mlx90614_prov.c
+* @version 1.0.0
+*
+* @brief Bulk SMBus address provisioning of MLX90614 sensors.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_prov.h"
+#include "mlx90614_support.h"
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Read device ID of sensor at address.
+ *
+ * @param i2c_fd I2C bus file descriptor.
+ * @param address Sensor address.
+ * @param p_probe Probe descriptor output, device ID is filled on success.
+ *
+ * @return True if sensor responded.
+ */
+static bool
+probe(int i2c_fd, uint8_t address, mlx90614_t *p_probe);
+
+/**
+ * @brief Find entry by device ID.
+ *
+ * @param p_prov Pointer to provisioning session.
+ * @param p_id Device ID words.
+ *
+ * @return Pointer to entry, NULL if sensor is not in log.
+ */
+static mlx90614_prov_entry_t
+*find_by_id(mlx90614_prov_t *p_prov, const uint16_t *p_id);
+
+/**
+ * @brief Check replayed log record against plan and earlier records.
+ *
+ * @param p_prov Pointer to provisioning session.
+ * @param p_entry Entry of record address, NULL if address is not in plan.
+ * @param address Record address.
+ * @param p_id Record device ID words.
+ * @param state Record state.
+ *
+ * @return True if record can be adopted.
+ */
+static bool
+is_record_consistent(mlx90614_prov_t *p_prov,
+    const mlx90614_prov_entry_t *p_entry, uint8_t address,
+    const uint16_t *p_id, uint8_t state);
+
+/**
+ * @brief Update entry and append it to log.
+ *
+ * @param p_prov Pointer to provisioning session.
+ * @param p_entry Pointer to entry.
+ * @param p_id Device ID words.
+ * @param state New entry state.
+ *
+ * @return True if record was written and synced.
+ */
+static bool
+log_entry(mlx90614_prov_t *p_prov, mlx90614_prov_entry_t *p_entry,
+    const uint16_t *p_id, mlx_prov_state state);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+mlx90614_prov_t
+*mlx90614_prov_open(int log_fd, int i2c_fd, const uint8_t *p_plan,
+    uint8_t plan_count)
+{
+    mlx90614_prov_t *p_prov = NULL;
+    size_t size = sizeof(mlx90614_prov_t) +
+        plan_count * (sizeof(mlx90614_prov_entry_t) + 1);
+
+    if (plan_count == 0)
+    {
+        MLX_ERROR("Empty address plan.", __FUNCTION__);
+    }
+    else if ((p_prov = malloc(size)) == NULL)
+    {
+        MLX_ERROR("Not enough free memory.", __FUNCTION__);
+    }
+    else
+    {
+        uint8_t record[MLX90614_PROV_RECORD_SIZE];
+        bool b_is_valid = true;
+
+        memset(p_prov, 0, size);
+        p_prov->log_fd = log_fd;
+        p_prov->i2c_fd = i2c_fd;
+        p_prov->plan_count = plan_count;
+        p_prov->p_entries = (mlx90614_prov_entry_t *)&p_prov[1];
+        p_prov->p_plan = (uint8_t *)&p_prov->p_entries[plan_count];
+        memcpy(p_prov->p_plan, p_plan, plan_count);
+
+        for (uint8_t idx = 0; idx < plan_count; idx++)
+        {
+            p_prov->p_entries[idx].address = p_plan[idx];
+        }
+
+        // Replay log up to first invalid record, torn tail is overwritten
+        while (b_is_valid)
+        {
+            b_is_valid = (pread(log_fd, record, MLX90614_PROV_RECORD_SIZE,
+                (off_t)p_prov->log_records * MLX90614_PROV_RECORD_SIZE) ==
+                MLX90614_PROV_RECORD_SIZE) &&
+                (record[0] == MLX90614_PROV_MAGIC) &&
+                (mlx90614_crc16(0xFFFF, record, 12) ==
+                    (uint16_t)(record[12] | (record[13] << 8)));
+
+            if (b_is_valid)
+            {
+                mlx90614_prov_entry_t *p_entry = (mlx90614_prov_entry_t *)
+                    mlx90614_prov_get_entry(p_prov, record[2]);
+                uint16_t id[4];
+
+                for (uint8_t idx = 0; idx < 4; idx++)
+                {
+                    id[idx] = (uint16_t)(record[4 + 2 * idx] |
+                        (record[5 + 2 * idx] << 8));
+                }
+
+                // Inconsistent record is skipped, device state decides
+                if (is_record_consistent(p_prov, p_entry, record[2], id,
+                    record[1]))
+                {
+                    memcpy(p_entry->device_id, id, sizeof(id));
+                    p_entry->state = (mlx_prov_state)record[1];
+                }
+                else
+                {
+                    MLX_ERROR("Log record %u for 0x%02X inconsistent, ignored.",
+                        __FUNCTION__, p_prov->log_records, record[2]);
+                }
+                p_prov->log_records++;
+            }
+        }
+
+        MLX_DEBUG("Replayed %u log records", __FUNCTION__,
+            p_prov->log_records);
+    }
+
+    return p_prov;
+}
+
+void
+mlx90614_prov_close(mlx90614_prov_t *p_prov)
+{
+    if (p_prov)
+    {
+        free(p_prov);
+        p_prov = NULL;
+    }
+}
+
+mlx_prov_result
+mlx90614_prov_assign(mlx90614_prov_t *p_prov, uint8_t *p_address)
+{
+    mlx_prov_result result = MLX_PROV_IDLE;
+    mlx90614_t sensor;
+    mlx90614_t check;
+    mlx90614_prov_entry_t *p_entry = NULL;
+    int16_t addr_cell = 0;
+
+    if (probe(p_prov->i2c_fd, MLX90614_I2C_ADDRESS, &sensor) &&
+        mlx90614_reg_read(&sensor, MLX90614_EREG_SMBUS_ADDR, &addr_cell))
+    {
+        p_entry = find_by_id(p_prov, sensor.device_id);
+
+        if (p_entry && (p_entry->state >= MLX_PROV_STATE_ASSIGNED))
+        {
+            // Provisioned sensor still at default address until power cycle
+            result = MLX_PROV_KNOWN;
+        }
+        else if (p_entry == NULL)
+        {
+            p_entry = (mlx90614_prov_entry_t *)mlx90614_prov_get_entry(
+                p_prov, (uint8_t)addr_cell);
+
+            if (p_entry && (p_entry->state == MLX_PROV_STATE_NONE))
+            {
+                // Address written by interrupted run, adopt it
+                result = log_entry(p_prov, p_entry, sensor.device_id,
+                    MLX_PROV_STATE_ASSIGNED) ? MLX_PROV_ASSIGNED :
+                    MLX_PROV_FAILED;
+            }
+            else
+            {
+                p_entry = NULL;
+                result = MLX_PROV_PLAN_FULL;
+
+                // Next free plan address not occupied by foreign sensor
+                for (uint8_t idx = 0; (p_entry == NULL) &&
+                    (idx < p_prov->plan_count); idx++)
+                {
+                    if ((p_prov->p_entries[idx].state == MLX_PROV_STATE_NONE) &&
+                        !probe(p_prov->i2c_fd, p_prov->p_entries[idx].address,
+                            &check))
+                    {
+                        p_entry = &p_prov->p_entries[idx];
+                    }
+                }
+
+                if (p_entry && !log_entry(p_prov, p_entry, sensor.device_id,
+                    MLX_PROV_STATE_INTENT))
+                {
+                    p_entry = NULL;
+                    result = MLX_PROV_FAILED;
+                }
+            }
+        }
+
+        // Write address of new or interrupted assignment
+        if (p_entry && (p_entry->state == MLX_PROV_STATE_INTENT))
+        {
+            int16_t readback;
+
+            result = MLX_PROV_FAILED;
+
+            // Address 0x00 reaches any sensor, matching ID proves it is alone
+            if (mlx90614_set_address(&sensor, p_entry->address) &&
+                probe(p_prov->i2c_fd, 0x00, &check) &&
+                (memcmp(check.device_id, sensor.device_id,
+                    sizeof(sensor.device_id)) == 0) &&
+                mlx90614_reg_read(&check, MLX90614_EREG_SMBUS_ADDR,
+                    &readback) &&
+                ((uint8_t)readback == p_entry->address) &&
+                log_entry(p_prov, p_entry, sensor.device_id,
+                    MLX_PROV_STATE_ASSIGNED))
+            {
+                result = MLX_PROV_ASSIGNED;
+            }
+            else
+            {
+                MLX_ERROR("Assignment of 0x%02X not verified.", __FUNCTION__,
+                    p_entry->address);
+            }
+        }
+    }
+
+    if (p_address && p_entry)
+    {
+        *p_address = p_entry->address;
+    }
+
+    return result;
+}
+
+uint8_t
+mlx90614_prov_verify(mlx90614_prov_t *p_prov, int i2c_fd)
+{
+    uint8_t pending = 0;
+    mlx90614_t sensor;
+
+    for (uint8_t idx = 0; idx < p_prov->plan_count; idx++)
+    {
+        mlx90614_prov_entry_t *p_entry = &p_prov->p_entries[idx];
+
+        if ((p_entry->state == MLX_PROV_STATE_INTENT) ||
+            (p_entry->state == MLX_PROV_STATE_ASSIGNED))
+        {
+            if ((p_entry->state == MLX_PROV_STATE_ASSIGNED) &&
+                probe(i2c_fd, p_entry->address, &sensor) &&
+                (memcmp(sensor.device_id, p_entry->device_id,
+                    sizeof(sensor.device_id)) == 0) &&
+                log_entry(p_prov, p_entry, p_entry->device_id,
+                    MLX_PROV_STATE_VERIFIED))
+            {
+                MLX_DEBUG("Sensor at 0x%02X verified", __FUNCTION__,
+                    p_entry->address);
+            }
+            else
+            {
+                pending++;
+            }
+        }
+    }
+
+    return pending;
+}
+
+const mlx90614_prov_entry_t
+*mlx90614_prov_get_entry(mlx90614_prov_t *p_prov, uint8_t address)
+{
+    mlx90614_prov_entry_t *p_entry = NULL;
+
+    for (uint8_t idx = 0; (p_entry == NULL) && (idx < p_prov->plan_count);
+        idx++)
+    {
+        if (p_prov->p_entries[idx].address == address)
+        {
+            p_entry = &p_prov->p_entries[idx];
+        }
+    }
+
+    return p_entry;
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static bool
+probe(int i2c_fd, uint8_t address, mlx90614_t *p_probe)
+{
+    memset(p_probe, 0, sizeof(mlx90614_t));
+    p_probe->i2c_fd = i2c_fd;
+    p_probe->i2c_addr = address;
+
+    return mlx90614_get_id(p_probe);
+}
+
+static mlx90614_prov_entry_t
+*find_by_id(mlx90614_prov_t *p_prov, const uint16_t *p_id)
+{
+    mlx90614_prov_entry_t *p_entry = NULL;
+
+    for (uint8_t idx = 0; (p_entry == NULL) && (idx < p_prov->plan_count);
+        idx++)
+    {
+        if ((p_prov->p_entries[idx].state != MLX_PROV_STATE_NONE) &&
+            (memcmp(p_prov->p_entries[idx].device_id, p_id,
+                sizeof(p_prov->p_entries[idx].device_id)) == 0))
+        {
+            p_entry = &p_prov->p_entries[idx];
+        }
+    }
+
+    return p_entry;
+}
+
+static bool
+is_record_consistent(mlx90614_prov_t *p_prov,
+    const mlx90614_prov_entry_t *p_entry, uint8_t address,
+    const uint16_t *p_id, uint8_t state)
+{
+    bool b_result = false;
+    bool b_is_blank_id = true;
+    const mlx90614_prov_entry_t *p_owner = find_by_id(p_prov, p_id);
+
+    for (uint8_t idx = 0; idx < 4; idx++)
+    {
+        if ((p_id[idx] != 0x0000) && (p_id[idx] != 0xFFFF))
+        {
+            b_is_blank_id = false;
+        }
+    }
+
+    if ((p_entry == NULL) || (address < 0x01) || (address > 0x7F))
+    {
+        // Address outside plan or SMBus 7-bit range
+    }
+    else if ((state < MLX_PROV_STATE_INTENT) ||
+        (state > MLX_PROV_STATE_VERIFIED) || b_is_blank_id)
+    {
+        // Records only log reservation and later states of real sensors
+    }
+    else if ((p_owner != NULL) && (p_owner != p_entry))
+    {
+        // Sensor already holds another address
+    }
+    else if ((p_entry->state != MLX_PROV_STATE_NONE) &&
+        ((memcmp(p_entry->device_id, p_id, sizeof(p_entry->device_id)) != 0)
+        || (state < p_entry->state)))
+    {
+        // Address taken by another sensor, or state going back
+    }
+    else
+    {
+        b_result = true;
+    }
+
+    return b_result;
+}
+
+static bool
+log_entry(mlx90614_prov_t *p_prov, mlx90614_prov_entry_t *p_entry,
+    const uint16_t *p_id, mlx_prov_state state)
+{
+    bool b_result = false;
+    uint8_t record[MLX90614_PROV_RECORD_SIZE];
+
+    memset(record, 0, sizeof(record));
+    record[0] = MLX90614_PROV_MAGIC;
+    record[1] = (uint8_t)state;
+    record[2] = p_entry->address;
+    for (uint8_t idx = 0; idx < 4; idx++)
+    {
+        record[4 + 2 * idx] = (uint8_t)p_id[idx];
+        record[5 + 2 * idx] = (uint8_t)(p_id[idx] >> 8);
+    }
+
+    uint16_t crc = mlx90614_crc16(0xFFFF, record, 12);
+    record[12] = (uint8_t)crc;
+    record[13] = (uint8_t)(crc >> 8);
+
+    if ((pwrite(p_prov->log_fd, record, MLX90614_PROV_RECORD_SIZE,
+        (off_t)p_prov->log_records * MLX90614_PROV_RECORD_SIZE) ==
+        MLX90614_PROV_RECORD_SIZE) && (fdatasync(p_prov->log_fd) == 0))
+    {
+        memcpy(p_entry->device_id, p_id, sizeof(p_entry->device_id));
+        p_entry->state = state;
+        p_prov->log_records++;
+        b_result = true;
+    }
+    else
+    {
+        MLX_ERROR("Provisioning log write failed.", __FUNCTION__);
+    }
+
+    return b_result;
+}
+
+/* [] END OF FILE */
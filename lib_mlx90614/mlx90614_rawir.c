@@ -0,0 +1,349 @@
+/***************************************************************************//**
+* @file    mlx90614_rawir.c
+* @version 1.0.0
+*
+* @brief Host-side object temperature computation from MLX90614 raw IR data.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_lock.h"
+#include "lib_mlx90614_rawir.h"
+#include "mlx90614_support.h"
+
+// Smallest ambient temperature span to fit ambient dependence [K]
+#define TA_SPAN_MIN     2.0F
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Compute fourth root of positive value.
+ *
+ * Uses exponent halving initial estimate and fixed number of Newton
+ * iterations, relative error is below float resolution.
+ *
+ * @param value Input value.
+ *
+ * @return Fourth root of value.
+ */
+static inline float
+fourth_root(float value);
+
+/**
+ * @brief Solve linear system by Gaussian elimination with partial pivoting.
+ *
+ * @param a System matrix, destroyed.
+ * @param b Right hand side, replaced by solution.
+ * @param n System size, up to 3.
+ *
+ * @return True on success, false if system is singular.
+ */
+static bool
+solve(double a[3][3], double b[3], uint8_t n);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+int16_t
+mlx90614_rawir_to_signed(uint16_t raw)
+{
+    int16_t magnitude = (int16_t)(raw & 0x7FFF);
+
+    return (int16_t)((raw & 0x8000) ? -magnitude : magnitude);
+}
+
+void
+mlx90614_rawir_fit_init(mlx90614_rawir_fit_t *p_fit)
+{
+    memset(p_fit, 0, sizeof(mlx90614_rawir_fit_t));
+}
+
+bool
+mlx90614_rawir_fit_add(mlx90614_rawir_fit_t *p_fit, int16_t ir, uint16_t ta,
+    uint16_t tobj)
+{
+    bool b_result = false;
+
+    if (((ta & 0x8000) == 0) && ((tobj & 0x8000) == 0))
+    {
+        double ta_k = ta * 0.02;
+        double tobj_k = tobj * 0.02;
+        double f[3];
+        double y;
+
+        f[0] = 1.0;
+        f[1] = ir;
+        f[2] = ir * (ta_k - MLX90614_RAWIR_TA_REF);
+        y = (tobj_k * tobj_k) * (tobj_k * tobj_k) -
+            (ta_k * ta_k) * (ta_k * ta_k);
+
+        for (uint8_t row = 0; row < 3; row++)
+        {
+            for (uint8_t col = 0; col < 3; col++)
+            {
+                p_fit->sum_ff[row][col] += f[row] * f[col];
+            }
+            p_fit->sum_fy[row] += f[row] * y;
+        }
+
+        if ((p_fit->count == 0) || (ta_k < p_fit->ta_min))
+        {
+            p_fit->ta_min = (float)ta_k;
+        }
+        if ((p_fit->count == 0) || (ta_k > p_fit->ta_max))
+        {
+            p_fit->ta_max = (float)ta_k;
+        }
+        p_fit->count++;
+        b_result = true;
+    }
+
+    return b_result;
+}
+
+bool
+mlx90614_rawir_fit_read(mlx90614_t *p_mlx, uint8_t zone,
+    mlx90614_rawir_fit_t *p_fit)
+{
+    bool b_result = false;
+    int16_t ir;
+    int16_t ta;
+    int16_t tobj;
+    uint8_t ch_bit = (zone == 2) ? MLX90614_CH_TOBJ2 : MLX90614_CH_TOBJ1;
+    bool b_is_read;
+
+    // Channels of one fit point are read as one sequence
+    mlx90614_lock_acquire(p_mlx);
+    b_is_read = ((p_mlx->profile.channels & ch_bit) != 0) &&
+        mlx90614_reg_read(p_mlx, (zone == 2) ? MLX90614_RREG_RAWIR2 :
+        MLX90614_RREG_RAWIR1, &ir) &&
+        mlx90614_reg_read(p_mlx, MLX90614_RREG_TA, &ta) &&
+        mlx90614_reg_read(p_mlx, (zone == 2) ? MLX90614_RREG_TOBJ2 :
+        MLX90614_RREG_TOBJ1, &tobj);
+    mlx90614_lock_release(p_mlx);
+
+    if ((p_mlx->profile.channels & ch_bit) == 0)
+    {
+        MLX_ERROR("IR zone not available.", __FUNCTION__);
+    }
+    else if (b_is_read)
+    {
+        b_result = mlx90614_rawir_fit_add(p_fit,
+            mlx90614_rawir_to_signed((uint16_t)ir), (uint16_t)ta,
+            (uint16_t)tobj);
+    }
+
+    return b_result;
+}
+
+bool
+mlx90614_rawir_fit_solve(const mlx90614_rawir_fit_t *p_fit,
+    mlx90614_rawir_coef_t *p_coef)
+{
+    bool b_result = false;
+    double a[3][3];
+    double b[3];
+    uint8_t n = 3;
+
+    // Ambient dependence cannot be separated from gain at constant ambient
+    if (p_fit->ta_max - p_fit->ta_min < TA_SPAN_MIN)
+    {
+        n = 2;
+    }
+
+    if (p_fit->count > n)
+    {
+        memcpy(a, p_fit->sum_ff, sizeof(a));
+        memcpy(b, p_fit->sum_fy, sizeof(b));
+        b_result = solve(a, b, n);
+    }
+
+    if (b_result)
+    {
+        p_coef->c0 = (float)b[0];
+        p_coef->c1 = (float)b[1];
+        p_coef->c2 = (n == 3) ? (float)b[2] : 0.0F;
+    }
+    else
+    {
+        MLX_ERROR("Calibration points do not determine the model.",
+            __FUNCTION__);
+    }
+
+    return b_result;
+}
+
+void
+mlx90614_rawir_eval(const mlx90614_rawir_coef_t *p_coef,
+    const int16_t *p_ir, const uint16_t *p_ta, float *p_tobj, uint32_t count)
+{
+    const float c0 = p_coef->c0;
+    const float c1 = p_coef->c1;
+    const float c2 = p_coef->c2;
+
+    for (uint32_t idx = 0; idx < count; idx++)
+    {
+        float ir = (float)p_ir[idx];
+        float ta = (float)p_ta[idx] * 0.02F;
+        float ta2 = ta * ta;
+        float y = ta2 * ta2 + c0 + ir * (c1 + c2 *
+            (ta - MLX90614_RAWIR_TA_REF));
+
+        // Clamp to 1 K^4, conditional select rather than branch
+        y = (y > 1.0F) ? y : 1.0F;
+        p_tobj[idx] = fourth_root(y);
+    }
+}
+
+float
+mlx90614_rawir_get_temperature(mlx90614_t *p_mlx, uint8_t zone,
+    const mlx90614_rawir_coef_t *p_coef)
+{
+    float result = MLX90614_TEMP_ERROR;
+    int16_t ir;
+    int16_t ta;
+    uint8_t ch_bit = (zone == 2) ? MLX90614_CH_TOBJ2 : MLX90614_CH_TOBJ1;
+    bool b_is_read;
+
+    mlx90614_lock_acquire(p_mlx);
+    b_is_read = ((p_mlx->profile.channels & ch_bit) != 0) &&
+        mlx90614_reg_read(p_mlx, (zone == 2) ? MLX90614_RREG_RAWIR2 :
+        MLX90614_RREG_RAWIR1, &ir) &&
+        mlx90614_reg_read(p_mlx, MLX90614_RREG_TA, &ta);
+    mlx90614_lock_release(p_mlx);
+
+    if ((p_mlx->profile.channels & ch_bit) == 0)
+    {
+        MLX_ERROR("IR zone not available.", __FUNCTION__);
+    }
+    else if (b_is_read)
+    {
+        if (ta & 0x8000)
+        {
+            MLX_ERROR("Error flag set on ambient temperature.", __FUNCTION__);
+        }
+        else
+        {
+            int16_t ir_signed = mlx90614_rawir_to_signed((uint16_t)ir);
+            uint16_t ta_raw = (uint16_t)ta;
+
+            mlx90614_rawir_eval(p_coef, &ir_signed, &ta_raw, &result, 1);
+
+            if (p_mlx->temperature_unit == MLX_TEMP_LINEARIZED)
+            {
+                result /= 0.02F;
+            }
+            else if (p_mlx->temperature_unit != MLX_TEMP_KELVIN)
+            {
+                result -= 273.15F;
+
+                if (p_mlx->temperature_unit == MLX_TEMP_FAHRENHEIT)
+                {
+                    result = result * 9.0F / 5.0F + 32;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static inline float
+fourth_root(float value)
+{
+    uint32_t bits;
+    float root;
+
+    // Quarter of the exponent gives estimate within 20 %
+    memcpy(&bits, &value, sizeof(bits));
+    bits = (bits >> 2) + 0x2FA00000;
+    memcpy(&root, &bits, sizeof(root));
+
+    // Newton iterations, error squares with each step
+    for (uint8_t iter = 0; iter < 4; iter++)
+    {
+        float root3 = root * root * root;
+
+        root = 0.75F * root + 0.25F * value / root3;
+    }
+
+    return root;
+}
+
+static bool
+solve(double a[3][3], double b[3], uint8_t n)
+{
+    bool b_result = true;
+
+    for (uint8_t col = 0; b_result && (col < n); col++)
+    {
+        uint8_t pivot = col;
+
+        for (uint8_t row = (uint8_t)(col + 1); row < n; row++)
+        {
+            if ((a[row][col] < 0 ? -a[row][col] : a[row][col]) >
+                (a[pivot][col] < 0 ? -a[pivot][col] : a[pivot][col]))
+            {
+                pivot = row;
+            }
+        }
+
+        if (a[pivot][col] == 0.0)
+        {
+            b_result = false;
+        }
+        else
+        {
+            if (pivot != col)
+            {
+                for (uint8_t k = 0; k < n; k++)
+                {
+                    double tmp = a[col][k];
+
+                    a[col][k] = a[pivot][k];
+                    a[pivot][k] = tmp;
+                }
+                double tmp = b[col];
+                b[col] = b[pivot];
+                b[pivot] = tmp;
+            }
+
+            for (uint8_t row = (uint8_t)(col + 1); row < n; row++)
+            {
+                double factor = a[row][col] / a[col][col];
+
+                for (uint8_t k = col; k < n; k++)
+                {
+                    a[row][k] -= factor * a[col][k];
+                }
+                b[row] -= factor * b[col];
+            }
+        }
+    }
+
+    // Back substitution
+    for (int8_t row = (int8_t)(n - 1); b_result && (row >= 0); row--)
+    {
+        for (uint8_t k = (uint8_t)(row + 1); k < n; k++)
+        {
+            b[row] -= a[row][k] * b[k];
+        }
+        b[row] /= a[row][row];
+    }
+
+    return b_result;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,227 @@
+/***************************************************************************//**
+* @file    mlx90614_resample.c
+* @version 1.0.0
+*
+* @brief Fixed-rate resampling of jittery MLX90614 sample streams.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_resample.h"
+#include "mlx90614_support.h"
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Emit grid points within history segment.
+ *
+ * @param p_rs Pointer to resampler state.
+ * @param seg Index of segment start sample in history.
+ * @param p_output Output buffer.
+ * @param max_count Output buffer size.
+ *
+ * @return Number of emitted grid points.
+ */
+static uint32_t
+emit_segment(mlx90614_resampler_t *p_rs, uint8_t seg,
+    mlx90614_resampled_t *p_output, uint32_t max_count);
+
+/**
+ * @brief Estimate tangent at history sample using its neighbours.
+ *
+ * Neighbours separated by more than maximum gap are not used.
+ *
+ * @param p_rs Pointer to resampler state.
+ * @param idx Index of sample in history.
+ * @param prev Index of previous sample, or -1 if not available.
+ * @param next Index of next sample, or -1 if not available.
+ *
+ * @return Tangent in value units per millisecond.
+ */
+static float
+tangent(const mlx90614_resampler_t *p_rs, int8_t idx, int8_t prev,
+    int8_t next);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+void
+mlx90614_resampler_init(mlx90614_resampler_t *p_rs, mlx_resample_method method,
+    uint32_t period_ms, uint32_t max_gap_ms)
+{
+    memset(p_rs, 0, sizeof(mlx90614_resampler_t));
+    p_rs->method = method;
+    p_rs->period_ms = (period_ms > 0) ? period_ms : 1;
+    p_rs->max_gap_ms = max_gap_ms;
+}
+
+uint32_t
+mlx90614_resampler_push(mlx90614_resampler_t *p_rs,
+    const mlx90614_sample_t *p_sample, mlx90614_resampled_t *p_output,
+    uint32_t max_count)
+{
+    uint32_t count = 0;
+
+    // Skip invalid and out of order samples
+    if (((p_sample->raw & 0x8000) == 0) && ((p_rs->count == 0) ||
+        ((int32_t)(p_sample->timestamp_ms - p_rs->time[p_rs->count - 1]) > 0)))
+    {
+        if (p_rs->count == 0)
+        {
+            // Align grid to multiples of output period
+            uint32_t rem = p_sample->timestamp_ms % p_rs->period_ms;
+
+            p_rs->next_ms = p_sample->timestamp_ms +
+                ((rem > 0) ? (p_rs->period_ms - rem) : 0);
+        }
+
+        if (p_rs->count == 4)
+        {
+            memmove(&p_rs->time[0], &p_rs->time[1], 3 * sizeof(uint32_t));
+            memmove(&p_rs->value[0], &p_rs->value[1], 3 * sizeof(float));
+            p_rs->count--;
+        }
+
+        p_rs->time[p_rs->count] = p_sample->timestamp_ms;
+        p_rs->value[p_rs->count] = (float)p_sample->raw;
+        p_rs->count++;
+
+        if (p_rs->method == MLX_RESAMPLE_LINEAR)
+        {
+            if (p_rs->count >= 2)
+            {
+                count = emit_segment(p_rs, (uint8_t)(p_rs->count - 2),
+                    p_output, max_count);
+            }
+        }
+        else if (p_rs->count >= 3)
+        {
+            // Cubic: segment before the newest one now has both neighbours
+            count = emit_segment(p_rs, (uint8_t)(p_rs->count - 3), p_output,
+                max_count);
+        }
+    }
+
+    return count;
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static uint32_t
+emit_segment(mlx90614_resampler_t *p_rs, uint8_t seg,
+    mlx90614_resampled_t *p_output, uint32_t max_count)
+{
+    uint32_t count = 0;
+    uint32_t t1 = p_rs->time[seg];
+    uint32_t t2 = p_rs->time[seg + 1];
+    uint32_t span = t2 - t1;
+
+    if ((int32_t)(p_rs->next_ms - t1) < 0)
+    {
+        p_rs->next_ms = t1 + (p_rs->period_ms - t1 % p_rs->period_ms) %
+            p_rs->period_ms;
+    }
+
+    if (span > p_rs->max_gap_ms)
+    {
+        if ((int32_t)(p_rs->next_ms - t2) < 0)
+        {
+            if (max_count > 0)
+            {
+                p_output[0].timestamp_ms = p_rs->next_ms;
+                p_output[0].value = 0.0F;
+                p_output[0].b_is_gap = true;
+                count = 1;
+            }
+
+            // Skip remaining grid points inside the gap
+            p_rs->next_ms += ((t2 - p_rs->next_ms + p_rs->period_ms - 1) /
+                p_rs->period_ms) * p_rs->period_ms;
+        }
+    }
+    else
+    {
+        float p1 = p_rs->value[seg];
+        float p2 = p_rs->value[seg + 1];
+        float h = (float)span;
+        float m1 = 0.0F;
+        float m2 = 0.0F;
+
+        if (p_rs->method == MLX_RESAMPLE_CUBIC)
+        {
+            m1 = tangent(p_rs, (int8_t)seg, (int8_t)(seg - 1),
+                (int8_t)(seg + 1));
+            m2 = tangent(p_rs, (int8_t)(seg + 1), (int8_t)seg,
+                (int8_t)((seg + 2 < p_rs->count) ? seg + 2 : -1));
+        }
+
+        while ((int32_t)(p_rs->next_ms - t2) < 0)
+        {
+            float u = (float)(p_rs->next_ms - t1) / h;
+            float value;
+
+            if (p_rs->method == MLX_RESAMPLE_LINEAR)
+            {
+                value = p1 + (p2 - p1) * u;
+            }
+            else
+            {
+                // Cubic Hermite basis
+                float u2 = u * u;
+                float u3 = u2 * u;
+
+                value = (2 * u3 - 3 * u2 + 1) * p1 +
+                    (u3 - 2 * u2 + u) * h * m1 +
+                    (-2 * u3 + 3 * u2) * p2 + (u3 - u2) * h * m2;
+            }
+
+            if (count < max_count)
+            {
+                p_output[count].timestamp_ms = p_rs->next_ms;
+                p_output[count].value = value;
+                p_output[count].b_is_gap = false;
+                count++;
+            }
+            p_rs->next_ms += p_rs->period_ms;
+        }
+    }
+
+    return count;
+}
+
+static float
+tangent(const mlx90614_resampler_t *p_rs, int8_t idx, int8_t prev,
+    int8_t next)
+{
+    float result = 0.0F;
+
+    // Neighbours missing or across a gap are replaced by the sample itself
+    if ((prev < 0) || (p_rs->time[idx] - p_rs->time[prev] > p_rs->max_gap_ms))
+    {
+        prev = idx;
+    }
+    if ((next < 0) || (p_rs->time[next] - p_rs->time[idx] > p_rs->max_gap_ms))
+    {
+        next = idx;
+    }
+
+    if (next != prev)
+    {
+        result = (p_rs->value[next] - p_rs->value[prev]) /
+            (float)(p_rs->time[next] - p_rs->time[prev]);
+    }
+
+    return result;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,321 @@
+/***************************************************************************//**
+* @file    mlx90614_rollup.c
+* @version 1.0.0
+*
+* @brief Multi-resolution history store for MLX90614 sample streams.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_rollup.h"
+#include "mlx90614_support.h"
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Merge bucket into given level, closing its open bucket if needed.
+ *
+ * @param p_rollup Pointer to rollup store descriptor.
+ * @param level Level index.
+ * @param p_bucket Bucket to be merged.
+ */
+static void
+level_merge(mlx90614_rollup_t *p_rollup, uint32_t level,
+    const mlx90614_rollup_bucket_t *p_bucket);
+
+/**
+ * @brief Check if time falls into range.
+ *
+ * @param time_ms Time to check.
+ * @param from_ms Range start time.
+ * @param to_ms Range end time (exclusive).
+ *
+ * @return True if time is within range.
+ */
+static bool
+is_in_range(uint64_t time_ms, uint64_t from_ms, uint64_t to_ms);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+mlx90614_rollup_t
+*mlx90614_rollup_open(uint32_t raw_capacity,
+    const uint32_t p_level_capacity[MLX90614_ROLLUP_LEVELS])
+{
+    static const uint32_t resolutions[MLX90614_ROLLUP_LEVELS] = {
+        MLX90614_ROLLUP_RES_SECOND,
+        MLX90614_ROLLUP_RES_MINUTE,
+        MLX90614_ROLLUP_RES_HOUR
+    };
+
+    mlx90614_rollup_t *p_rollup = NULL;
+    size_t size = sizeof(mlx90614_rollup_t) +
+        raw_capacity * sizeof(mlx90614_sample_t);
+
+    for (uint32_t level = 0; level < MLX90614_ROLLUP_LEVELS; level++)
+    {
+        size += p_level_capacity[level] * sizeof(mlx90614_rollup_bucket_t);
+    }
+
+    // Descriptor and all rings are allocated as a single block
+    if ((p_rollup = malloc(size)) == NULL)
+    {
+        MLX_ERROR("Not enough free memory.", __FUNCTION__);
+    }
+    else
+    {
+        memset(p_rollup, 0, sizeof(mlx90614_rollup_t));
+
+        mlx90614_rollup_bucket_t *p_buckets =
+            (mlx90614_rollup_bucket_t *)(p_rollup + 1);
+
+        for (uint32_t level = 0; level < MLX90614_ROLLUP_LEVELS; level++)
+        {
+            p_rollup->levels[level].resolution_ms = resolutions[level];
+            p_rollup->levels[level].capacity = p_level_capacity[level];
+            p_rollup->levels[level].p_buckets = p_buckets;
+            p_buckets += p_level_capacity[level];
+        }
+
+        p_rollup->raw_capacity = raw_capacity;
+        p_rollup->p_raw = (mlx90614_sample_t *)p_buckets;
+    }
+
+    return p_rollup;
+}
+
+void
+mlx90614_rollup_close(mlx90614_rollup_t *p_rollup)
+{
+    if (p_rollup)
+    {
+        free(p_rollup);
+        p_rollup = NULL;
+    }
+}
+
+void
+mlx90614_rollup_add(mlx90614_rollup_t *p_rollup,
+    const mlx90614_sample_t *p_sample)
+{
+    if (p_rollup->raw_capacity > 0)
+    {
+        p_rollup->p_raw[p_rollup->raw_head] = *p_sample;
+        p_rollup->raw_head = (p_rollup->raw_head + 1) % p_rollup->raw_capacity;
+        if (p_rollup->raw_count < p_rollup->raw_capacity)
+        {
+            p_rollup->raw_count++;
+        }
+    }
+
+    p_rollup->last_ms = mlx90614_rollup_extend(p_rollup,
+        p_sample->timestamp_ms);
+    p_rollup->b_is_started = true;
+
+    if ((p_sample->raw & 0x8000) == 0)
+    {
+        mlx90614_rollup_bucket_t bucket = {
+            .start_ms = p_rollup->last_ms,
+            .count = 1,
+            .sum = p_sample->raw,
+            .min = p_sample->raw,
+            .max = p_sample->raw
+        };
+
+        level_merge(p_rollup, 0, &bucket);
+    }
+}
+
+uint64_t
+mlx90614_rollup_extend(const mlx90614_rollup_t *p_rollup,
+    uint32_t timestamp_ms)
+{
+    uint64_t time_ms = timestamp_ms;
+
+    if (p_rollup->b_is_started)
+    {
+        // Signed distance to last sample covers 32-bit timestamp wrap
+        time_ms = p_rollup->last_ms + (int64_t)(int32_t)(timestamp_ms -
+            (uint32_t)p_rollup->last_ms);
+    }
+
+    return time_ms;
+}
+
+uint32_t
+mlx90614_rollup_query(mlx90614_rollup_t *p_rollup, uint64_t from_ms,
+    uint64_t to_ms, uint32_t resolution_ms, mlx90614_rollup_bucket_t *p_buckets,
+    uint32_t max_count, uint32_t *p_used_resolution_ms)
+{
+    uint32_t count = 0;
+    int32_t level = MLX90614_ROLLUP_LEVELS - 1;
+
+    // Find coarsest level satisfying requested resolution
+    while ((level >= 0) &&
+        (p_rollup->levels[level].resolution_ms > resolution_ms))
+    {
+        level--;
+    }
+
+    if (level < 0)
+    {
+        uint32_t first = p_rollup->raw_head + p_rollup->raw_capacity -
+            p_rollup->raw_count;
+
+        for (uint32_t idx = 0; (idx < p_rollup->raw_count) &&
+            (count < max_count); idx++)
+        {
+            const mlx90614_sample_t *p_sample =
+                &p_rollup->p_raw[(first + idx) % p_rollup->raw_capacity];
+            uint64_t time_ms = mlx90614_rollup_extend(p_rollup,
+                p_sample->timestamp_ms);
+
+            if (is_in_range(time_ms, from_ms, to_ms))
+            {
+                p_buckets[count].start_ms = time_ms;
+                p_buckets[count].count = 1;
+                p_buckets[count].sum = p_sample->raw;
+                p_buckets[count].min = p_sample->raw;
+                p_buckets[count].max = p_sample->raw;
+                count++;
+            }
+        }
+    }
+    else
+    {
+        const mlx90614_rollup_level_t *p_level = &p_rollup->levels[level];
+        uint32_t first = p_level->head + p_level->capacity - p_level->count;
+        uint32_t low = 0;
+        uint32_t high = p_level->count;
+
+        // Binary search for first bucket ending after range start
+        while (low < high)
+        {
+            uint32_t mid = low + (high - low) / 2;
+            const mlx90614_rollup_bucket_t *p_bucket =
+                &p_level->p_buckets[(first + mid) % p_level->capacity];
+
+            if (p_bucket->start_ms + p_level->resolution_ms <= from_ms)
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+
+        for (uint32_t idx = low; (idx < p_level->count) &&
+            (count < max_count); idx++)
+        {
+            const mlx90614_rollup_bucket_t *p_bucket =
+                &p_level->p_buckets[(first + idx) % p_level->capacity];
+
+            if (p_bucket->start_ms >= to_ms)
+            {
+                break;
+            }
+            p_buckets[count++] = *p_bucket;
+        }
+
+        if ((count < max_count) && (p_level->current.count > 0) &&
+            (p_level->current.start_ms + p_level->resolution_ms > from_ms) &&
+            (p_level->current.start_ms < to_ms))
+        {
+            p_buckets[count++] = p_level->current;
+        }
+    }
+
+    if (p_used_resolution_ms)
+    {
+        *p_used_resolution_ms = (level < 0) ? 0 :
+            p_rollup->levels[level].resolution_ms;
+    }
+
+    return count;
+}
+
+uint16_t
+mlx90614_rollup_mean(const mlx90614_rollup_bucket_t *p_bucket)
+{
+    uint16_t result = 0;
+
+    if (p_bucket->count > 0)
+    {
+        result = (uint16_t)((p_bucket->sum + p_bucket->count / 2) /
+            p_bucket->count);
+    }
+
+    return result;
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static void
+level_merge(mlx90614_rollup_t *p_rollup, uint32_t level,
+    const mlx90614_rollup_bucket_t *p_bucket)
+{
+    mlx90614_rollup_level_t *p_level = &p_rollup->levels[level];
+    mlx90614_rollup_bucket_t *p_current = &p_level->current;
+    uint64_t start_ms = p_bucket->start_ms -
+        (p_bucket->start_ms % p_level->resolution_ms);
+
+    if ((p_current->count > 0) && (p_current->start_ms != start_ms))
+    {
+        // Close open bucket and propagate it to coarser level
+        if (p_level->capacity > 0)
+        {
+            p_level->p_buckets[p_level->head] = *p_current;
+            p_level->head = (p_level->head + 1) % p_level->capacity;
+            if (p_level->count < p_level->capacity)
+            {
+                p_level->count++;
+            }
+        }
+
+        if (level + 1 < MLX90614_ROLLUP_LEVELS)
+        {
+            level_merge(p_rollup, level + 1, p_current);
+        }
+
+        p_current->count = 0;
+    }
+
+    if (p_current->count == 0)
+    {
+        *p_current = *p_bucket;
+        p_current->start_ms = start_ms;
+    }
+    else
+    {
+        p_current->count += p_bucket->count;
+        p_current->sum += p_bucket->sum;
+        if (p_bucket->min < p_current->min)
+        {
+            p_current->min = p_bucket->min;
+        }
+        if (p_bucket->max > p_current->max)
+        {
+            p_current->max = p_bucket->max;
+        }
+    }
+}
+
+static bool
+is_in_range(uint64_t time_ms, uint64_t from_ms, uint64_t to_ms)
+{
+    return (time_ms >= from_ms) && (time_ms < to_ms);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,386 @@
+/***************************************************************************//**
+* @file    mlx90614_serialize.c
+* @version 1.0.0
+*
+* @brief CBOR and JSON serialization of MLX90614 snapshots.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_serialize.h"
+#include "mlx90614_support.h"
+
+// CBOR major types
+#define CBOR_UINT       0x00
+#define CBOR_NEGINT     0x20
+#define CBOR_TEXT       0x60
+#define CBOR_ARRAY      0x80
+#define CBOR_MAP        0xA0
+#define CBOR_TAG        0xC0
+
+// CBOR decimal fraction tag
+#define CBOR_TAG_DECIMAL    4
+
+// Output buffer writer
+typedef struct writer_struct
+{
+    uint8_t *p_buffer;
+    uint32_t size;
+    uint32_t length;
+    bool b_is_overflow;
+} writer_t;
+
+// Two-digit lookup table for integer formatting
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Snapshot channel keys, in MLX90614_CH_* bit order
+static const char *channel_keys[3] = { "ta", "to1", "to2" };
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Append bytes to output.
+ *
+ * @param p_writer Pointer to writer.
+ * @param p_data Data to be appended.
+ * @param length Data length.
+ */
+static void
+write_bytes(writer_t *p_writer, const void *p_data, uint32_t length);
+
+/**
+ * @brief Append unsigned integer in decimal notation.
+ *
+ * @param p_writer Pointer to writer.
+ * @param value Value to be appended.
+ */
+static void
+write_decimal(writer_t *p_writer, uint32_t value);
+
+/**
+ * @brief Append fixed point value with two decimal places.
+ *
+ * @param p_writer Pointer to writer.
+ * @param centi Value in hundredths.
+ */
+static void
+write_centi(writer_t *p_writer, int32_t centi);
+
+/**
+ * @brief Append CBOR data item head.
+ *
+ * @param p_writer Pointer to writer.
+ * @param major CBOR major type.
+ * @param value Head argument.
+ */
+static void
+cbor_head(writer_t *p_writer, uint8_t major, uint32_t value);
+
+/**
+ * @brief Append CBOR signed integer.
+ *
+ * @param p_writer Pointer to writer.
+ * @param value Value to be appended.
+ */
+static void
+cbor_int(writer_t *p_writer, int32_t value);
+
+/**
+ * @brief Append CBOR text string.
+ *
+ * @param p_writer Pointer to writer.
+ * @param p_text Null terminated string.
+ */
+static void
+cbor_text(writer_t *p_writer, const char *p_text);
+
+/**
+ * @brief Count set bits of snapshot valid flags.
+ *
+ * @param valid Snapshot valid flags.
+ *
+ * @return Number of valid channels.
+ */
+static uint32_t
+count_channels(uint8_t valid);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+int32_t
+mlx90614_raw_to_centi(uint16_t raw, mlx_temperature_unit unit)
+{
+    int32_t result = (int32_t)(raw & 0x7FFF);
+
+    if (unit != MLX_TEMP_LINEARIZED)
+    {
+        result *= 2;                // 0.02 degK per bit
+
+        if (unit != MLX_TEMP_KELVIN)
+        {
+            result -= 27315;
+
+            if (unit == MLX_TEMP_FAHRENHEIT)
+            {
+                int32_t scaled = result * 9;
+
+                // Round half away from zero
+                result = (scaled + ((scaled < 0) ? -2 : 2)) / 5 + 3200;
+            }
+        }
+    }
+
+    return result;
+}
+
+uint32_t
+mlx90614_json_write(const mlx90614_snapshot_t *p_snapshots, uint32_t count,
+    mlx_temperature_unit unit, uint8_t *p_buffer, uint32_t buffer_size)
+{
+    writer_t writer = { p_buffer, buffer_size, 0, false };
+
+    write_bytes(&writer, "[", 1);
+
+    for (uint32_t idx = 0; idx < count; idx++)
+    {
+        const mlx90614_snapshot_t *p_snap = &p_snapshots[idx];
+        const uint16_t words[3] = { p_snap->ta, p_snap->tobj1, p_snap->tobj2 };
+
+        if (idx > 0)
+        {
+            write_bytes(&writer, ",", 1);
+        }
+
+        write_bytes(&writer, "{\"addr\":", 8);
+        write_decimal(&writer, p_snap->i2c_addr);
+        write_bytes(&writer, ",\"ts\":", 6);
+        write_decimal(&writer, p_snap->timestamp_ms);
+
+        for (uint8_t ch = 0; ch < 3; ch++)
+        {
+            if (p_snap->valid & (1 << ch))
+            {
+                write_bytes(&writer, ",\"", 2);
+                write_bytes(&writer, channel_keys[ch],
+                    (uint32_t)strlen(channel_keys[ch]));
+                write_bytes(&writer, "\":", 2);
+
+                if (unit == MLX_TEMP_LINEARIZED)
+                {
+                    write_decimal(&writer, words[ch] & 0x7FFF);
+                }
+                else
+                {
+                    write_centi(&writer, mlx90614_raw_to_centi(words[ch], unit));
+                }
+            }
+        }
+
+        write_bytes(&writer, "}", 1);
+    }
+
+    write_bytes(&writer, "]", 1);
+
+    return writer.b_is_overflow ? 0 : writer.length;
+}
+
+uint32_t
+mlx90614_cbor_write(const mlx90614_snapshot_t *p_snapshots, uint32_t count,
+    mlx_temperature_unit unit, uint8_t *p_buffer, uint32_t buffer_size)
+{
+    writer_t writer = { p_buffer, buffer_size, 0, false };
+
+    cbor_head(&writer, CBOR_ARRAY, count);
+
+    for (uint32_t idx = 0; idx < count; idx++)
+    {
+        const mlx90614_snapshot_t *p_snap = &p_snapshots[idx];
+        const uint16_t words[3] = { p_snap->ta, p_snap->tobj1, p_snap->tobj2 };
+
+        cbor_head(&writer, CBOR_MAP, 2 + count_channels(p_snap->valid));
+        cbor_text(&writer, "addr");
+        cbor_head(&writer, CBOR_UINT, p_snap->i2c_addr);
+        cbor_text(&writer, "ts");
+        cbor_head(&writer, CBOR_UINT, p_snap->timestamp_ms);
+
+        for (uint8_t ch = 0; ch < 3; ch++)
+        {
+            if (p_snap->valid & (1 << ch))
+            {
+                cbor_text(&writer, channel_keys[ch]);
+
+                if (unit == MLX_TEMP_LINEARIZED)
+                {
+                    cbor_head(&writer, CBOR_UINT, words[ch] & 0x7FFF);
+                }
+                else
+                {
+                    cbor_head(&writer, CBOR_TAG, CBOR_TAG_DECIMAL);
+                    cbor_head(&writer, CBOR_ARRAY, 2);
+                    cbor_int(&writer, -2);
+                    cbor_int(&writer, mlx90614_raw_to_centi(words[ch], unit));
+                }
+            }
+        }
+    }
+
+    return writer.b_is_overflow ? 0 : writer.length;
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static void
+write_bytes(writer_t *p_writer, const void *p_data, uint32_t length)
+{
+    if (p_writer->length + length <= p_writer->size)
+    {
+        memcpy(&p_writer->p_buffer[p_writer->length], p_data, length);
+        p_writer->length += length;
+    }
+    else
+    {
+        p_writer->b_is_overflow = true;
+    }
+}
+
+static void
+write_decimal(writer_t *p_writer, uint32_t value)
+{
+    char digits[10];
+    uint32_t pos = sizeof(digits);
+
+    // Emit two digits per division
+    while (value >= 100)
+    {
+        uint32_t pair = (value % 100) * 2;
+
+        value /= 100;
+        digits[--pos] = digit_pairs[pair + 1];
+        digits[--pos] = digit_pairs[pair];
+    }
+
+    if (value >= 10)
+    {
+        digits[--pos] = digit_pairs[value * 2 + 1];
+        digits[--pos] = digit_pairs[value * 2];
+    }
+    else
+    {
+        digits[--pos] = (char)('0' + value);
+    }
+
+    write_bytes(p_writer, &digits[pos], (uint32_t)sizeof(digits) - pos);
+}
+
+static void
+write_centi(writer_t *p_writer, int32_t centi)
+{
+    uint32_t magnitude;
+    char fraction[3];
+
+    if (centi < 0)
+    {
+        write_bytes(p_writer, "-", 1);
+        magnitude = (uint32_t)(-centi);
+    }
+    else
+    {
+        magnitude = (uint32_t)centi;
+    }
+
+    write_decimal(p_writer, magnitude / 100);
+
+    fraction[0] = '.';
+    fraction[1] = digit_pairs[(magnitude % 100) * 2];
+    fraction[2] = digit_pairs[(magnitude % 100) * 2 + 1];
+    write_bytes(p_writer, fraction, 3);
+}
+
+static void
+cbor_head(writer_t *p_writer, uint8_t major, uint32_t value)
+{
+    uint8_t head[5];
+    uint32_t length;
+
+    if (value < 24)
+    {
+        head[0] = (uint8_t)(major | value);
+        length = 1;
+    }
+    else if (value <= 0xFF)
+    {
+        head[0] = (uint8_t)(major | 24);
+        head[1] = (uint8_t)value;
+        length = 2;
+    }
+    else if (value <= 0xFFFF)
+    {
+        head[0] = (uint8_t)(major | 25);
+        head[1] = (uint8_t)(value >> 8);
+        head[2] = (uint8_t)value;
+        length = 3;
+    }
+    else
+    {
+        head[0] = (uint8_t)(major | 26);
+        head[1] = (uint8_t)(value >> 24);
+        head[2] = (uint8_t)(value >> 16);
+        head[3] = (uint8_t)(value >> 8);
+        head[4] = (uint8_t)value;
+        length = 5;
+    }
+
+    write_bytes(p_writer, head, length);
+}
+
+static void
+cbor_int(writer_t *p_writer, int32_t value)
+{
+    if (value < 0)
+    {
+        cbor_head(p_writer, CBOR_NEGINT, (uint32_t)(-(value + 1)));
+    }
+    else
+    {
+        cbor_head(p_writer, CBOR_UINT, (uint32_t)value);
+    }
+}
+
+static void
+cbor_text(writer_t *p_writer, const char *p_text)
+{
+    uint32_t length = (uint32_t)strlen(p_text);
+
+    cbor_head(p_writer, CBOR_TEXT, length);
+    write_bytes(p_writer, p_text, length);
+}
+
+static uint32_t
+count_channels(uint8_t valid)
+{
+    return (uint32_t)(((valid & MLX90614_CH_TA) ? 1 : 0) +
+        ((valid & MLX90614_CH_TOBJ1) ? 1 : 0) +
+        ((valid & MLX90614_CH_TOBJ2) ? 1 : 0));
+}
+
+/* [] END OF FILE */
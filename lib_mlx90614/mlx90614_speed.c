@@ -0,0 +1,281 @@
+/***************************************************************************//**
+* @file    mlx90614_speed.c
+* @version 1.0.0
+*
+* @brief Bus speed probing with PEC-verified fallback for MLX90614 sensors.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include <applibs/i2c.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_busstat.h"
+#include "lib_mlx90614_speed.h"
+#include "mlx90614_support.h"
+
+// Supported bus speeds, slowest first
+static const I2C_BusSpeed speed_hz[MLX90614_SPEED_LEVELS] = {
+    I2C_BUS_SPEED_STANDARD,
+    I2C_BUS_SPEED_FAST,
+    I2C_BUS_SPEED_FAST_PLUS
+};
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Set bus speed level.
+ *
+ * @param p_speed Pointer to bus speed state.
+ * @param level Speed level.
+ *
+ * @return True on success.
+ */
+static bool
+set_level(mlx90614_speed_t *p_speed, uint8_t level);
+
+/**
+ * @brief Read all attached sensors at current speed, count errors and
+ * measure throughput.
+ *
+ * @param p_speed Pointer to bus speed state.
+ */
+static void
+probe_level(mlx90614_speed_t *p_speed);
+
+/**
+ * @brief Get monotonic time in microseconds.
+ *
+ * @return Time in microseconds.
+ */
+static uint64_t
+time_us(void);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+bool
+mlx90614_speed_init(mlx90614_speed_t *p_speed, int i2c_fd,
+    uint8_t margin_steps)
+{
+    memset(p_speed, 0, sizeof(mlx90614_speed_t));
+    p_speed->i2c_fd = i2c_fd;
+    p_speed->margin_steps = margin_steps;
+
+    return set_level(p_speed, 0);
+}
+
+bool
+mlx90614_speed_attach(mlx90614_speed_t *p_speed, mlx90614_t *p_mlx)
+{
+    bool b_result = false;
+
+    if (p_speed->sensor_count >= MLX90614_SPEED_MAX_SENSORS)
+    {
+        MLX_ERROR("Too many sensors on bus.", __FUNCTION__);
+    }
+    else
+    {
+        p_speed->p_sensors[p_speed->sensor_count] = p_mlx;
+        p_speed->sensor_count++;
+        p_mlx->p_speed = p_speed;
+        b_result = true;
+    }
+
+    return b_result;
+}
+
+void
+mlx90614_speed_detach(mlx90614_t *p_mlx)
+{
+    mlx90614_speed_t *p_speed = p_mlx->p_speed;
+
+    if (p_speed)
+    {
+        uint8_t kept = 0;
+
+        for (uint8_t idx = 0; idx < p_speed->sensor_count; idx++)
+        {
+            if (p_speed->p_sensors[idx] != p_mlx)
+            {
+                p_speed->p_sensors[kept++] = p_speed->p_sensors[idx];
+            }
+        }
+        p_speed->sensor_count = kept;
+        p_mlx->p_speed = NULL;
+    }
+}
+
+bool
+mlx90614_speed_probe(mlx90614_speed_t *p_speed)
+{
+    bool b_result;
+    uint8_t clean_levels = 0;
+    uint8_t level = 0;
+
+    memset(p_speed->probe_errors, 0, sizeof(p_speed->probe_errors));
+    memset(p_speed->reads_per_s, 0, sizeof(p_speed->reads_per_s));
+    p_speed->b_is_probing = true;
+
+    // Faster speeds are tried only while slower ones are error-free
+    while ((clean_levels == level) && (level < MLX90614_SPEED_LEVELS))
+    {
+        if (set_level(p_speed, level))
+        {
+            probe_level(p_speed);
+            if (p_speed->probe_errors[level] == 0)
+            {
+                clean_levels++;
+            }
+            MLX_DEBUG("Probe at %u Hz: %u errors, %u reads/s", __FUNCTION__,
+                speed_hz[level], p_speed->probe_errors[level],
+                p_speed->reads_per_s[level]);
+        }
+        level++;
+    }
+
+    b_result = (clean_levels > 0);
+    if (!b_result)
+    {
+        MLX_ERROR("Sensors fail at standard bus speed.", __FUNCTION__);
+    }
+
+    level = (clean_levels > p_speed->margin_steps + 1) ?
+        (uint8_t)(clean_levels - 1 - p_speed->margin_steps) : 0;
+
+    if (!set_level(p_speed, level))
+    {
+        b_result = false;
+    }
+
+    p_speed->window_count = 0;
+    p_speed->window_errors = 0;
+    p_speed->fallbacks = 0;
+    p_speed->b_is_probing = false;
+
+    return b_result;
+}
+
+void
+mlx90614_speed_record(mlx90614_t *p_mlx, bool b_is_ok)
+{
+    mlx90614_speed_t *p_speed = p_mlx->p_speed;
+
+    if (!p_speed->b_is_probing)
+    {
+        p_speed->window_count++;
+        if (!b_is_ok)
+        {
+            p_speed->window_errors++;
+        }
+
+        if (p_speed->window_errors > MLX90614_SPEED_WINDOW *
+            MLX90614_SPEED_FALLBACK_PERMILLE / 1000)
+        {
+            if ((p_speed->level > 0) &&
+                set_level(p_speed, (uint8_t)(p_speed->level - 1)))
+            {
+                p_speed->fallbacks++;
+                MLX_ERROR("Bus errors, speed lowered to %u Hz.", __FUNCTION__,
+                    speed_hz[p_speed->level]);
+            }
+            p_speed->window_count = 0;
+            p_speed->window_errors = 0;
+        }
+        else if (p_speed->window_count >= MLX90614_SPEED_WINDOW)
+        {
+            p_speed->window_count = 0;
+            p_speed->window_errors = 0;
+        }
+    }
+}
+
+void
+mlx90614_speed_get_report(const mlx90614_speed_t *p_speed,
+    mlx90614_speed_report_t *p_report)
+{
+    p_report->speed_hz = speed_hz[p_speed->level];
+    p_report->reads_per_s = p_speed->reads_per_s[p_speed->level];
+    p_report->base_reads_per_s = p_speed->reads_per_s[0];
+    p_report->gain_permille = 0;
+    p_report->fallbacks = p_speed->fallbacks;
+
+    if (p_report->base_reads_per_s > 0)
+    {
+        p_report->gain_permille = (int32_t)(((int64_t)p_report->reads_per_s -
+            p_report->base_reads_per_s) * 1000 / p_report->base_reads_per_s);
+    }
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static bool
+set_level(mlx90614_speed_t *p_speed, uint8_t level)
+{
+    bool b_result = false;
+
+    if (I2CMaster_SetBusSpeed(p_speed->i2c_fd, speed_hz[level]) != 0)
+    {
+        MLX_ERROR("Cannot set bus speed %u Hz.", __FUNCTION__,
+            speed_hz[level]);
+    }
+    else
+    {
+        p_speed->level = level;
+        b_result = true;
+    }
+
+    return b_result;
+}
+
+static void
+probe_level(mlx90614_speed_t *p_speed)
+{
+    uint32_t reads = 0;
+    uint32_t errors = 0;
+    uint64_t start_us = time_us();
+    uint64_t elapsed_us;
+    int16_t value;
+
+    for (uint8_t idx = 0; idx < p_speed->sensor_count; idx++)
+    {
+        for (uint16_t read = 0; read < MLX90614_SPEED_PROBE_READS; read++)
+        {
+            // PEC is verified by register read
+            if (!mlx90614_reg_read_op(p_speed->p_sensors[idx],
+                MLX90614_RREG_TA, &value, MLX_BUSOP_SAMPLE))
+            {
+                errors++;
+            }
+            reads++;
+        }
+    }
+
+    elapsed_us = time_us() - start_us;
+
+    p_speed->probe_errors[p_speed->level] = errors;
+    p_speed->reads_per_s[p_speed->level] = (elapsed_us > 0) ?
+        (uint32_t)((uint64_t)reads * 1000000 / elapsed_us) : 0;
+}
+
+static uint64_t
+time_us(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+/* [] END OF FILE */
@@ -17,6 +17,9 @@
 #include <applibs/i2c.h>
 
 #include "lib_mlx90614.h"
+#include "lib_mlx90614_lock.h"
+#include "lib_mlx90614_speed.h"
+#include "lib_mlx90614_timeout.h"
 #include "mlx90614_support.h"
 
 /*******************************************************************************
@@ -30,12 +33,13 @@
  * @param reg_addr Register address to be read from.
  * @param p_data Pointer to buffer for read data.
  * @param data_len Number of bytes to be read.
+ * @param op Operation type for bus accounting.
  *
  * @result The number of bytes successfully read, or -1 for failure.
  */
 static ssize_t
 i2c_read(mlx90614_t *p_mlx, uint8_t reg_addr, uint8_t *p_data,
-    uint32_t data_len);
+    uint32_t data_len, mlx_bus_op op);
 
 /**
  * @brief Platform dependent I2C Write function.
@@ -44,12 +48,45 @@ i2c_read(mlx90614_t *p_mlx, uint8_t reg_addr, uint8_t *p_data,
  * @param reg_addr Register address to be written to.
  * @param p_data Pointer to data to be transmitted.
  * @param data_len Number of bytes to be transmitted.
+ * @param op Operation type for bus accounting.
  *
  * @result The number of bytes successfully written, or -1 for failure.
  */
 static ssize_t
 i2c_write(mlx90614_t *p_mlx, uint8_t reg_addr, const uint8_t *p_data,
-    uint32_t data_len);
+    uint32_t data_len, mlx_bus_op op);
+
+/**
+ * @brief Prepare transaction, set timeout and start time measurement.
+ *
+ * @param p_mlx Pointer to sensor device descriptor structure.
+ * @param op Operation type.
+ *
+ * @result Start time in microseconds, 0 if transaction is not measured.
+ */
+static uint64_t
+begin_transaction(mlx90614_t *p_mlx, mlx_bus_op op);
+
+/**
+ * @brief Record measured transaction to accounting and timeout statistics.
+ *
+ * @param p_mlx Pointer to sensor device descriptor structure.
+ * @param op Operation type.
+ * @param bytes Wire bytes of transaction.
+ * @param start_us Start time from begin_transaction().
+ * @param b_is_ok Transaction succeeded.
+ */
+static void
+end_transaction(mlx90614_t *p_mlx, mlx_bus_op op, uint32_t bytes,
+    uint64_t start_us, bool b_is_ok);
+
+/**
+ * @brief Get monotonic time for transaction duration measurement.
+ *
+ * @result Time in microseconds.
+ */
+static uint64_t
+time_us(void);
 
 /**
  * @brief Calculate CRC-8 using X8 + X2 + X1 + 1 polynomial.
@@ -80,6 +117,25 @@ mlx90614_log_printf(const char *p_format, ...)
 
 bool
 mlx90614_reg_read(mlx90614_t *p_mlx, uint8_t reg_addr, int16_t *p_reg_value)
+{
+    mlx_bus_op op = MLX_BUSOP_SAMPLE;
+
+    if (reg_addr == MLX90614_CMD_READ_FLAGS)
+    {
+        op = MLX_BUSOP_FLAGS;
+    }
+    else if ((reg_addr >= MLX90614_EREG_TOMAX) &&
+        (reg_addr <= MLX90614_EREG_ID4))
+    {
+        op = MLX_BUSOP_CONFIG;
+    }
+
+    return mlx90614_reg_read_op(p_mlx, reg_addr, p_reg_value, op);
+}
+
+bool
+mlx90614_reg_read_op(mlx90614_t *p_mlx, uint8_t reg_addr,
+    int16_t *p_reg_value, mlx_bus_op op)
 {
     // 2 byte register data is followed by 1 byte PEC - Packet Error Code
     // The PEC calculation includes all bits except the START, REPEATED START, 
@@ -89,8 +145,12 @@ mlx90614_reg_read(mlx90614_t *p_mlx, uint8_t reg_addr, int16_t *p_reg_value)
 
     bool b_result = false;
     uint8_t buffer[3];  // LSB, MSB, PEC
+    ssize_t result;
+
+    mlx90614_lock_acquire(p_mlx);
+    result = i2c_read(p_mlx, reg_addr, buffer, 3, op);
 
-    if (i2c_read(p_mlx, reg_addr, buffer, 3) != -1)
+    if (result != -1)
     {
         uint8_t crc = crc8(0, (uint8_t)(p_mlx->i2c_addr << 1));
         crc = crc8(crc, reg_addr);
@@ -105,11 +165,25 @@ mlx90614_reg_read(mlx90614_t *p_mlx, uint8_t reg_addr, int16_t *p_reg_value)
         }
     }
 
+    // Error rate of bus speed includes PEC errors
+    if (p_mlx->p_speed)
+    {
+        mlx90614_speed_record(p_mlx, b_result);
+    }
+    mlx90614_lock_release(p_mlx);
+
     return b_result;
 }
 
 bool
 mlx90614_reg_write(mlx90614_t *p_mlx, uint8_t reg_addr, int16_t reg_value)
+{
+    return mlx90614_reg_write_op(p_mlx, reg_addr, reg_value, MLX_BUSOP_WRITE);
+}
+
+bool
+mlx90614_reg_write_op(mlx90614_t *p_mlx, uint8_t reg_addr, int16_t reg_value,
+    mlx_bus_op op)
 {
     bool b_result = false;
     uint8_t buffer[3];  // LSB, MSB, CRC
@@ -122,10 +196,16 @@ mlx90614_reg_write(mlx90614_t *p_mlx, uint8_t reg_addr, int16_t reg_value)
     buffer[2] = crc8(buffer[2], buffer[0]);
     buffer[2] = crc8(buffer[2], buffer[1]);
 
-    if (i2c_write(p_mlx, reg_addr, buffer, 3) != -1)
+    mlx90614_lock_acquire(p_mlx);
+    if (i2c_write(p_mlx, reg_addr, buffer, 3, op) != -1)
     {
         b_result = true;
     }
+    if (p_mlx->p_speed)
+    {
+        mlx90614_speed_record(p_mlx, b_result);
+    }
+    mlx90614_lock_release(p_mlx);
 
     return b_result;
 }
@@ -136,32 +216,69 @@ mlx90614_eeprom_write(mlx90614_t *p_mlx, uint8_t reg_addr, int16_t reg_value)
     // Note: A write of 0x0000 must be done prior to writing in EEPROM in order 
     // to erase the EEPROM cell content
 
+    // Bus is released for other sensors during EEPROM waits, sensor stays
+    // reserved for the sequence
+
     struct timespec delay_time;
+    mlx90614_lock_state_t lock_state;
     delay_time.tv_sec = 0;
 
-    bool b_result = mlx90614_reg_write(p_mlx, reg_addr, 0);
+    mlx90614_lock_acquire(p_mlx);
+
+    bool b_result = mlx90614_reg_write_op(p_mlx, reg_addr, 0, MLX_BUSOP_ERASE);
     delay_time.tv_nsec = MLX90614_T_ERASE_MS * 1000000;
+    mlx90614_lock_suspend(p_mlx, &lock_state);
     nanosleep(&delay_time, NULL);   // Wait for EEPROM to erase
+    mlx90614_lock_resume(p_mlx, &lock_state);
 
     if (b_result)
     {
         b_result = mlx90614_reg_write(p_mlx, reg_addr, reg_value);
         delay_time.tv_nsec = MLX90614_T_WRITE_MS * 1000000;
+        mlx90614_lock_suspend(p_mlx, &lock_state);
         nanosleep(&delay_time, NULL);   // Wait for EEPROM to write new value
+        mlx90614_lock_resume(p_mlx, &lock_state);
     }
 
+    mlx90614_lock_release(p_mlx);
+
     return b_result;
 }
 
+uint16_t
+mlx90614_crc16(uint16_t prev_crc, const uint8_t *p_data, uint32_t data_len)
+{
+    uint16_t result = prev_crc;
+
+    for (uint32_t idx = 0; idx < data_len; idx++)
+    {
+        result = result ^ (uint16_t)(p_data[idx] << 8);
+        for (uint8_t bit_idx = 0; bit_idx < 8; bit_idx++)
+        {
+            if ((result & 0x8000) != 0)
+            {
+                result = (uint16_t)(result << 1);
+                result = result ^ 0x1021;
+            }
+            else
+            {
+                result = (uint16_t)(result << 1);
+            }
+        }
+    }
+    return result;
+}
+
 /*******************************************************************************
 * Private function definitions
 *******************************************************************************/
 
 static ssize_t
 i2c_read(mlx90614_t *p_mlx, uint8_t reg_addr, uint8_t *p_data, 
-    uint32_t data_len)
+    uint32_t data_len, mlx_bus_op op)
 {
     ssize_t result = -1;
+    uint64_t start_us = 0;
 
     if (p_mlx && p_data)
     {
@@ -170,10 +287,15 @@ i2c_read(mlx90614_t *p_mlx, uint8_t reg_addr, uint8_t *p_data,
             reg_addr, data_len);
 #       endif
 
+        start_us = begin_transaction(p_mlx, op);
+
         // Select register and read its data
         result = I2CMaster_WriteThenRead(p_mlx->i2c_fd, p_mlx->i2c_addr,
             &reg_addr, 1, p_data, data_len);
 
+        // Address, command, repeated start address and data bytes
+        end_transaction(p_mlx, op, data_len + 3, start_us, result != -1);
+
         if (result == -1)
         {
 #   	    ifdef MLX90614_I2C_DEBUG
@@ -200,9 +322,10 @@ i2c_read(mlx90614_t *p_mlx, uint8_t reg_addr, uint8_t *p_data,
 
 static ssize_t
 i2c_write(mlx90614_t *p_mlx, uint8_t reg_addr, const uint8_t *p_data,
-    uint32_t data_len)
+    uint32_t data_len, mlx_bus_op op)
 {
     ssize_t result = -1;
+    uint64_t start_us = 0;
 
     if (p_mlx && p_data)
     {
@@ -228,10 +351,15 @@ i2c_write(mlx90614_t *p_mlx, uint8_t reg_addr, const uint8_t *p_data,
         log_printf("\n");
 #		endif
 
+        start_us = begin_transaction(p_mlx, op);
+
         // Select register and write data
         result = I2CMaster_Write(p_mlx->i2c_fd, p_mlx->i2c_addr, buffer,
             data_len + 1);
 
+        // Address, command and data bytes
+        end_transaction(p_mlx, op, data_len + 2, start_us, result != -1);
+
         if (result == -1)
         {
 #		    ifdef MLX90614_I2C_DEBUG
@@ -245,6 +373,58 @@ i2c_write(mlx90614_t *p_mlx, uint8_t reg_addr, const uint8_t *p_data,
     return result;
 }
 
+static uint64_t
+begin_transaction(mlx90614_t *p_mlx, mlx_bus_op op)
+{
+    uint64_t start_us = 0;
+
+    if (p_mlx->p_timeout)
+    {
+        mlx90614_timeout_apply(p_mlx, op);
+    }
+
+    if (p_mlx->p_busstat || p_mlx->p_timeout)
+    {
+        start_us = time_us();
+    }
+
+    return start_us;
+}
+
+static void
+end_transaction(mlx90614_t *p_mlx, mlx_bus_op op, uint32_t bytes,
+    uint64_t start_us, bool b_is_ok)
+{
+    bool b_is_expired = !b_is_ok && (errno == ETIMEDOUT);
+    uint32_t elapsed_us = 0;
+
+    if (p_mlx->p_busstat || p_mlx->p_timeout)
+    {
+        elapsed_us = (uint32_t)(time_us() - start_us);
+    }
+
+    if (p_mlx->p_busstat)
+    {
+        mlx90614_busstat_record(p_mlx->p_busstat, (uint8_t)p_mlx->i2c_addr,
+            op, bytes, elapsed_us, b_is_ok);
+    }
+
+    if (p_mlx->p_timeout)
+    {
+        mlx90614_timeout_record(p_mlx, elapsed_us, b_is_ok, b_is_expired);
+    }
+}
+
+static uint64_t
+time_us(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
 static uint8_t
 crc8(uint8_t prev_crc, uint8_t data)
 {
@@ -16,6 +16,7 @@ extern "C" {
 #endif
 
 #include "lib_mlx90614.h"
+#include "lib_mlx90614_busstat.h"
 
 #ifdef MLX90614_DEBUG
 #define MLX_DEBUG(s, f, ...) mlx90614_log_printf("%s %s: " s "\n", "MLX", f, \
@@ -60,6 +61,20 @@ mlx90614_log_printf(const char *p_format, ...);
 bool
 mlx90614_reg_read(mlx90614_t *p_mlx, uint8_t reg_addr, int16_t *p_reg_value);
 
+/**
+ * @brief Read MLX90614 register contents, account as given operation.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param reg_addr Reagister address.
+ * @param p_reg_value Pointer to variable to store register contents.
+ * @param op Operation type for bus accounting.
+ *
+ * @result True for success, or false for failure.
+ */
+bool
+mlx90614_reg_read_op(mlx90614_t *p_mlx, uint8_t reg_addr,
+    int16_t *p_reg_value, mlx_bus_op op);
+
 /**
  * @brief Write value to MLX90614 RAM register.
  *
@@ -72,6 +87,20 @@ mlx90614_reg_read(mlx90614_t *p_mlx, uint8_t reg_addr, int16_t *p_reg_value);
 bool
 mlx90614_reg_write(mlx90614_t *p_mlx, uint8_t reg_addr, int16_t reg_value);
 
+/**
+ * @brief Write value to MLX90614 register, account as given operation.
+ *
+ * @param p_mlx Pointer to MLX90614 device descriptor.
+ * @param reg_addr Reagister address.
+ * @param reg_value Value to write.
+ * @param op Operation type for bus accounting.
+ *
+ * @result True for success, or false for failure.
+ */
+bool
+mlx90614_reg_write_op(mlx90614_t *p_mlx, uint8_t reg_addr, int16_t reg_value,
+    mlx_bus_op op);
+
 /**
  * @brief Write value to MLX90614 EEPROM register.
  *
@@ -84,6 +113,18 @@ mlx90614_reg_write(mlx90614_t *p_mlx, uint8_t reg_addr, int16_t reg_value);
 bool
 mlx90614_eeprom_write(mlx90614_t *p_mlx, uint8_t reg_addr, int16_t reg_value);
 
+/**
+ * @brief Calculate CRC-16 using X16 + X12 + X5 + 1 (CCITT) polynomial.
+ *
+ * @param prev_crc Result from previous CRC calculation, 0xFFFF to start.
+ * @param p_data Pointer to data to be included to CRC calculation.
+ * @param data_len Number of bytes to be included.
+ *
+ * @result CRC-16 calculation result.
+ */
+uint16_t
+mlx90614_crc16(uint16_t prev_crc, const uint8_t *p_data, uint32_t data_len);
+
 #ifdef __cplusplus
 }
 #endif
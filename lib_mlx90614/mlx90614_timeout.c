@@ -0,0 +1,230 @@
+/***************************************************************************//**
+* @file    mlx90614_timeout.c
+* @version 1.0.0
+*
+* @brief Adaptive I2C timeouts from observed MLX90614 transaction latency.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <applibs/i2c.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_timeout.h"
+#include "mlx90614_support.h"
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Add latency to histogram, halve histogram when full.
+ *
+ * @param p_hist Pointer to histogram.
+ * @param latency_us Transaction latency.
+ */
+static void
+hist_add(mlx90614_timeout_hist_t *p_hist, uint32_t latency_us);
+
+/**
+ * @brief Compute register transaction timeout from histogram.
+ *
+ * @param p_bus Pointer to bus timeout state with limits.
+ * @param p_hist Pointer to histogram.
+ *
+ * @return Timeout in milliseconds.
+ */
+static uint32_t
+hist_timeout(const mlx90614_timeout_bus_t *p_bus,
+    const mlx90614_timeout_hist_t *p_hist);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+void
+mlx90614_timeout_bus_init(mlx90614_timeout_bus_t *p_bus, int i2c_fd,
+    uint32_t min_ms, uint32_t max_ms, uint32_t eeprom_ms)
+{
+    memset(p_bus, 0, sizeof(mlx90614_timeout_bus_t));
+    p_bus->i2c_fd = i2c_fd;
+    p_bus->min_ms = min_ms;
+    p_bus->max_ms = (max_ms < min_ms) ? min_ms : max_ms;
+    p_bus->eeprom_ms = eeprom_ms;
+}
+
+bool
+mlx90614_timeout_enable(mlx90614_t *p_mlx, mlx90614_timeout_bus_t *p_bus)
+{
+    bool b_result = true;
+
+    if (p_mlx->p_timeout == NULL)
+    {
+        if ((p_mlx->p_timeout = malloc(sizeof(mlx90614_timeout_t))) == NULL)
+        {
+            MLX_ERROR("Not enough free memory.", __FUNCTION__);
+            b_result = false;
+        }
+        else
+        {
+            memset(p_mlx->p_timeout, 0, sizeof(mlx90614_timeout_t));
+        }
+    }
+
+    if (b_result)
+    {
+        p_mlx->p_timeout->p_bus = p_bus;
+        p_mlx->p_timeout->timeout_ms = hist_timeout(p_bus, &p_bus->hist);
+    }
+
+    return b_result;
+}
+
+void
+mlx90614_timeout_disable(mlx90614_t *p_mlx)
+{
+    if (p_mlx->p_timeout)
+    {
+        free(p_mlx->p_timeout);
+        p_mlx->p_timeout = NULL;
+    }
+}
+
+void
+mlx90614_timeout_apply(mlx90614_t *p_mlx, mlx_bus_op op)
+{
+    mlx90614_timeout_t *p_to = p_mlx->p_timeout;
+    mlx90614_timeout_bus_t *p_bus = p_to->p_bus;
+    uint32_t timeout_ms;
+
+    // Own latency once known, healthy neighbours until then
+    p_to->timeout_ms = hist_timeout(p_bus,
+        (p_to->hist.count >= MLX90614_TIMEOUT_MIN_SAMPLES) ?
+        &p_to->hist : &p_bus->hist);
+
+    // Bus timeout covers latency of all sensors, slower sensor raises it
+    if ((op == MLX_BUSOP_ERASE) || (op == MLX_BUSOP_WRITE))
+    {
+        timeout_ms = p_bus->eeprom_ms;
+    }
+    else
+    {
+        timeout_ms = hist_timeout(p_bus, &p_bus->hist);
+        if (p_to->timeout_ms > timeout_ms)
+        {
+            timeout_ms = p_to->timeout_ms;
+        }
+    }
+
+    if (timeout_ms != p_bus->current_ms)
+    {
+        if (I2CMaster_SetTimeout(p_bus->i2c_fd, timeout_ms) == 0)
+        {
+            p_bus->current_ms = timeout_ms;
+            p_bus->set_count++;
+        }
+        else
+        {
+            MLX_ERROR("Cannot set I2C timeout %u ms.", __FUNCTION__,
+                timeout_ms);
+        }
+    }
+}
+
+void
+mlx90614_timeout_record(mlx90614_t *p_mlx, uint32_t latency_us,
+    bool b_is_ok, bool b_is_expired)
+{
+    mlx90614_timeout_t *p_to = p_mlx->p_timeout;
+
+    // Failed transactions would only pull timeout towards its own value
+    if (b_is_ok)
+    {
+        hist_add(&p_to->hist, latency_us);
+        hist_add(&p_to->p_bus->hist, latency_us);
+    }
+    else if (b_is_expired)
+    {
+        p_to->expired++;
+        MLX_DEBUG_DEV("Timeout after %u us", __FUNCTION__, p_mlx, latency_us);
+    }
+}
+
+uint32_t
+mlx90614_timeout_get_ms(mlx90614_t *p_mlx)
+{
+    return p_mlx->p_timeout ? p_mlx->p_timeout->timeout_ms : 0;
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static void
+hist_add(mlx90614_timeout_hist_t *p_hist, uint32_t latency_us)
+{
+    uint32_t bin = latency_us / MLX90614_TIMEOUT_BIN_US;
+
+    if (bin >= MLX90614_TIMEOUT_BINS)
+    {
+        bin = MLX90614_TIMEOUT_BINS - 1;
+    }
+
+    p_hist->bins[bin]++;
+    p_hist->count++;
+
+    if (p_hist->count >= MLX90614_TIMEOUT_DECAY)
+    {
+        p_hist->count = 0;
+        for (uint8_t idx = 0; idx < MLX90614_TIMEOUT_BINS; idx++)
+        {
+            p_hist->bins[idx] = (uint16_t)(p_hist->bins[idx] / 2);
+            p_hist->count = (uint16_t)(p_hist->count + p_hist->bins[idx]);
+        }
+    }
+}
+
+static uint32_t
+hist_timeout(const mlx90614_timeout_bus_t *p_bus,
+    const mlx90614_timeout_hist_t *p_hist)
+{
+    uint32_t timeout_ms = p_bus->max_ms;
+
+    if (p_hist->count >= MLX90614_TIMEOUT_MIN_SAMPLES)
+    {
+        uint32_t target = (uint32_t)p_hist->count *
+            MLX90614_TIMEOUT_PERCENTILE / 1000;
+        uint32_t sum = 0;
+        uint8_t bin = 0;
+
+        while ((sum += p_hist->bins[bin]) < target)
+        {
+            bin++;
+        }
+
+        // Upper bin edge, overflow bin keeps maximum
+        if (bin < MLX90614_TIMEOUT_BINS - 1)
+        {
+            timeout_ms = ((bin + 1) * MLX90614_TIMEOUT_BIN_US *
+                MLX90614_TIMEOUT_FACTOR + 999) / 1000;
+        }
+
+        if (timeout_ms < p_bus->min_ms)
+        {
+            timeout_ms = p_bus->min_ms;
+        }
+        else if (timeout_ms > p_bus->max_ms)
+        {
+            timeout_ms = p_bus->max_ms;
+        }
+    }
+
+    return timeout_ms;
+}
+
+/* [] END OF FILE */
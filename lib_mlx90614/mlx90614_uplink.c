@@ -0,0 +1,391 @@
+/***************************************************************************//**
+* @file    mlx90614_uplink.c
+* @version 1.0.0
+*
+* @brief Telemetry batching and upload pipeline for MLX90614 samples.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_codec.h"
+#include "lib_mlx90614_log.h"
+#include "lib_mlx90614_uplink.h"
+#include "mlx90614_support.h"
+
+// Block length prefix size
+#define BLOCK_LEN_SIZE  2
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Serialize staged samples into batch buffer.
+ *
+ * Samples which do not fit into buffer stay staged for next batch.
+ *
+ * @param p_uplink Pointer to uplink descriptor.
+ */
+static void
+batch_serialize(mlx90614_uplink_t *p_uplink);
+
+/**
+ * @brief Hand pending batch to sink and update statistics.
+ *
+ * @param p_uplink Pointer to uplink descriptor.
+ */
+static void
+batch_send(mlx90614_uplink_t *p_uplink);
+
+/**
+ * @brief Move spilled samples back to staging.
+ *
+ * @param p_uplink Pointer to uplink descriptor.
+ */
+static void
+spill_replay(mlx90614_uplink_t *p_uplink);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+mlx90614_uplink_t
+*mlx90614_uplink_open(uint32_t max_samples, uint32_t max_age_ms,
+    uint32_t buffer_size, mlx90614_sink_t sink, void *p_sink_context,
+    mlx90614_log_t *p_spill)
+{
+    mlx90614_uplink_t *p_uplink = NULL;
+    size_t size = sizeof(mlx90614_uplink_t) +
+        max_samples * (sizeof(mlx90614_sample_t) + 1) + buffer_size;
+
+    if ((max_samples == 0) || (buffer_size < MLX90614_UPLINK_HEADER_SIZE +
+        BLOCK_LEN_SIZE + MLX90614_CODEC_MIN_BLOCK_SIZE))
+    {
+        MLX_ERROR("Invalid batch limits.", __FUNCTION__);
+    }
+    else if ((p_uplink = malloc(size)) == NULL)
+    {
+        MLX_ERROR("Not enough free memory.", __FUNCTION__);
+    }
+    else
+    {
+        memset(p_uplink, 0, sizeof(mlx90614_uplink_t));
+        p_uplink->sink = sink;
+        p_uplink->p_sink_context = p_sink_context;
+        p_uplink->p_spill = p_spill;
+        // Backlog left in spill log by previous run is replayed first
+        p_uplink->spill_seq = p_spill ? p_spill->first_seq : 0;
+        p_uplink->open_seq = p_spill ? p_spill->next_seq : 0;
+        p_uplink->max_samples = max_samples;
+        p_uplink->max_age_ms = max_age_ms;
+        p_uplink->buffer_size = buffer_size;
+
+        // Staging area and batch buffer follow descriptor
+        p_uplink->p_samples = (mlx90614_sample_t *)(p_uplink + 1);
+        p_uplink->p_consumed = (uint8_t *)(p_uplink->p_samples + max_samples);
+        p_uplink->p_buffer = p_uplink->p_consumed + max_samples;
+    }
+
+    return p_uplink;
+}
+
+void
+mlx90614_uplink_close(mlx90614_uplink_t *p_uplink)
+{
+    if (p_uplink)
+    {
+        free(p_uplink);
+        p_uplink = NULL;
+    }
+}
+
+bool
+mlx90614_uplink_push(mlx90614_uplink_t *p_uplink,
+    const mlx90614_sample_t *p_sample)
+{
+    bool b_result = true;
+    bool b_is_spilling = p_uplink->p_spill &&
+        (p_uplink->spill_seq != p_uplink->p_spill->next_seq);
+
+    if (!b_is_spilling && (p_uplink->sample_count < p_uplink->max_samples))
+    {
+        if (p_uplink->sample_count == 0)
+        {
+            p_uplink->batch_start_ms = mlx90614_get_time_ms();
+        }
+        p_uplink->p_samples[p_uplink->sample_count++] = *p_sample;
+    }
+    else if (p_uplink->p_spill &&
+        (mlx90614_log_append(p_uplink->p_spill, p_sample) != 0))
+    {
+        // Keep spilling until backlog is replayed to preserve sample order
+        p_uplink->stats.samples_spilled++;
+    }
+    else
+    {
+        p_uplink->stats.samples_dropped++;
+        b_result = false;
+    }
+
+    mlx90614_uplink_poll(p_uplink, false);
+
+    return b_result;
+}
+
+void
+mlx90614_uplink_poll(mlx90614_uplink_t *p_uplink, bool b_force)
+{
+    if (p_uplink->pending_length > 0)
+    {
+        batch_send(p_uplink);
+    }
+
+    if ((p_uplink->pending_length == 0) && (p_uplink->sample_count == 0))
+    {
+        spill_replay(p_uplink);
+    }
+
+    if ((p_uplink->pending_length == 0) && (p_uplink->sample_count > 0))
+    {
+        uint32_t age_ms = mlx90614_get_time_ms() - p_uplink->batch_start_ms;
+
+        if (b_force || (p_uplink->sample_count >= p_uplink->max_samples) ||
+            (age_ms >= p_uplink->max_age_ms))
+        {
+            batch_serialize(p_uplink);
+            batch_send(p_uplink);
+        }
+    }
+}
+
+mlx_sink_result
+mlx90614_uplink_fd_sink(void *p_context, const uint8_t *p_data,
+    uint32_t length)
+{
+    mlx_sink_result result = MLX_SINK_OK;
+    int fd = *(int *)p_context;
+    uint32_t prefix = length;
+    struct iovec iov[2] = {
+        { .iov_base = &prefix, .iov_len = sizeof(prefix) },
+        { .iov_base = (void *)p_data, .iov_len = length }
+    };
+
+    ssize_t written = writev(fd, iov, 2);
+
+    if (written == -1)
+    {
+        result = ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ?
+            MLX_SINK_BUSY : MLX_SINK_ERROR;
+    }
+    else if ((size_t)written != sizeof(prefix) + length)
+    {
+        MLX_ERROR("Short write to sink.", __FUNCTION__);
+        result = MLX_SINK_ERROR;
+    }
+
+    return result;
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static void
+batch_serialize(mlx90614_uplink_t *p_uplink)
+{
+    uint8_t *p_buf = p_uplink->p_buffer;
+    uint32_t length = MLX90614_UPLINK_HEADER_SIZE;
+    uint16_t block_count = 0;
+    uint32_t sample_count = p_uplink->sample_count;
+    mlx90614_sample_t *p_samples = p_uplink->p_samples;
+    uint8_t *p_consumed = p_uplink->p_consumed;
+    mlx90614_encoder_t encoder;
+    bool b_is_full = false;
+
+    memset(p_consumed, 0, sample_count);
+    p_uplink->pending_count = 0;
+    p_uplink->pending_timed = 0;
+    p_uplink->pending_age_sum = 0;
+    p_uplink->pending_age_max = 0;
+    p_uplink->pending_ms = mlx90614_get_time_ms();
+
+    // Encode blocks per sensor channel, in order of first appearance
+    for (uint32_t first = 0; !b_is_full && (first < sample_count); first++)
+    {
+        uint32_t put_count = 0;
+        uint32_t space;
+
+        if (p_consumed[first])
+        {
+            continue;
+        }
+
+        // Length prefix and empty block must fit behind previous block
+        space = (length + BLOCK_LEN_SIZE < p_uplink->buffer_size) ?
+            p_uplink->buffer_size - length - BLOCK_LEN_SIZE : 0;
+
+        // Block is limited to what its 16-bit length prefix can hold, rest
+        // of channel continues in next block
+        if ((space < MLX90614_CODEC_MIN_BLOCK_SIZE) ||
+            !mlx90614_encoder_init(&encoder, &p_buf[length + BLOCK_LEN_SIZE],
+            (space > UINT16_MAX) ? UINT16_MAX : space))
+        {
+            b_is_full = true;
+            continue;
+        }
+
+        for (uint32_t idx = first; idx < sample_count; idx++)
+        {
+            if (!p_consumed[idx] &&
+                (p_samples[idx].i2c_addr == p_samples[first].i2c_addr) &&
+                (p_samples[idx].channel == p_samples[first].channel))
+            {
+                if (!mlx90614_encoder_put(&encoder, &p_samples[idx]))
+                {
+                    b_is_full = (space <= UINT16_MAX);
+                    break;
+                }
+
+                put_count++;
+                p_consumed[idx] = 1;
+                p_uplink->pending_count++;
+
+                // Replayed samples from before open have another time base
+                if (idx >= p_uplink->replay_count)
+                {
+                    uint32_t age_ms = p_uplink->pending_ms -
+                        p_samples[idx].timestamp_ms;
+
+                    p_uplink->pending_timed++;
+                    p_uplink->pending_age_sum += age_ms;
+                    if (age_ms > p_uplink->pending_age_max)
+                    {
+                        p_uplink->pending_age_max = age_ms;
+                    }
+                }
+            }
+        }
+
+        // Block without samples is not sent, its samples wait for next batch
+        if (put_count > 0)
+        {
+            uint32_t block_len = mlx90614_encoder_finish(&encoder);
+
+            p_buf[length] = (uint8_t)(block_len);
+            p_buf[length + 1] = (uint8_t)(block_len >> 8);
+            length += BLOCK_LEN_SIZE + block_len;
+            block_count++;
+        }
+    }
+
+    p_buf[0] = MLX90614_UPLINK_MAGIC;
+    p_buf[1] = MLX90614_UPLINK_VERSION;
+    p_buf[2] = (uint8_t)(block_count);
+    p_buf[3] = (uint8_t)(block_count >> 8);
+    p_uplink->pending_length = length;
+
+    // Keep samples which did not fit into batch buffer
+    uint32_t kept = 0;
+    uint32_t replay_kept = 0;
+    for (uint32_t idx = 0; idx < sample_count; idx++)
+    {
+        if (!p_consumed[idx])
+        {
+            if (idx < p_uplink->replay_count)
+            {
+                replay_kept++;
+            }
+            p_samples[kept++] = p_samples[idx];
+        }
+    }
+    p_uplink->sample_count = kept;
+    p_uplink->replay_count = replay_kept;
+    p_uplink->batch_start_ms = mlx90614_get_time_ms();
+
+    p_uplink->stats.fill_permille_sum +=
+        (uint64_t)length * 1000 / p_uplink->buffer_size;
+}
+
+static void
+batch_send(mlx90614_uplink_t *p_uplink)
+{
+    mlx_sink_result result = p_uplink->sink(p_uplink->p_sink_context,
+        p_uplink->p_buffer, p_uplink->pending_length);
+
+    if (result == MLX_SINK_OK)
+    {
+        // Sample latency is its age at serialization plus sink delay
+        uint32_t delay_ms = mlx90614_get_time_ms() - p_uplink->pending_ms;
+
+        p_uplink->stats.batches_sent++;
+        p_uplink->stats.samples_sent += p_uplink->pending_count;
+        if (p_uplink->pending_timed > 0)
+        {
+            p_uplink->stats.samples_timed += p_uplink->pending_timed;
+            p_uplink->stats.latency_sum_ms += p_uplink->pending_age_sum +
+                (uint64_t)delay_ms * p_uplink->pending_timed;
+            if (p_uplink->pending_age_max + delay_ms >
+                p_uplink->stats.latency_max_ms)
+            {
+                p_uplink->stats.latency_max_ms =
+                    p_uplink->pending_age_max + delay_ms;
+            }
+        }
+        p_uplink->pending_length = 0;
+    }
+    else if (result == MLX_SINK_BUSY)
+    {
+        p_uplink->stats.sink_busy++;
+    }
+    else
+    {
+        MLX_ERROR("Sink rejected batch of %u samples.", __FUNCTION__,
+            p_uplink->pending_count);
+        p_uplink->stats.batches_failed++;
+        p_uplink->stats.samples_dropped += p_uplink->pending_count;
+        p_uplink->pending_length = 0;
+    }
+}
+
+static void
+spill_replay(mlx90614_uplink_t *p_uplink)
+{
+    if (p_uplink->p_spill &&
+        (p_uplink->spill_seq != p_uplink->p_spill->next_seq))
+    {
+        uint32_t seq = p_uplink->spill_seq;
+        uint32_t count;
+
+        // Log read skips records already overwritten
+        if ((int32_t)(seq - p_uplink->p_spill->first_seq) < 0)
+        {
+            seq = p_uplink->p_spill->first_seq;
+        }
+
+        count = mlx90614_log_read(p_uplink->p_spill, &p_uplink->spill_seq,
+            p_uplink->p_samples, p_uplink->max_samples);
+
+        if (count > 0)
+        {
+            p_uplink->sample_count = count;
+            p_uplink->replay_count = 0;
+            if ((int32_t)(p_uplink->open_seq - seq) > 0)
+            {
+                p_uplink->replay_count = (p_uplink->open_seq - seq < count) ?
+                    p_uplink->open_seq - seq : count;
+            }
+            p_uplink->batch_start_ms = mlx90614_get_time_ms();
+        }
+    }
+}
+
+/* [] END OF FILE */
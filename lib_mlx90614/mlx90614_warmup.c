@@ -0,0 +1,212 @@
+/***************************************************************************//**
+* @file    mlx90614_warmup.c
+* @version 1.0.0
+*
+* @brief Warm-up tracking and compensation for MLX90614 readings.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_warmup.h"
+#include "mlx90614_support.h"
+
+// TA slope smoothing factor
+#define TA_SLOPE_ALPHA      0.25F
+
+/*******************************************************************************
+* Global variables
+*******************************************************************************/
+
+// Datasheet settling times in ms, indexed by CONF1 IIR and FIR 128..1024,
+// single zone and dual zone
+static const uint16_t settle_table_ms[8][4][2] = {
+    { {  300,  470 }, {  370,  600 }, {  540,  840 }, {  860, 1330 } },
+    { {  700, 1100 }, {  880, 1400 }, { 1300, 2000 }, { 2000, 3200 } },
+    { { 1100, 1800 }, { 1400, 2200 }, { 2000, 3200 }, { 3300, 5000 } },
+    { { 1500, 2400 }, { 1900, 3000 }, { 2800, 4300 }, { 4500, 7000 } },
+    { {   40,   60 }, {   50,   70 }, {   60,  100 }, {  100,  140 } },
+    { {  120,  200 }, {  160,  240 }, {  220,  340 }, {  350,  540 } },
+    { {  240,  380 }, {  300,  480 }, {  430,  670 }, {  700, 1100 } },
+    { {  260,  420 }, {  340,  530 }, {  480,  750 }, {  780, 1200 } }
+};
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Extrapolate exponential step response to its final value.
+ *
+ * @param p_hist Last three samples, oldest first.
+ *
+ * @return Extrapolated value, last sample if response is not exponential.
+ */
+static float
+extrapolate(const uint16_t *p_hist);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+uint32_t
+mlx90614_warmup_settle_ms(mlx90614_conf1_t conf1)
+{
+    // Not recommended FIR settings settle faster, FIR 128 time is used
+    uint8_t fir = (conf1.FIR >= CONF1_FIR_128) ?
+        (uint8_t)(conf1.FIR - CONF1_FIR_128) : 0;
+    uint8_t zone = conf1.SENSOR_MODE ? 1 : 0;
+    uint32_t settle_ms = settle_table_ms[conf1.IIR][fir][zone];
+
+    return settle_ms;
+}
+
+void
+mlx90614_warmup_init(mlx90614_warmup_t *p_wu,
+    const mlx90614_profile_t *p_profile, uint32_t start_ms, bool b_correct,
+    float drift_coef)
+{
+    memset(p_wu, 0, sizeof(mlx90614_warmup_t));
+    p_wu->settle_ms = mlx90614_warmup_settle_ms(p_profile->conf1);
+    p_wu->b_correct = b_correct;
+    p_wu->drift_coef = drift_coef;
+    mlx90614_warmup_restart(p_wu, start_ms);
+}
+
+void
+mlx90614_warmup_restart(mlx90614_warmup_t *p_wu, uint32_t start_ms)
+{
+    p_wu->start_ms = start_ms;
+    p_wu->ta_count = 0;
+    p_wu->ta_slope = 0.0F;
+    p_wu->hist_count[0] = 0;
+    p_wu->hist_count[1] = 0;
+}
+
+float
+mlx90614_warmup_update(mlx90614_warmup_t *p_wu,
+    const mlx90614_sample_t *p_sample, uint16_t *p_corrected)
+{
+    float confidence = 0.0F;
+    float thermal = 1.0F;
+    float slope_abs = (p_wu->ta_slope < 0) ? -p_wu->ta_slope : p_wu->ta_slope;
+    uint16_t corrected = p_sample->raw;
+
+    if (p_sample->raw & 0x8000)
+    {
+        // Invalid sample, nothing to rate or correct
+    }
+    else if (p_sample->channel == MLX90614_RREG_TA)
+    {
+        if ((p_wu->ta_count > 0) &&
+            (p_sample->timestamp_ms != p_wu->ta_time_ms))
+        {
+            float slope = ((float)p_sample->raw - (float)p_wu->ta_raw) *
+                1000.0F / (float)(p_sample->timestamp_ms - p_wu->ta_time_ms);
+
+            p_wu->ta_slope += TA_SLOPE_ALPHA * (slope - p_wu->ta_slope);
+            slope_abs = (p_wu->ta_slope < 0) ? -p_wu->ta_slope :
+                p_wu->ta_slope;
+            p_wu->ta_count = 2;
+        }
+        else if (p_wu->ta_count == 0)
+        {
+            p_wu->ta_count = 1;
+        }
+        p_wu->ta_raw = p_sample->raw;
+        p_wu->ta_time_ms = p_sample->timestamp_ms;
+
+        // Drift is unknown until it was measured between two TA samples
+        if (p_wu->ta_count < 2)
+        {
+            thermal = 0.0F;
+        }
+        else if (slope_abs > MLX90614_WARMUP_TA_SLOPE_OK)
+        {
+            thermal = MLX90614_WARMUP_TA_SLOPE_OK / slope_abs;
+        }
+        confidence = thermal;
+    }
+    else if ((p_sample->channel == MLX90614_RREG_TOBJ1) ||
+        (p_sample->channel == MLX90614_RREG_TOBJ2))
+    {
+        uint8_t zone_idx = (p_sample->channel == MLX90614_RREG_TOBJ1) ? 0 : 1;
+        uint16_t *p_hist = p_wu->hist[zone_idx];
+        uint32_t elapsed = p_sample->timestamp_ms - p_wu->start_ms;
+        float filter = 1.0F;
+
+        if (elapsed < p_wu->settle_ms)
+        {
+            filter = (float)elapsed / (float)p_wu->settle_ms;
+        }
+
+        // Thermal settling unknown until two TA samples were seen
+        if (p_wu->ta_count < 2)
+        {
+            thermal = 0.0F;
+        }
+        else if (slope_abs > MLX90614_WARMUP_TA_SLOPE_OK)
+        {
+            thermal = MLX90614_WARMUP_TA_SLOPE_OK / slope_abs;
+        }
+        confidence = filter * thermal;
+
+        if (p_wu->hist_count[zone_idx] == 3)
+        {
+            p_hist[0] = p_hist[1];
+            p_hist[1] = p_hist[2];
+            p_wu->hist_count[zone_idx]--;
+        }
+        p_hist[p_wu->hist_count[zone_idx]++] = p_sample->raw;
+
+        if (p_wu->b_correct)
+        {
+            float value = (float)p_sample->raw;
+
+            if ((filter < 1.0F) && (p_wu->hist_count[zone_idx] == 3))
+            {
+                value = extrapolate(p_hist);
+            }
+            value -= p_wu->drift_coef * p_wu->ta_slope;
+
+            value = (value < 0.0F) ? 0.0F : value;
+            corrected = (uint16_t)((value > 32767.0F) ? 32767 :
+                (uint16_t)(value + 0.5F));
+        }
+    }
+
+    if (p_corrected)
+    {
+        *p_corrected = corrected;
+    }
+
+    return confidence;
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static float
+extrapolate(const uint16_t *p_hist)
+{
+    float d1 = (float)p_hist[1] - (float)p_hist[0];
+    float d2 = (float)p_hist[2] - (float)p_hist[1];
+    float result = (float)p_hist[2];
+
+    // Exponential approach has steps of equal sign and decreasing size,
+    // steps within noise level are not extrapolated
+    if ((d1 * d2 > 0.0F) && ((d2 < 0 ? -d2 : d2) < (d1 < 0 ? -d1 : d1)) &&
+        ((d1 < 0 ? -d1 : d1) >= 2.0F))
+    {
+        result += d2 * d2 / (d1 - d2);
+    }
+
+    return result;
+}
+
+/* [] END OF FILE */
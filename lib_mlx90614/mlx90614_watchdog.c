@@ -0,0 +1,306 @@
+/***************************************************************************//**
+* @file    mlx90614_watchdog.c
+* @version 1.0.0
+*
+* @brief Sample staleness watchdog for MLX90614 sensors.
+*
+* @author   Jaroslav Groman
+*
+*******************************************************************************/
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "lib_mlx90614.h"
+#include "lib_mlx90614_warmup.h"
+#include "lib_mlx90614_watchdog.h"
+#include "mlx90614_support.h"
+
+/*******************************************************************************
+* Forward declarations of private functions
+*******************************************************************************/
+
+/**
+ * @brief Find watched sensor.
+ *
+ * @param p_wd Pointer to watchdog.
+ * @param i2c_addr Sensor address.
+ *
+ * @return Pointer to sensor state, NULL if sensor is not watched.
+ */
+static mlx90614_watchdog_sensor_t
+*find_sensor(mlx90614_watchdog_t *p_wd, uint8_t i2c_addr);
+
+/**
+ * @brief Track object word of sample.
+ *
+ * @param p_sensor Pointer to sensor state.
+ * @param p_sample Valid object channel sample.
+ */
+static void
+track_object(mlx90614_watchdog_sensor_t *p_sensor,
+    const mlx90614_sample_t *p_sample);
+
+/**
+ * @brief Get longest unchanged time of frozen object channels.
+ *
+ * @param p_sensor Pointer to sensor state.
+ * @param now_ms Current monotonic time.
+ *
+ * @return Unchanged time in milliseconds if frozen, 0 otherwise.
+ */
+static uint32_t
+frozen_time(const mlx90614_watchdog_sensor_t *p_sensor, uint32_t now_ms);
+
+/**
+ * @brief Update sensor state and call event function on changes.
+ *
+ * @param p_wd Pointer to watchdog.
+ * @param p_sensor Pointer to sensor state.
+ * @param b_is_stale New stale state.
+ * @param b_is_frozen New frozen state.
+ * @param age_ms Event age.
+ */
+static void
+set_state(mlx90614_watchdog_t *p_wd, mlx90614_watchdog_sensor_t *p_sensor,
+    bool b_is_stale, bool b_is_frozen, uint32_t age_ms);
+
+/*******************************************************************************
+* Function definitions
+*******************************************************************************/
+
+void
+mlx90614_watchdog_init(mlx90614_watchdog_t *p_wd,
+    mlx90614_watchdog_cb_t callback, void *p_context)
+{
+    memset(p_wd, 0, sizeof(mlx90614_watchdog_t));
+    p_wd->callback = callback;
+    p_wd->p_context = p_context;
+}
+
+bool
+mlx90614_watchdog_add(mlx90614_watchdog_t *p_wd, mlx90614_t *p_mlx,
+    uint32_t slo_ms)
+{
+    bool b_result = false;
+
+    if (p_wd->sensor_count >= MLX90614_WATCHDOG_MAX_SENSORS)
+    {
+        MLX_ERROR("Too many watched sensors.", __FUNCTION__);
+    }
+    else if (find_sensor(p_wd, (uint8_t)p_mlx->i2c_addr))
+    {
+        // Samples carry no bus, sensor is identified by address only
+        MLX_ERROR("Sensor 0x%02X already watched.", __FUNCTION__,
+            (uint8_t)p_mlx->i2c_addr);
+    }
+    else
+    {
+        mlx90614_watchdog_sensor_t *p_sensor =
+            &p_wd->sensors[p_wd->sensor_count];
+        uint32_t now_ms = mlx90614_get_time_ms();
+
+        memset(p_sensor, 0, sizeof(mlx90614_watchdog_sensor_t));
+        p_sensor->i2c_addr = (uint8_t)p_mlx->i2c_addr;
+        p_sensor->channels = p_mlx->profile.channels &
+            (MLX90614_CH_TOBJ1 | MLX90614_CH_TOBJ2);
+        p_sensor->slo_ms = slo_ms;
+        p_sensor->frozen_ms = MLX90614_WATCHDOG_FROZEN_FACTOR *
+            mlx90614_warmup_settle_ms(p_mlx->profile.conf1);
+        p_sensor->fresh_ms = now_ms;
+        p_sensor->obj_since_ms[0] = now_ms;
+        p_sensor->obj_since_ms[1] = now_ms;
+
+        p_wd->sensor_count++;
+        b_result = true;
+    }
+
+    return b_result;
+}
+
+void
+mlx90614_watchdog_consume(void *p_context,
+    const mlx90614_sample_t *p_samples, const float *p_values,
+    uint32_t count)
+{
+    mlx90614_watchdog_t *p_wd = (mlx90614_watchdog_t *)p_context;
+    uint32_t latest_ms = 0;
+
+    (void)p_values;
+
+    for (uint32_t idx = 0; idx < count; idx++)
+    {
+        const mlx90614_sample_t *p_sample = &p_samples[idx];
+        mlx90614_watchdog_sensor_t *p_sensor =
+            find_sensor(p_wd, p_sample->i2c_addr);
+
+        if ((idx == 0) || ((int32_t)(p_sample->timestamp_ms - latest_ms) > 0))
+        {
+            latest_ms = p_sample->timestamp_ms;
+        }
+
+        // Samples with error flag set do not refresh sensor
+        if (p_sensor && ((p_sample->raw & 0x8000) == 0))
+        {
+            if ((int32_t)(p_sample->timestamp_ms - p_sensor->fresh_ms) > 0)
+            {
+                p_sensor->fresh_ms = p_sample->timestamp_ms;
+            }
+
+            if (p_sample->channel != MLX90614_RREG_TA)
+            {
+                uint32_t frozen_ms;
+
+                track_object(p_sensor, p_sample);
+                frozen_ms = frozen_time(p_sensor, p_sample->timestamp_ms);
+                set_state(p_wd, p_sensor, p_sensor->b_is_stale,
+                    frozen_ms > 0, frozen_ms);
+            }
+        }
+    }
+
+    if (count > 0)
+    {
+        mlx90614_watchdog_check(p_wd, latest_ms);
+    }
+}
+
+void
+mlx90614_watchdog_check(mlx90614_watchdog_t *p_wd, uint32_t now_ms)
+{
+    for (uint8_t idx = 0; idx < p_wd->sensor_count; idx++)
+    {
+        mlx90614_watchdog_sensor_t *p_sensor = &p_wd->sensors[idx];
+        uint32_t age_ms = 0;
+
+        // Sample newer than check time is fresh
+        if ((int32_t)(now_ms - p_sensor->fresh_ms) > 0)
+        {
+            age_ms = now_ms - p_sensor->fresh_ms;
+        }
+
+        if (age_ms > p_sensor->max_age_ms)
+        {
+            p_sensor->max_age_ms = age_ms;
+        }
+
+        set_state(p_wd, p_sensor, age_ms > p_sensor->slo_ms,
+            p_sensor->b_is_frozen, age_ms);
+    }
+}
+
+const mlx90614_watchdog_sensor_t
+*mlx90614_watchdog_get_sensor(const mlx90614_watchdog_t *p_wd,
+    uint8_t i2c_addr)
+{
+    return find_sensor((mlx90614_watchdog_t *)p_wd, i2c_addr);
+}
+
+/*******************************************************************************
+* Private function definitions
+*******************************************************************************/
+
+static mlx90614_watchdog_sensor_t
+*find_sensor(mlx90614_watchdog_t *p_wd, uint8_t i2c_addr)
+{
+    mlx90614_watchdog_sensor_t *p_sensor = NULL;
+
+    for (uint8_t idx = 0; (p_sensor == NULL) && (idx < p_wd->sensor_count);
+        idx++)
+    {
+        if (p_wd->sensors[idx].i2c_addr == i2c_addr)
+        {
+            p_sensor = &p_wd->sensors[idx];
+        }
+    }
+
+    return p_sensor;
+}
+
+static void
+track_object(mlx90614_watchdog_sensor_t *p_sensor,
+    const mlx90614_sample_t *p_sample)
+{
+    uint8_t zone = (p_sample->channel == MLX90614_RREG_TOBJ2) ? 1 : 0;
+
+    if ((p_sensor->obj_repeats[zone] == 0) ||
+        (p_sample->raw != p_sensor->obj_raw[zone]))
+    {
+        p_sensor->obj_raw[zone] = p_sample->raw;
+        p_sensor->obj_since_ms[zone] = p_sample->timestamp_ms;
+        p_sensor->obj_repeats[zone] = 1;
+    }
+    else if (p_sensor->obj_repeats[zone] < UINT16_MAX)
+    {
+        p_sensor->obj_repeats[zone]++;
+    }
+}
+
+static uint32_t
+frozen_time(const mlx90614_watchdog_sensor_t *p_sensor, uint32_t now_ms)
+{
+    uint32_t frozen_ms = 0;
+
+    for (uint8_t zone = 0; zone < 2; zone++)
+    {
+        uint32_t unchanged_ms = now_ms - p_sensor->obj_since_ms[zone];
+
+        // Repeated word longer than filter settling explains
+        if ((p_sensor->channels & (MLX90614_CH_TOBJ1 << zone)) &&
+            (p_sensor->obj_repeats[zone] >= MLX90614_WATCHDOG_FROZEN_SAMPLES)
+            && (unchanged_ms > p_sensor->frozen_ms) &&
+            (unchanged_ms > frozen_ms))
+        {
+            frozen_ms = unchanged_ms;
+        }
+    }
+
+    return frozen_ms;
+}
+
+static void
+set_state(mlx90614_watchdog_t *p_wd, mlx90614_watchdog_sensor_t *p_sensor,
+    bool b_is_stale, bool b_is_frozen, uint32_t age_ms)
+{
+    bool b_was_violated = p_sensor->b_is_stale || p_sensor->b_is_frozen;
+    mlx_watchdog_event event = MLX_WATCHDOG_RECOVERED;
+    bool b_is_event = false;
+
+    if (b_is_stale && !p_sensor->b_is_stale)
+    {
+        event = MLX_WATCHDOG_STALE;
+        b_is_event = true;
+    }
+    else if (b_is_frozen && !p_sensor->b_is_frozen)
+    {
+        event = MLX_WATCHDOG_FROZEN;
+        b_is_event = true;
+    }
+    else if (b_was_violated && !b_is_stale && !b_is_frozen)
+    {
+        age_ms = 0;
+        b_is_event = true;
+    }
+
+    p_sensor->b_is_stale = b_is_stale;
+    p_sensor->b_is_frozen = b_is_frozen;
+
+    if (b_is_event)
+    {
+        if (event != MLX_WATCHDOG_RECOVERED)
+        {
+            p_sensor->violations++;
+            MLX_DEBUG("Sensor 0x%02X %s for %u ms", __FUNCTION__,
+                p_sensor->i2c_addr,
+                (event == MLX_WATCHDOG_STALE) ? "stale" : "frozen", age_ms);
+        }
+
+        if (p_wd->callback)
+        {
+            p_wd->callback(p_wd->p_context, p_sensor->i2c_addr, event,
+                age_ms);
+        }
+    }
+}
+
+/* [] END OF FILE */